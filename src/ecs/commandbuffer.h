@@ -0,0 +1,110 @@
+#ifndef HVH_WC_ECS_COMMANDBUFFER_H
+#define HVH_WC_ECS_COMMANDBUFFER_H
+
+#include "component_info.h"
+#include "entity.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace wc::ecs {
+
+	class Registry;
+
+	// Records structural changes (creating and destroying entities, adding and removing components)
+	// so they can be applied to a Registry later, when nothing is iterating over it.
+	// Component values are moved into blocks owned by the buffer until they're applied.
+	// A CommandBuffer is not thread-safe; each thread should record into its own (see DeferredCommands).
+	class CommandBuffer {
+	public:
+		CommandBuffer() {}
+		CommandBuffer(const CommandBuffer&) = delete;
+		CommandBuffer& operator = (const CommandBuffer&) = delete;
+		~CommandBuffer() { clear(); releaseBlocks(); }
+
+		// Creates an entity now, so its ID can be used in later commands straight away,
+		// but it isn't added to a registry until the buffer is applied.
+		// If the buffer is cleared without being applied, the entity is destroyed.
+		entity::ID create() {
+			entity::ID id = entity::create();
+			commands.push_back(Command{ id, 0, CREATE, nullptr });
+			return id;
+		}
+
+		void destroy(entity::ID id) {
+			commands.push_back(Command{ id, 0, DESTROY, nullptr });
+		}
+
+		template <typename T>
+		void add(entity::ID id, T value) {
+			void* mem = allocateValue(sizeof(T), alignof(T));
+			new (mem) T(std::move(value));
+			commands.push_back(Command{ id, componentId<T>(), ADD, mem });
+		}
+
+		template <typename T>
+		void remove(entity::ID id) {
+			commands.push_back(Command{ id, componentId<T>(), REMOVE, nullptr });
+		}
+
+		bool empty() const { return commands.empty(); }
+		size_t size() const { return commands.size(); }
+
+		// Throws away every recorded command, destroying any component values which were never applied.
+		void clear();
+
+	private:
+		friend class Registry;
+
+		enum Op : uint8_t { CREATE, DESTROY, ADD, REMOVE };
+		struct Command {
+			entity::ID id; // Set to 0 by CREATE once the entity belongs to a registry.
+			ComponentId component;
+			Op op;
+			void* value; // Only used by ADD; set to nullptr once the value has been moved out.
+		};
+
+		static constexpr size_t BLOCK_BYTES = 65536;
+
+		void* allocateValue(size_t size, size_t alignment);
+		void releaseBlocks();
+
+		std::vector<Command> commands;
+		std::vector<void*> blocks;
+		std::vector<std::pair<void*, size_t>> oversized; // Values too large for a block get their own allocation.
+		size_t currentBlock = 0;
+		size_t blockUsed = 0;
+	};
+
+	// DeferredCommands
+	// A command buffer for every job thread, so systems and scripts can record structural changes
+	// during a logical frame without locking and without disturbing anything which is iterating.
+	// The main loop flushes the engine's DeferredCommands (see 'commands') once the late logical update is done.
+	class DeferredCommands {
+	public:
+		// 'numthreads' should be jobs::numThreads(); one more buffer is made for threads outside the job system.
+		DeferredCommands(size_t numthreads);
+		DeferredCommands(const DeferredCommands&) = delete;
+		DeferredCommands& operator = (const DeferredCommands&) = delete;
+
+		// Returns the calling thread's command buffer.
+		// Threads outside the job system share one buffer, so they must not record at the same time.
+		CommandBuffer& local();
+
+		// Applies every thread's commands to a registry in one sorted pass (see Registry::apply), then clears them.
+		// Must be called while nothing is recording or iterating.
+		void flush(Registry& registry);
+
+		// Returns the number of commands waiting to be flushed.
+		size_t size() const;
+
+	private:
+		std::vector<std::unique_ptr<CommandBuffer>> buffers;
+		// Scratch space for flush: the buffers which have anything in them.
+		std::vector<CommandBuffer*> pointers;
+	};
+
+} // namespace wc::ecs
+
+#endif // HVH_WC_ECS_COMMANDBUFFER_H
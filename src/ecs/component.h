@@ -1,44 +1,65 @@
 #ifndef HVH_WC_ECS_COMPONENT_H
 #define HVH_WC_ECS_COMPONENT_H
 
+#include "tools/sparse_soa.hpp"
 #include "tools/htable.hpp"
+#include "tools/fixedstring.h"
 #include "debug.h"
 
 #include "entity.h"
 
 
+// Stores one set of 'DataTypes...' for each entity it's attached to.
+// The data lives in a sparse set keyed by entity ID, so attaching, detaching, and looking up
+// are O(1) without hashing, and systems can walk the data as dense arrays using 'forEach'.
+// Each entity can have at most one of each component.
 template <typename...  DataTypes>
 class Component {
 public:
-	bool Attach(entity::ID id, const DataTypes&... data) {
-		if (!allowMultiple) {
-			if (table.find(id) == SIZE_MAX) {
-				table.insert(id, data...);
-			}
-			else {
-				debug::error("In Component::Attach(", entity:toString(id), "):\n"));
-				debug::errmore("This entity already has a '", componentName, "' attached.\n")
-			}
+	typedef hvh::sparse_soa<entity::ID, DataTypes...> storage_type;
+
+	Component(const char* name) : componentName(name) {}
+
+	bool attach(entity::ID id, const DataTypes&... data) {
+		if (table.contains(id)) {
+			debug::error("In Component::attach(", entity::toString(id), "):\n");
+			debug::errmore("This entity already has a '", componentName, "' attached.\n");
+			return false;
 		}
-		else {
-			table.insert(id, data...);
+		if (!table.insert(id, data...)) {
+			debug::error("In Component::attach(", entity::toString(id), "):\n");
+			debug::errmore("Failed to attach '", componentName, "'.\n");
+			return false;
 		}
+		return true;
 	}
 
-private:
-	hvh::htable<entity::ID, DataTypes...> table;
-	bool allowMultiple = false;
-	const char* componentName;
-};
+	bool detach(entity::ID id) { return table.erase(id); }
 
+	bool has(entity::ID id) const { return table.contains(id); }
 
+	// Returns a pointer to the Kth piece of data attached to an entity, or nullptr if it doesn't have this component.
+	template <size_t K>
+	auto get(entity::ID id) {
+		size_t index = table.find(id);
+		return (index == SIZE_MAX) ? nullptr : &table.template at<K + 1>(index);
+	}
+
+	// Calls 'func(first, std::span<entity::ID>, std::span<DataTypes[Ks]>...)' for each chunk of attached entities.
+	// The entity IDs must not be modified.
+	template <size_t... Ks, typename FuncT>
+	void forEach(FuncT&& func) {
+		table.template for_each<0, (Ks + 1)...>(std::forward<FuncT>(func));
+	}
+
+	size_t size() const { return table.size(); }
+
+	storage_type& storage() { return table; }
+	const storage_type& storage() const { return table; }
 
-class TagsComponent {
-public:
 private:
-	hvh::htable<entity::ID, FixedString<32>> table;
-	hvh::htable<FixedString<32>, hvh::htable<entity::ID>> tagTables;
+	storage_type table;
+	const char* componentName;
 };
 
-
-#endif // HVH_WC_ECS_COMPONENT_H
\ No newline at end of file
+#endif // HVH_WC_ECS_COMPONENT_H
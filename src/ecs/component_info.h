@@ -0,0 +1,91 @@
+#ifndef HVH_WC_ECS_COMPONENTINFO_H
+#define HVH_WC_ECS_COMPONENTINFO_H
+
+#include "tools/soa.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <typeinfo>
+
+namespace wc::ecs {
+
+	typedef uint32_t ComponentId;
+	static constexpr size_t MAX_COMPONENTS = 256;
+
+	// Describes how to move and destroy a component type, so that archetypes can store any type in raw memory.
+	struct ComponentInfo {
+		const char* name;
+		size_t size;
+		size_t alignment;
+		bool trivial; // Trivially relocatable; can be moved with memcpy and never needs destroying.
+		void (*relocate)(void* dst, void* src); // Move-constructs into 'dst', then destroys 'src'.
+		void (*destroy)(void* ptr);
+	};
+
+	// Registers a component type and returns its ID.
+	// Use componentId<T>() instead, which calls this once per type.
+	ComponentId registerComponent(const ComponentInfo& info);
+	const ComponentInfo& componentInfo(ComponentId id);
+	size_t numComponentTypes();
+
+	// Returns the ID of component type T, registering it the first time it's asked for.
+	template <typename T>
+	ComponentId componentId() {
+		static const ComponentId id = registerComponent(ComponentInfo{
+			typeid(T).name(), sizeof(T), alignof(T), hvh::is_trivially_relocatable<T>::value,
+			[](void* dst, void* src) { new (dst) T(std::move(*(T*)src)); ((T*)src)->~T(); },
+			[](void* ptr) { ((T*)ptr)->~T(); } });
+		return id;
+	}
+
+	// A set of component types, one bit per ComponentId.
+	struct ComponentMask {
+		uint64_t words[MAX_COMPONENTS / 64] = {};
+
+		inline void set(ComponentId id) { words[id / 64] |= (uint64_t)1 << (id % 64); }
+		inline void reset(ComponentId id) { words[id / 64] &= ~((uint64_t)1 << (id % 64)); }
+		inline bool test(ComponentId id) const { return (words[id / 64] >> (id % 64)) & 1; }
+
+		// Returns true if every component in 'other' is also in this set.
+		inline bool contains(const ComponentMask& other) const {
+			for (size_t i = 0; i < MAX_COMPONENTS / 64; ++i) {
+				if ((words[i] & other.words[i]) != other.words[i]) return false;
+			}
+			return true;
+		}
+		// Returns true if any component in 'other' is also in this set.
+		inline bool intersects(const ComponentMask& other) const {
+			for (size_t i = 0; i < MAX_COMPONENTS / 64; ++i) {
+				if (words[i] & other.words[i]) return true;
+			}
+			return false;
+		}
+		inline bool operator == (const ComponentMask& rhs) const {
+			for (size_t i = 0; i < MAX_COMPONENTS / 64; ++i) {
+				if (words[i] != rhs.words[i]) return false;
+			}
+			return true;
+		}
+		inline bool operator != (const ComponentMask& rhs) const { return !(*this == rhs); }
+	};
+
+	// Returns the mask of the given component types.
+	template <typename... Ts>
+	ComponentMask makeMask() {
+		ComponentMask result;
+		(result.set(componentId<Ts>()), ...);
+		return result;
+	}
+
+} // namespace wc::ecs
+
+template <>
+struct std::hash<wc::ecs::ComponentMask> {
+	size_t operator()(const wc::ecs::ComponentMask& mask) const {
+		uint64_t result = 0;
+		for (uint64_t word : mask.words) { result = (result * 0x9E3779B97F4A7C15ull) ^ word; }
+		return (size_t)result;
+	}
+};
+
+#endif // HVH_WC_ECS_COMPONENTINFO_H
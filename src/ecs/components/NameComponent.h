@@ -2,52 +2,141 @@
 #define HVH_WC_ECS_COMPONENTS_NAME_H
 
 #include "../entity.h"
+#include "stringtable.h"
 #include "tools/htable.hpp"
-#include "tools/fixedstring.h"
+#include "tools/sparse_soa.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+// Names are interned (see wc::strings), so each entity stores a handle rather than a copy of its name,
+// and entities with the same name share one copy of it.
+// Besides each entity's name, the index keeps every entity under its name (several entities can share one),
+// and every name in use in sorted order, so names can be searched by prefix or wildcard pattern
+// without looking at every entity.
 class NameComponent {
 public:
-	void setName(entity::ID id, FixedString<32> name) {
+	void setName(entity::ID id, const char* name) { setName(id, wc::strings::intern(name)); }
+	// Names an entity with an already interned string; handle 0 (the empty string) removes its name.
+	void setName(entity::ID id, wc::strings::Handle handle) {
 		removeName(id);
-		table.insert(id, name);
-		lookup.insert(name, id);
+		if (handle == 0) return;
+		names.insert(id, handle);
+		if (lookup.find(handle) == SIZE_MAX) {
+			const char* stored = wc::strings::view(handle);
+			sorted.insert(std::lower_bound(sorted.begin(), sorted.end(), stored, lessThan), { stored, handle });
+		}
+		lookup.insert(handle, id);
 	}
 
-	FixedString<32> getName(entity::ID id) {
-		size_t table_index = table.find(id);
-		if (table_index == SIZE_MAX) {
-			return "";
-		}
-		else {
-			return table.at<1>(table_index);
-		}
+	// Returns an entity's name, or an empty string if it doesn't have one.
+	const char* getName(entity::ID id) const {
+		size_t index = names.find(id);
+		return (index == SIZE_MAX) ? "" : wc::strings::view(names.at<1>(index));
 	}
 
-	bool hasName(entity::ID id) {
-		return (table.find(id) != SIZE_MAX);
+	bool hasName(entity::ID id) const {
+		return names.contains(id);
 	}
 
 	void removeName(entity::ID id) {
-		size_t table_index = table.find(id);
-		if (table_index == SIZE_MAX) return;
-		for (size_t lookup_index = lookup.find(id, true); lookup_index != SIZE_MAX; lookup_index = lookup.find(id, false)) {
-			if (lookup.at<1>(lookup_index) == id) {
-				lookup.erase_found();
+		size_t index = names.find(id);
+		if (index == SIZE_MAX) return;
+		wc::strings::Handle handle = names.at<1>(index);
+		for (auto it = lookup.equal_range(handle).begin(); *it != SIZE_MAX; ++it) {
+			if (lookup.at<1>(*it) == id) {
+				lookup.erase(it);
 				break;
 			}
 		}
-		table.erase_found();
+		names.erase(id);
+
+		// The last entity with this name is gone, so it's no longer searchable.
+		if (lookup.find(handle) == SIZE_MAX) {
+			auto it = std::lower_bound(sorted.begin(), sorted.end(), wc::strings::view(handle), lessThan);
+			if (it != sorted.end() && it->second == handle) sorted.erase(it);
+		}
 	}
 
-	entity::ID findWithName(FixedString<32> name, bool restart = true) {
-		size_t table_index = lookup.find(name, restart);
-		if (table_index == SIZE_MAX) return 0;
-		return lookup.get<1>(table_index);
+	// Returns an entity with the given name, or 0 if there isn't one.
+	// Names which have never been interned can't belong to anything, so they're rejected without touching the index.
+	entity::ID findWithName(const char* name) const {
+		wc::strings::Handle handle = wc::strings::find(name);
+		if (handle == 0) return 0;
+		size_t index = lookup.find(handle);
+		return (index == SIZE_MAX) ? 0 : lookup.at<1>(index);
+	}
+
+	// Fills 'result' with every entity that has the given name.
+	void findAllWithName(const char* name, std::vector<entity::ID>& result) const {
+		result.clear();
+		appendWithName(wc::strings::find(name), result);
+	}
+
+	// Fills 'result' with every entity whose name starts with 'prefix'.
+	// Complexity: O(log(names) + matching names + matching entities).
+	void findWithPrefix(const char* prefix, std::vector<entity::ID>& result) const {
+		result.clear();
+		size_t length = strlen(prefix);
+		for (auto it = firstWithPrefix(prefix, length); it != sorted.end() && strncmp(it->first, prefix, length) == 0; ++it) {
+			appendWithName(it->second, result);
+		}
+	}
+
+	// Fills 'result' with every entity whose name matches a wildcard pattern,
+	// where '*' matches any number of characters and '?' matches any one character.
+	// Only the names which start with the pattern's leading literal characters are checked against the whole pattern.
+	void findMatching(const char* pattern, std::vector<entity::ID>& result) const {
+		result.clear();
+		size_t length = strcspn(pattern, "*?");
+		for (auto it = firstWithPrefix(pattern, length); it != sorted.end() && strncmp(it->first, pattern, length) == 0; ++it) {
+			if (matches(it->first, pattern)) appendWithName(it->second, result);
+		}
+	}
+
+	// Returns the number of entities which have a name.
+	size_t size() const { return names.size(); }
+
+	// Returns true if 'name' matches a wildcard pattern ('*' for any number of characters, '?' for any one).
+	static bool matches(const char* name, const char* pattern) {
+		// Backtracks to just after the most recent '*', having it swallow one more character each time.
+		const char* starP = nullptr;
+		const char* starN = name;
+		while (*name) {
+			if (*pattern && (*pattern == '?' || *pattern == *name)) { ++name; ++pattern; }
+			else if (*pattern == '*') { starP = pattern++; starN = name; }
+			else if (starP) { pattern = starP + 1; name = ++starN; }
+			else return false;
+		}
+		while (*pattern == '*') { ++pattern; }
+		return (*pattern == '\0');
 	}
 
 private:
-	hvh::htable<entity::ID, FixedString<32>> table;
-	hvh::htable<FixedString<32>, entity::ID> lookup;
+	typedef std::pair<const char*, wc::strings::Handle> SortedName;
+	static bool lessThan(const SortedName& entry, const char* name) { return strcmp(entry.first, name) < 0; }
+
+	// Returns the first name which starts with the first 'length' characters of 'prefix' (or would come after them).
+	std::vector<SortedName>::const_iterator firstWithPrefix(const char* prefix, size_t length) const {
+		return std::lower_bound(sorted.begin(), sorted.end(), prefix, [length](const SortedName& entry, const char* text) {
+			return strncmp(entry.first, text, length) < 0;
+		});
+	}
+
+	void appendWithName(wc::strings::Handle handle, std::vector<entity::ID>& result) const {
+		if (handle == 0) return;
+		for (size_t index : lookup.equal_range(handle)) { result.push_back(lookup.at<1>(index)); }
+	}
+
+	// Each named entity's name.
+	hvh::sparse_soa<entity::ID, wc::strings::Handle> names;
+	// Every named entity, under its name.
+	hvh::htable<wc::strings::Handle, entity::ID> lookup;
+	// Every name which at least one entity has, in sorted order.
+	// Interned text is never freed, so the pointers stay valid.
+	std::vector<SortedName> sorted;
 };
 
-#endif // HVH_WC_ECS_COMPONENTS_NAME_H
\ No newline at end of file
+#endif // HVH_WC_ECS_COMPONENTS_NAME_H
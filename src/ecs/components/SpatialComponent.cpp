@@ -0,0 +1,243 @@
+#include "SpatialComponent.h"
+
+#include <cmath>
+
+namespace {
+
+	// Cell coordinates are packed into a key 21 bits per axis, so the grid is about two million cells across.
+	static constexpr int COORD_BITS = 21;
+	static constexpr int COORD_MAX = (1 << (COORD_BITS - 1)) - 1;
+	static constexpr uint64_t COORD_MASK = ((uint64_t)1 << COORD_BITS) - 1;
+
+	inline int cellCoord(float v, float invcellsize) {
+		float c = std::floor(v * invcellsize);
+		if (!(c > (float)-COORD_MAX)) return -COORD_MAX; // Also catches NaN.
+		if (c > (float)COORD_MAX) return COORD_MAX;
+		return (int)c;
+	}
+
+	inline uint64_t packCell(int x, int y, int z) {
+		return (((uint64_t)x & COORD_MASK) << (COORD_BITS * 2)) | (((uint64_t)y & COORD_MASK) << COORD_BITS) | ((uint64_t)z & COORD_MASK);
+	}
+
+	inline bool overlaps(const AABB& a, const AABB& b) {
+		return (a.minx <= b.maxx && a.maxx >= b.minx && a.miny <= b.maxy && a.maxy >= b.miny && a.minz <= b.maxz && a.maxz >= b.minz);
+	}
+
+	inline float halfExtent(const AABB& b) {
+		return std::max({ b.maxx - b.minx, b.maxy - b.miny, b.maxz - b.minz }) * 0.5f;
+	}
+
+} // namespace <anon>
+
+uint64_t SpatialComponent::cellOf(float x, float y, float z) const {
+	return packCell(cellCoord(x, invCellSize), cellCoord(y, invCellSize), cellCoord(z, invCellSize));
+}
+
+bool SpatialComponent::attach(entity::ID id, const AABB& bounds) {
+	uint64_t cell = cellOf(bounds);
+	if (!entries.insert(id, bounds, bounds, cell, 0)) return false;
+	if (!cells.insert(cell, id)) {
+		entries.erase(id);
+		return false;
+	}
+	maxHalfExtent = std::max(maxHalfExtent, halfExtent(bounds));
+	return true;
+}
+
+bool SpatialComponent::detach(entity::ID id) {
+	size_t index = entries.find(id);
+	if (index == SIZE_MAX) return false;
+	for (auto it = cells.equal_range(entries.at<CELL>(index)).begin(); *it != SIZE_MAX; ++it) {
+		if (cells.at<1>(*it) == id) {
+			cells.erase(it);
+			++erasedCells;
+			break;
+		}
+	}
+	entries.erase(id);
+	return true;
+}
+
+bool SpatialComponent::setBounds(entity::ID id, const AABB& bounds) {
+	size_t index = entries.find(id);
+	if (index == SIZE_MAX) return false;
+	entries.at<PENDING>(index) = bounds;
+	if (!entries.at<DIRTY>(index)) {
+		entries.at<DIRTY>(index) = 1;
+		dirty.push_back(id);
+	}
+	return true;
+}
+
+bool SpatialComponent::prepareUpdate() {
+	// Clearing each flag as it's seen drops the repeats left by entities which were detached and attached again.
+	moving.clear();
+	for (entity::ID id : dirty) {
+		size_t index = entries.find(id);
+		if (index == SIZE_MAX || !entries.at<DIRTY>(index)) continue;
+		entries.at<DIRTY>(index) = 0;
+		moving.push_back(Move{ index, entries.at<CELL>(index), 0 });
+	}
+	dirty.clear();
+	return !moving.empty();
+}
+
+float SpatialComponent::commit(Move& move) {
+	const AABB& bounds = entries.at<PENDING>(move.index);
+	entries.at<BOUNDS>(move.index) = bounds;
+	move.to = cellOf(bounds);
+	entries.at<CELL>(move.index) = move.to;
+	return halfExtent(bounds);
+}
+
+void SpatialComponent::finishUpdate() {
+	for (float extent : extents) { maxHalfExtent = std::max(maxHalfExtent, extent); }
+	for (const Move& move : moving) {
+		if (move.from == move.to) continue;
+		entity::ID id = entries.at<0>(move.index);
+		for (auto it = cells.equal_range(move.from).begin(); *it != SIZE_MAX; ++it) {
+			if (cells.at<1>(*it) == id) {
+				cells.erase(it);
+				++erasedCells;
+				break;
+			}
+		}
+		cells.insert(move.to, id);
+	}
+	// Erasing leaves a marker in the hashmap which lookups have to step over, and lookups of empty cells (most of them)
+	// only stop at a never-used slot, so once enough entities have moved, rebuild the hashmap.
+	if (erasedCells > cells.size()) {
+		cells.rehash();
+		erasedCells = 0;
+	}
+}
+
+template <typename FuncT>
+void SpatialComponent::forEachInCells(const int lo[3], const int hi[3], FuncT&& func) const {
+	// When a query covers more cells than there are entities, it's quicker to check every entity.
+	double numcells = (double)(hi[0] - lo[0] + 1) * (double)(hi[1] - lo[1] + 1) * (double)(hi[2] - lo[2] + 1);
+	if (numcells > (double)entries.size()) {
+		const entity::ID* ids = entries.data<0>();
+		const AABB* bounds = entries.data<BOUNDS>();
+		for (size_t i = 0; i < entries.size(); ++i) { func(ids[i], bounds[i]); }
+		return;
+	}
+	for (int x = lo[0]; x <= hi[0]; ++x) {
+		for (int y = lo[1]; y <= hi[1]; ++y) {
+			for (int z = lo[2]; z <= hi[2]; ++z) {
+				for (size_t i : cells.equal_range(packCell(x, y, z))) {
+					entity::ID id = cells.at<1>(i);
+					func(id, entries.at<BOUNDS>(entries.find(id)));
+				}
+			}
+		}
+	}
+}
+
+void SpatialComponent::queryBox(const AABB& box, std::vector<entity::ID>& result) const {
+	result.clear();
+	if (entries.size() == 0) return;
+	int lo[3] = { cellCoord(box.minx - maxHalfExtent, invCellSize), cellCoord(box.miny - maxHalfExtent, invCellSize), cellCoord(box.minz - maxHalfExtent, invCellSize) };
+	int hi[3] = { cellCoord(box.maxx + maxHalfExtent, invCellSize), cellCoord(box.maxy + maxHalfExtent, invCellSize), cellCoord(box.maxz + maxHalfExtent, invCellSize) };
+	forEachInCells(lo, hi, [&](entity::ID id, const AABB& bounds) {
+		if (overlaps(bounds, box)) result.push_back(id);
+	});
+}
+
+void SpatialComponent::querySphere(float x, float y, float z, float radius, std::vector<entity::ID>& result) const {
+	result.clear();
+	if (entries.size() == 0) return;
+	float reach = radius + maxHalfExtent;
+	int lo[3] = { cellCoord(x - reach, invCellSize), cellCoord(y - reach, invCellSize), cellCoord(z - reach, invCellSize) };
+	int hi[3] = { cellCoord(x + reach, invCellSize), cellCoord(y + reach, invCellSize), cellCoord(z + reach, invCellSize) };
+	float radius2 = radius * radius;
+	forEachInCells(lo, hi, [&](entity::ID id, const AABB& b) {
+		// The distance from the centre to the nearest point of the box.
+		float dx = std::max({ b.minx - x, 0.0f, x - b.maxx });
+		float dy = std::max({ b.miny - y, 0.0f, y - b.maxy });
+		float dz = std::max({ b.minz - z, 0.0f, z - b.maxz });
+		if (dx * dx + dy * dy + dz * dz <= radius2) result.push_back(id);
+	});
+}
+
+void SpatialComponent::raycast(float ox, float oy, float oz, float dx, float dy, float dz, float maxdistance, std::vector<RayHit>& result) const {
+	result.clear();
+	float length = std::sqrt(dx * dx + dy * dy + dz * dz);
+	if (entries.size() == 0 || length == 0.0f || !(maxdistance > 0.0f)) return;
+	float dir[3] = { dx / length, dy / length, dz / length };
+	float origin[3] = { ox, oy, oz };
+	float inv[3] = { 1.0f / dir[0], 1.0f / dir[1], 1.0f / dir[2] };
+
+	auto test = [&](entity::ID id, const AABB& b) {
+		// Slab test; infinities from axis-aligned rays work out, as long as the origin isn't exactly on a face.
+		float t0 = 0.0f, t1 = maxdistance;
+		const float mins[3] = { b.minx, b.miny, b.minz }, maxs[3] = { b.maxx, b.maxy, b.maxz };
+		for (int a = 0; a < 3; ++a) {
+			float tnear = (mins[a] - origin[a]) * inv[a], tfar = (maxs[a] - origin[a]) * inv[a];
+			if (tnear > tfar) std::swap(tnear, tfar);
+			t0 = std::max(t0, tnear);
+			t1 = std::min(t1, tfar);
+		}
+		if (t0 <= t1) result.push_back(RayHit{ id, t0 });
+	};
+
+	// Walk the cells along the ray (Amanatides & Woo), checking every cell within reach of each one,
+	// since an entity filed under a neighbouring cell may stick out into the ray's path.
+	int reach = (int)std::ceil(maxHalfExtent * invCellSize);
+	int cell[3], step[3], last[3];
+	float tmax[3], tdelta[3];
+	for (int a = 0; a < 3; ++a) {
+		cell[a] = cellCoord(origin[a], invCellSize);
+		last[a] = cellCoord(origin[a] + dir[a] * maxdistance, invCellSize);
+		step[a] = (dir[a] > 0.0f) ? 1 : -1;
+		float boundary = (float)(cell[a] + (step[a] > 0 ? 1 : 0)) * cellSize;
+		tmax[a] = (dir[a] != 0.0f) ? (boundary - origin[a]) / dir[a] : INFINITY;
+		tdelta[a] = (dir[a] != 0.0f) ? cellSize / std::abs(dir[a]) : INFINITY;
+	}
+
+	// A long ray through a fine grid can visit more cells than there are entities; then it's quicker to check them all.
+	double steps = (double)std::abs(last[0] - cell[0]) + std::abs(last[1] - cell[1]) + std::abs(last[2] - cell[2]) + 1;
+	double side = (double)(reach * 2 + 1);
+	if (steps * side * side * side > (double)entries.size()) {
+		const entity::ID* ids = entries.data<0>();
+		const AABB* bounds = entries.data<BOUNDS>();
+		for (size_t i = 0; i < entries.size(); ++i) { test(ids[i], bounds[i]); }
+	}
+	else {
+		visited.clear();
+		while (true) {
+			for (int x = cell[0] - reach; x <= cell[0] + reach; ++x) {
+				for (int y = cell[1] - reach; y <= cell[1] + reach; ++y) {
+					for (int z = cell[2] - reach; z <= cell[2] + reach; ++z) {
+						uint64_t key = packCell(x, y, z);
+						if (reach > 0) {
+							if (visited.find(key) != SIZE_MAX) continue;
+							visited.insert(key);
+						}
+						for (size_t i : cells.equal_range(key)) {
+							entity::ID id = cells.at<1>(i);
+							test(id, entries.at<BOUNDS>(entries.find(id)));
+						}
+					}
+				}
+			}
+			if (cell[0] == last[0] && cell[1] == last[1] && cell[2] == last[2]) break;
+			int a = (tmax[0] < tmax[1]) ? ((tmax[0] < tmax[2]) ? 0 : 2) : ((tmax[1] < tmax[2]) ? 1 : 2);
+			if (tmax[a] > maxdistance) break;
+			cell[a] += step[a];
+			tmax[a] += tdelta[a];
+		}
+	}
+
+	std::sort(result.begin(), result.end(), [](const RayHit& a, const RayHit& b) { return a.distance < b.distance; });
+}
+
+namespace wc::ecs {
+
+	SpatialComponent& spatial() {
+		static SpatialComponent* result = new SpatialComponent();
+		return *result;
+	}
+
+} // namespace wc::ecs
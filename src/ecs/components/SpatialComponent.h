@@ -0,0 +1,136 @@
+#ifndef HVH_WC_ECS_COMPONENTS_SPATIAL_H
+#define HVH_WC_ECS_COMPONENTS_SPATIAL_H
+
+#include "../entity.h"
+#include "tools/htable.hpp"
+#include "tools/sparse_soa.hpp"
+#include "tools/executor.hpp"
+
+#include <algorithm>
+#include <vector>
+
+// An axis-aligned bounding box.
+struct AABB {
+	float minx, miny, minz;
+	float maxx, maxy, maxz;
+};
+
+// Spatial index for entities, as a loose uniform grid.
+// Each entity is filed under the grid cell which holds the centre of its bounds, in a hash table keyed by cell,
+// so only cells which hold something use any memory and the world has no fixed size.
+// Queries widen their search by the largest half-size of any entity's bounds (that's what makes the grid "loose"),
+// so an entity never needs to be filed under more than one cell.
+// Moving entities is batched: 'setBounds' only records the new bounds, and 'update' files every entity which moved at once,
+// working out their new cells in parallel. Queries see every entity where it was at the last update.
+class SpatialComponent {
+public:
+	struct RayHit {
+		entity::ID id;
+		float distance;
+	};
+
+	// 'cellsize' should be about the size of a typical entity, or of a typical query, whichever is larger.
+	SpatialComponent(float cellsize = 8.0f) : cellSize(cellsize), invCellSize(1.0f / cellsize) {}
+
+	// Adds an entity to the index; it can be found by queries straight away.
+	// Returns false if the entity is already in the index or a memory allocation failure occurs.
+	bool attach(entity::ID id, const AABB& bounds);
+	// Removes an entity from the index.
+	bool detach(entity::ID id);
+	bool has(entity::ID id) const { return entries.contains(id); }
+	// Returns an entity's bounds as of the last update (or attach), or nullptr if it isn't in the index.
+	const AABB* getBounds(entity::ID id) const {
+		size_t index = entries.find(id);
+		return (index == SIZE_MAX) ? nullptr : &entries.at<BOUNDS>(index);
+	}
+	size_t size() const { return entries.size(); }
+
+	// Gives an entity new bounds, which take effect at the next update.
+	// Returns false if the entity isn't in the index.
+	bool setBounds(entity::ID id, const AABB& bounds);
+
+	// update(exec)
+	// Moves every entity given new bounds since the last update into its new cell.
+	// The new cells are worked out in parallel on 'exec'; only entities which changed cells touch the hash table.
+	template <typename ExecT>
+	void update(ExecT& exec) {
+		static constexpr size_t GRAIN = 2048;
+		if (!prepareUpdate()) return;
+		size_t numtasks = (moving.size() + GRAIN - 1) / GRAIN;
+		extents.assign(numtasks, maxHalfExtent);
+		exec.run(numtasks, [&](size_t task) {
+			size_t last = std::min(moving.size(), (task + 1) * GRAIN);
+			for (size_t i = task * GRAIN; i < last; ++i) { extents[task] = std::max(extents[task], commit(moving[i])); }
+		});
+		finishUpdate();
+	}
+	void update() { hvh::serial_executor exec; update(exec); }
+
+	// Fills 'result' with every entity whose bounds overlap 'box'.
+	void queryBox(const AABB& box, std::vector<entity::ID>& result) const;
+	// Fills 'result' with every entity whose bounds overlap a sphere.
+	void querySphere(float x, float y, float z, float radius, std::vector<entity::ID>& result) const;
+	// Fills 'result' with every entity whose bounds are hit by a ray within 'maxdistance' of its origin, nearest first.
+	// The direction doesn't need to be normalized; distances are measured in world units either way.
+	// Uses scratch space kept by the index, so only one thread may raycast at a time.
+	void raycast(float ox, float oy, float oz, float dx, float dy, float dz, float maxdistance, std::vector<RayHit>& result) const;
+
+private:
+	// The columns of 'entries'.
+	enum { BOUNDS = 1, PENDING, CELL, DIRTY };
+
+	struct Move {
+		size_t index;
+		uint64_t from;
+		uint64_t to;
+	};
+
+	uint64_t cellOf(float x, float y, float z) const;
+	uint64_t cellOf(const AABB& bounds) const {
+		return cellOf((bounds.minx + bounds.maxx) * 0.5f, (bounds.miny + bounds.maxy) * 0.5f, (bounds.minz + bounds.maxz) * 0.5f);
+	}
+	// Calls 'func(entity::ID, const AABB&)' for every entity filed under a cell within the given range of cells (inclusive),
+	// or for every entity at all if that would be cheaper.
+	template <typename FuncT>
+	void forEachInCells(const int lo[3], const int hi[3], FuncT&& func) const;
+
+	// Filters the dirty list down to entities which are still in the index and have pending bounds.
+	// Returns false if there's nothing to do.
+	bool prepareUpdate();
+	// Makes an entity's pending bounds current and works out its new cell. Returns its largest half-size.
+	// Safe to call on different entities from several threads at once.
+	float commit(Move& move);
+	// Refiles the entities which changed cells.
+	void finishUpdate();
+
+	float cellSize;
+	float invCellSize;
+	// The largest half-size of any entity's bounds on any axis, which queries widen their search by.
+	// It only ever grows, so a single huge entity makes every query look at more cells.
+	float maxHalfExtent = 0.0f;
+
+	hvh::sparse_soa<entity::ID, AABB, AABB, uint64_t, uint8_t> entries;
+	// Every entity in the index, under the key of its cell.
+	hvh::htable<uint64_t, entity::ID> cells;
+	// Number of erasures from 'cells' since its hashmap was last rebuilt.
+	size_t erasedCells = 0;
+	// Entities given new bounds since the last update, possibly with repeats and entities which have since been detached.
+	std::vector<entity::ID> dirty;
+	// Scratch space for update.
+	std::vector<Move> moving;
+	std::vector<float> extents;
+	// Scratch space for raycast: the cells a ray has already checked.
+	mutable hvh::htable<uint64_t> visited;
+};
+
+namespace wc::ecs {
+
+	// The engine's spatial index, updated once per logical frame (after deferred commands are applied).
+	SpatialComponent& spatial();
+
+	// Exposes the engine's spatial index to Lua as 'SANDBOX.spatial'.
+	bool initSpatialLua();
+
+} // namespace wc::ecs
+
+#endif // HVH_WC_ECS_COMPONENTS_SPATIAL_H
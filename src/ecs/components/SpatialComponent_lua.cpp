@@ -0,0 +1,96 @@
+#include "SpatialComponent.h"
+
+#include "lua/luasystem.h"
+
+#include <vector>
+
+namespace {
+
+	// Pushes an array of entities.
+	int pushEntities(lua_State* L, const std::vector<entity::ID>& ids) {
+		lua_createtable(L, (int)ids.size(), 0);
+		for (size_t i = 0; i < ids.size(); ++i) {
+			entity::pushLua(L, ids[i]);
+			lua_rawseti(L, -2, (int)i + 1);
+		}
+		return 1;
+	}
+
+	AABB checkBox(lua_State* L, int first) {
+		return AABB{
+			(float)luaL_checknumber(L, first), (float)luaL_checknumber(L, first + 1), (float)luaL_checknumber(L, first + 2),
+			(float)luaL_checknumber(L, first + 3), (float)luaL_checknumber(L, first + 4), (float)luaL_checknumber(L, first + 5) };
+	}
+
+	// Results are reused between calls, since scripts may query every frame.
+	std::vector<entity::ID> found;
+	std::vector<SpatialComponent::RayHit> hits;
+
+} // namespace <anon>
+
+namespace wc::ecs {
+
+	bool initSpatialLua() {
+		lua_State* L = wc::lua::getState();
+
+		lua_newtable(L); { // Create the 'spatial' table.
+
+			// spatial.attach(entity, minx, miny, minz, maxx, maxy, maxz)
+			lua_pushcfunction(L, [](lua_State* L) {
+				entity::ID* id = (entity::ID*)luaL_checkudata(L, 1, "entity");
+				lua_pushboolean(L, spatial().attach(*id, checkBox(L, 2)));
+				return 1;
+			}); lua_setfield(L, -2, "attach");
+
+			// spatial.detach(entity)
+			lua_pushcfunction(L, [](lua_State* L) {
+				entity::ID* id = (entity::ID*)luaL_checkudata(L, 1, "entity");
+				lua_pushboolean(L, spatial().detach(*id));
+				return 1;
+			}); lua_setfield(L, -2, "detach");
+
+			// spatial.set_bounds(entity, minx, miny, minz, maxx, maxy, maxz); takes effect next frame.
+			lua_pushcfunction(L, [](lua_State* L) {
+				entity::ID* id = (entity::ID*)luaL_checkudata(L, 1, "entity");
+				lua_pushboolean(L, spatial().setBounds(*id, checkBox(L, 2)));
+				return 1;
+			}); lua_setfield(L, -2, "set_bounds");
+
+			// spatial.query_box(minx, miny, minz, maxx, maxy, maxz) returns an array of entities.
+			lua_pushcfunction(L, [](lua_State* L) {
+				spatial().queryBox(checkBox(L, 1), found);
+				return pushEntities(L, found);
+			}); lua_setfield(L, -2, "query_box");
+
+			// spatial.query_sphere(x, y, z, radius) returns an array of entities.
+			lua_pushcfunction(L, [](lua_State* L) {
+				spatial().querySphere((float)luaL_checknumber(L, 1), (float)luaL_checknumber(L, 2), (float)luaL_checknumber(L, 3),
+					(float)luaL_checknumber(L, 4), found);
+				return pushEntities(L, found);
+			}); lua_setfield(L, -2, "query_sphere");
+
+			// spatial.raycast(ox, oy, oz, dx, dy, dz, maxdistance) returns the nearest entity hit and its distance, or nil.
+			lua_pushcfunction(L, [](lua_State* L) {
+				spatial().raycast((float)luaL_checknumber(L, 1), (float)luaL_checknumber(L, 2), (float)luaL_checknumber(L, 3),
+					(float)luaL_checknumber(L, 4), (float)luaL_checknumber(L, 5), (float)luaL_checknumber(L, 6),
+					(float)luaL_checknumber(L, 7), hits);
+				if (hits.empty()) return 0;
+				entity::pushLua(L, hits[0].id);
+				lua_pushnumber(L, hits[0].distance);
+				return 2;
+			}); lua_setfield(L, -2, "raycast");
+
+		}
+		lua_setglobal(L, "SPATIAL");
+
+		lua_getglobal(L, "SANDBOX");
+		lua_getglobal(L, "readonly");
+		lua_getglobal(L, "SPATIAL");
+		lua_call(L, 1, 1);
+		lua_setfield(L, -2, "spatial");
+		lua_pop(L, 1);
+
+		return true;
+	}
+
+} // namespace wc::ecs
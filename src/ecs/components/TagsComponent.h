@@ -0,0 +1,188 @@
+#ifndef HVH_WC_ECS_COMPONENTS_TAGS_H
+#define HVH_WC_ECS_COMPONENTS_TAGS_H
+
+#include "../entity.h"
+#include "tools/htable.hpp"
+#include "tools/sparse_soa.hpp"
+#include "tools/bitmap.hpp"
+#include "tools/fixedstring.h"
+
+#include <algorithm>
+#include <bit>
+#include <span>
+#include <vector>
+
+// Entities can be given any number of tags, which are short strings.
+// Each tag is interned the first time it's used, so it's stored and compared as a small integer.
+// Every entity's tags are kept as a bitset (the first 64 tags fit in one word; the rest go in a list),
+// so checking one entity's tags never hashes, and every tag keeps a compressed bitmap of the entities which have it,
+// so finding "every entity tagged A and B but not C" is a handful of bitmap operations rather than a scan.
+class TagsComponent {
+public:
+	typedef uint32_t TagId;
+	static constexpr TagId NO_TAG = UINT32_MAX;
+	// Tags with IDs below this are stored in each entity's bitset word.
+	static constexpr TagId INLINE_TAGS = 64;
+
+	// Returns the ID of a tag, interning it the first time it's seen.
+	TagId intern(const char* tag) {
+		TagId result = find(tag);
+		if (result != NO_TAG) return result;
+		result = (TagId)tagNames.size();
+		tagNames.emplace_back(tag);
+		tagLookup.insert(tagNames.back(), result);
+		tagged.emplace_back();
+		return result;
+	}
+
+	// Returns the ID of a tag, or NO_TAG if it has never been used.
+	TagId find(const char* tag) const {
+		size_t index = tagLookup.find(tag);
+		return (index == SIZE_MAX) ? NO_TAG : tagLookup.at<1>(index);
+	}
+
+	fixedstring<32> tagName(TagId tag) const { return (tag < tagNames.size()) ? tagNames[tag] : ""; }
+	size_t numTags() const { return tagNames.size(); }
+
+	// Gives an entity a tag.
+	// Returns false if the entity already had it.
+	bool addTag(entity::ID id, TagId tag) {
+		if (tag >= tagNames.size()) return false;
+		size_t index = table.find(id);
+		if (index == SIZE_MAX) {
+			if (!table.insert(id, 0, std::vector<TagId>())) return false;
+			index = table.find(id);
+			uint32_t e = entity::index(id);
+			if (e >= idOfIndex.size()) idOfIndex.resize((size_t)e + 1, 0);
+			idOfIndex[e] = id;
+		}
+		if (tag < INLINE_TAGS) {
+			uint64_t bit = (uint64_t)1 << tag;
+			if (table.at<1>(index) & bit) return false;
+			table.at<1>(index) |= bit;
+		}
+		else {
+			std::vector<TagId>& extra = table.at<2>(index);
+			if (std::find(extra.begin(), extra.end(), tag) != extra.end()) return false;
+			extra.push_back(tag);
+		}
+		tagged[tag].insert(entity::index(id));
+		return true;
+	}
+	bool addTag(entity::ID id, const char* tag) { return addTag(id, intern(tag)); }
+
+	// Takes a tag away from an entity.
+	// Returns false if the entity didn't have it.
+	bool removeTag(entity::ID id, TagId tag) {
+		size_t index = table.find(id);
+		if (index == SIZE_MAX || tag >= tagNames.size()) return false;
+		if (tag < INLINE_TAGS) {
+			uint64_t bit = (uint64_t)1 << tag;
+			if (!(table.at<1>(index) & bit)) return false;
+			table.at<1>(index) &= ~bit;
+		}
+		else {
+			std::vector<TagId>& extra = table.at<2>(index);
+			auto it = std::find(extra.begin(), extra.end(), tag);
+			if (it == extra.end()) return false;
+			*it = extra.back();
+			extra.pop_back();
+		}
+		tagged[tag].erase(entity::index(id));
+		if (table.at<1>(index) == 0 && table.at<2>(index).empty()) table.erase(id);
+		return true;
+	}
+	bool removeTag(entity::ID id, const char* tag) { return removeTag(id, find(tag)); }
+
+	bool hasTag(entity::ID id, TagId tag) const {
+		size_t index = table.find(id);
+		if (index == SIZE_MAX) return false;
+		if (tag < INLINE_TAGS) return (table.at<1>(index) >> tag) & 1;
+		const std::vector<TagId>& extra = table.at<2>(index);
+		return std::find(extra.begin(), extra.end(), tag) != extra.end();
+	}
+	bool hasTag(entity::ID id, const char* tag) const { return hasTag(id, find(tag)); }
+
+	// Fills 'result' with every tag an entity has.
+	void getTags(entity::ID id, std::vector<TagId>& result) const {
+		result.clear();
+		size_t index = table.find(id);
+		if (index == SIZE_MAX) return;
+		for (uint64_t bits = table.at<1>(index); bits != 0; bits &= bits - 1) { result.push_back((TagId)std::countr_zero(bits)); }
+		result.insert(result.end(), table.at<2>(index).begin(), table.at<2>(index).end());
+	}
+
+	// Takes every tag away from an entity; call this when it's destroyed.
+	// Only the bitmaps of tags which the entity actually has are touched.
+	void removeAll(entity::ID id) {
+		size_t index = table.find(id);
+		if (index == SIZE_MAX) return;
+		uint32_t e = entity::index(id);
+		for (uint64_t bits = table.at<1>(index); bits != 0; bits &= bits - 1) { tagged[std::countr_zero(bits)].erase(e); }
+		for (TagId tag : table.at<2>(index)) { tagged[tag].erase(e); }
+		table.erase(id);
+	}
+
+	// Returns the set of entity indices (see entity::index) which have a tag.
+	// Combine these with hvh::bitmap's &, | and - operators for queries which 'findAll' doesn't cover,
+	// then turn the result into IDs with 'toIds'.
+	const hvh::bitmap& entitiesWith(TagId tag) const {
+		static const hvh::bitmap none;
+		return (tag < tagged.size()) ? tagged[tag] : none;
+	}
+
+	// findAll(all, any, none, result)
+	// Fills 'result' with every entity which has all of the tags in 'all', at least one of the tags in 'any'
+	// (unless 'any' is empty), and none of the tags in 'none'. If 'all' and 'any' are both empty, nothing matches.
+	// The rarest of the 'all' tags is used as the starting point, so the work done is proportional to the smallest set involved.
+	void findAll(std::span<const TagId> all, std::span<const TagId> any, std::span<const TagId> none, std::vector<entity::ID>& result) const {
+		result.clear();
+		if (all.empty() && any.empty()) return;
+
+		hvh::bitmap matches;
+		if (!all.empty()) {
+			TagId rarest = all[0];
+			for (TagId tag : all) {
+				if (entitiesWith(tag).size() < entitiesWith(rarest).size()) rarest = tag;
+			}
+			matches = entitiesWith(rarest);
+			for (TagId tag : all) {
+				if (matches.empty()) return;
+				if (tag != rarest) matches &= entitiesWith(tag);
+			}
+		}
+		if (!any.empty()) {
+			hvh::bitmap either;
+			for (TagId tag : any) { either |= entitiesWith(tag); }
+			if (all.empty()) matches = std::move(either);
+			else matches &= either;
+		}
+		for (TagId tag : none) {
+			if (matches.empty()) return;
+			matches -= entitiesWith(tag);
+		}
+		toIds(matches, result);
+	}
+
+	// Fills 'result' with the IDs of the entities in a set of entity indices made from 'entitiesWith'.
+	void toIds(const hvh::bitmap& indices, std::vector<entity::ID>& result) const {
+		result.clear();
+		result.reserve(indices.size());
+		indices.for_each([&](uint32_t e) { result.push_back(idOfIndex[e]); });
+	}
+
+	// Returns the number of entities which have at least one tag.
+	size_t size() const { return table.size(); }
+
+private:
+	hvh::htable<fixedstring<32>, TagId> tagLookup;
+	std::vector<fixedstring<32>> tagNames;
+	// The entity indices which have each tag.
+	std::vector<hvh::bitmap> tagged;
+	// Each tagged entity's inline tag bits, and any tags with IDs of INLINE_TAGS or more.
+	hvh::sparse_soa<entity::ID, uint64_t, std::vector<TagId>> table;
+	// The ID of the entity last tagged at each entity index, so query results can be turned back into IDs.
+	std::vector<entity::ID> idOfIndex;
+};
+
+#endif // HVH_WC_ECS_COMPONENTS_TAGS_H
@@ -0,0 +1,244 @@
+#include "TransformComponent.h"
+
+#include <algorithm>
+#include <cstring>
+
+Float4x4 Float4x4::compose(const Transform& t) {
+	// The rotation matrix of a unit quaternion, for row vectors (as DirectX::XMMatrixRotationQuaternion), with each row scaled.
+	float xx = t.qx * t.qx, yy = t.qy * t.qy, zz = t.qz * t.qz;
+	float xy = t.qx * t.qy, xz = t.qx * t.qz, yz = t.qy * t.qz;
+	float xw = t.qx * t.qw, yw = t.qy * t.qw, zw = t.qz * t.qw;
+	return Float4x4{ {
+		{ (1.0f - 2.0f * (yy + zz)) * t.sx, 2.0f * (xy + zw) * t.sx, 2.0f * (xz - yw) * t.sx, 0.0f },
+		{ 2.0f * (xy - zw) * t.sy, (1.0f - 2.0f * (xx + zz)) * t.sy, 2.0f * (yz + xw) * t.sy, 0.0f },
+		{ 2.0f * (xz + yw) * t.sz, 2.0f * (yz - xw) * t.sz, (1.0f - 2.0f * (xx + yy)) * t.sz, 0.0f },
+		{ t.x, t.y, t.z, 1.0f } } };
+}
+
+Float4x4 Float4x4::multiply(const Float4x4& l, const Float4x4& r) {
+	Float4x4 result;
+	for (int i = 0; i < 4; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			result.m[i][j] = l.m[i][0] * r.m[0][j] + l.m[i][1] * r.m[1][j] + l.m[i][2] * r.m[2][j];
+		}
+		result.m[i][3] = 0.0f;
+	}
+	for (int j = 0; j < 3; ++j) { result.m[3][j] += r.m[3][j]; }
+	result.m[3][3] = 1.0f;
+	return result;
+}
+
+bool TransformComponent::attach(entity::ID id, const Transform& local, entity::ID parent) {
+	if (has(id) || (parent != 0 && !has(parent))) return false;
+	uint32_t tree = (uint32_t)trees.size();
+	uint32_t parentRow = NONE;
+	if (parent != 0) {
+		// The new row goes on the end of its parent's block, so that block has to be the last one.
+		tree = rows.at<TREE>(findRow(parent));
+		if (!moveToEnd(tree)) return false;
+		parentRow = (uint32_t)findRow(parent);
+	}
+	uint32_t row = (uint32_t)rows.size();
+	if (!rows.push_back(id, local, Float4x4::identity(), parent, parentRow, tree, (uint8_t)1, (uint32_t)0)) return false;
+	if (!lookup.insert(id, row)) {
+		rows.pop_back();
+		return false;
+	}
+	if (parent == 0) trees.push_back(Tree{ row, 1, 1 });
+	else {
+		++trees[tree].count;
+		trees[tree].dirty = 1;
+	}
+	return true;
+}
+
+size_t TransformComponent::detachMany(std::span<const entity::ID> ids) {
+	work.clear();
+	size_t result = 0;
+	for (entity::ID id : ids) {
+		// Repeats aren't found the second time, since the lookup entry goes with the first.
+		size_t row = findRow(id);
+		if (row == SIZE_MAX) continue;
+		lookup.erase(id);
+		work.push_back(rows.at<TREE>(row));
+		killRow((uint32_t)row);
+		++result;
+	}
+	if (result == 0) return 0;
+
+	// Orphans become roots where they are; rows only have to come after their parents, so nothing needs to move.
+	std::sort(work.begin(), work.end());
+	work.erase(std::unique(work.begin(), work.end()), work.end());
+	const entity::ID* idcolumn = rows.data<ID>();
+	entity::ID* parentIds = rows.data<PARENT_ID>();
+	uint32_t* parents = rows.data<PARENT>();
+	uint8_t* dirty = rows.data<DIRTY>();
+	for (uint32_t tree : work) {
+		for (uint32_t i = trees[tree].first; i < trees[tree].first + trees[tree].count; ++i) {
+			if (parents[i] == NONE || idcolumn[parents[i]] != 0) continue;
+			parentIds[i] = 0;
+			parents[i] = NONE;
+			dirty[i] = 1;
+			trees[tree].dirty = 1;
+		}
+	}
+	return result;
+}
+
+bool TransformComponent::setParent(entity::ID id, entity::ID parent) {
+	size_t row = findRow(id);
+	if (row == SIZE_MAX) return false;
+	if (parent != 0) {
+		if (!has(parent)) return false;
+		// Refuse to make a loop.
+		for (entity::ID ancestor = parent; ancestor != 0; ancestor = rows.at<PARENT_ID>(findRow(ancestor))) {
+			if (ancestor == id) return false;
+		}
+	}
+	if (rows.at<PARENT_ID>(row) == parent) return true;
+	uint32_t tree = rows.at<TREE>(row);
+	uint32_t parentRow = (parent == 0) ? NONE : (uint32_t)findRow(parent);
+
+	// Becoming a root, or moving under an earlier row of the same block, keeps every parent ahead of its children.
+	if (parent == 0 || (rows.at<TREE>(parentRow) == tree && parentRow < row)) {
+		rows.at<PARENT_ID>(row) = parent;
+		rows.at<PARENT>(row) = parentRow;
+		rows.at<DIRTY>(row) = 1;
+		trees[tree].dirty = 1;
+		return true;
+	}
+
+	// Otherwise the entity and everything beneath it go on the end of the new parent's block.
+	// Descendants always come after the entity in its block, and stay in the same order, so one pass finds and moves them all.
+	uint32_t target = rows.at<TREE>(parentRow);
+	if (!moveToEnd(target)) return false;
+	uint32_t first = (uint32_t)findRow(id), last = trees[tree].first + trees[tree].count;
+	if (!makeRoom(last - first)) return false;
+	uint32_t* order = rows.data<ORDER>();
+	const uint32_t* parents = rows.data<PARENT>();
+	for (uint32_t i = first; i < last; ++i) { order[i] = NONE; }
+	rows.at<PARENT_ID>(first) = parent;
+	rows.at<DIRTY>(first) = 1;
+	copyToEnd(first, (uint32_t)findRow(parent), target);
+	for (uint32_t i = first + 1; i < last; ++i) {
+		uint32_t p = parents[i];
+		if (p == NONE || p < first || order[p] == NONE) continue;
+		copyToEnd(i, order[p], target);
+	}
+	trees[target].count = (uint32_t)rows.size() - trees[target].first;
+	trees[target].dirty = 1;
+	return true;
+}
+
+entity::ID TransformComponent::getParent(entity::ID id) const {
+	size_t row = findRow(id);
+	return (row == SIZE_MAX) ? 0 : rows.at<PARENT_ID>(row);
+}
+
+bool TransformComponent::setLocal(entity::ID id, const Transform& local) {
+	size_t row = findRow(id);
+	if (row == SIZE_MAX) return false;
+	rows.at<LOCAL>(row) = local;
+	rows.at<DIRTY>(row) = 1;
+	trees[rows.at<TREE>(row)].dirty = 1;
+	return true;
+}
+
+bool TransformComponent::makeRoom(size_t count) {
+	if (rows.size() + count <= rows.capacity()) return true;
+	return rows.reserve(std::max(rows.size() + count, rows.capacity() * 2));
+}
+
+bool TransformComponent::moveToEnd(uint32_t tree) {
+	uint32_t first = trees[tree].first, last = first + trees[tree].count;
+	if (last == rows.size()) return true;
+	if (!makeRoom(last - first)) return false;
+	uint32_t start = (uint32_t)rows.size();
+	const entity::ID* idcolumn = rows.data<ID>();
+	const uint32_t* parents = rows.data<PARENT>();
+	const uint32_t* order = rows.data<ORDER>();
+	for (uint32_t i = first; i < last; ++i) {
+		if (idcolumn[i] == 0) continue;
+		// Parents come first, so a parent has always been moved (and its order column set) before its children.
+		copyToEnd(i, (parents[i] == NONE) ? NONE : order[parents[i]], tree);
+	}
+	trees[tree].first = start;
+	trees[tree].count = (uint32_t)rows.size() - start;
+	return true;
+}
+
+void TransformComponent::copyToEnd(uint32_t row, uint32_t parent, uint32_t tree) {
+	uint32_t result = (uint32_t)rows.size();
+	entity::ID id = rows.at<ID>(row);
+	// There's room, so the columns don't move while the row is copied out of them.
+	rows.push_back(id, rows.at<LOCAL>(row), rows.at<WORLD>(row), rows.at<PARENT_ID>(row), parent, tree, rows.at<DIRTY>(row), (uint32_t)0);
+	lookup.at<1>(lookup.find(id)) = result;
+	rows.at<ORDER>(row) = result;
+	killRow(row);
+}
+
+void TransformComponent::killRow(uint32_t row) {
+	rows.at<ID>(row) = 0;
+	rows.at<PARENT_ID>(row) = 0;
+	rows.at<PARENT>(row) = NONE;
+	rows.at<DIRTY>(row) = 0;
+	++deadRows;
+}
+
+void TransformComponent::compact() {
+	uint32_t count = (uint32_t)rows.size();
+	const entity::ID* idcolumn = rows.data<ID>();
+	uint32_t* parents = rows.data<PARENT>();
+	uint32_t* order = rows.data<ORDER>();
+	uint32_t next = 0;
+	for (uint32_t i = 0; i < count; ++i) { order[i] = (idcolumn[i] != 0) ? next++ : NONE; }
+	for (uint32_t i = 0; i < count; ++i) {
+		if (parents[i] != NONE) parents[i] = order[parents[i]];
+	}
+	rows.erase_if<ID>([](entity::ID id) { return id == 0; });
+
+	// Blocks are still contiguous and in the same order, so they're renumbered as they're reached; empty ones are dropped.
+	idcolumn = rows.data<ID>();
+	uint32_t* treeOf = rows.data<TREE>();
+	remap.assign(trees.size(), NONE);
+	compacted.clear();
+	for (uint32_t i = 0; i < (uint32_t)rows.size(); ++i) {
+		uint32_t& tree = remap[treeOf[i]];
+		if (tree == NONE) {
+			tree = (uint32_t)compacted.size();
+			compacted.push_back(Tree{ i, 0, trees[treeOf[i]].dirty });
+		}
+		++compacted[tree].count;
+		treeOf[i] = tree;
+		lookup.at<1>(lookup.find(idcolumn[i])) = i;
+	}
+	trees.swap(compacted);
+	deadRows = 0;
+}
+
+void TransformComponent::updateTree(uint32_t tree) {
+	uint32_t first = trees[tree].first, last = first + trees[tree].count;
+	const uint32_t* parents = rows.data<PARENT>();
+	const Transform* local = rows.data<LOCAL>();
+	Float4x4* world = rows.data<WORLD>();
+	uint8_t* dirty = rows.data<DIRTY>();
+
+	// Parents come before their children, so a parent's flag and world matrix are always final by the time its children are reached.
+	for (uint32_t i = first; i < last; ++i) {
+		uint32_t parent = parents[i];
+		if (parent != NONE) dirty[i] |= dirty[parent];
+		if (!dirty[i]) continue;
+		world[i] = (parent == NONE) ? Float4x4::compose(local[i]) : Float4x4::multiply(Float4x4::compose(local[i]), world[parent]);
+	}
+	memset(dirty + first, 0, last - first);
+	trees[tree].dirty = 0;
+}
+
+namespace wc::ecs {
+
+	TransformComponent& transforms() {
+		static TransformComponent* result = new TransformComponent();
+		return *result;
+	}
+
+} // namespace wc::ecs
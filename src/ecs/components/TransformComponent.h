@@ -0,0 +1,169 @@
+#ifndef HVH_WC_ECS_COMPONENTS_TRANSFORM_H
+#define HVH_WC_ECS_COMPONENTS_TRANSFORM_H
+
+#include "../entity.h"
+#include "tools/htable.hpp"
+#include "tools/soa.hpp"
+#include "tools/executor.hpp"
+
+#include <algorithm>
+#include <span>
+#include <vector>
+
+// A position, rotation (unit quaternion) and scale, relative to an entity's parent.
+struct Transform {
+	float x = 0.0f, y = 0.0f, z = 0.0f;
+	float qx = 0.0f, qy = 0.0f, qz = 0.0f, qw = 1.0f;
+	float sx = 1.0f, sy = 1.0f, sz = 1.0f;
+};
+
+// A row-major affine matrix, laid out like DirectX::XMFLOAT4X4: points are row vectors and the translation is in the last row.
+// A child's world matrix is its local matrix times its parent's world matrix.
+struct Float4x4 {
+	float m[4][4];
+
+	static Float4x4 identity() { return Float4x4{ { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, 0, 1 } } }; }
+	// Builds the matrix which scales, then rotates, then translates.
+	static Float4x4 compose(const Transform& t);
+	// Multiplies two affine matrices; the last column of each is assumed to be (0, 0, 0, 1).
+	static Float4x4 multiply(const Float4x4& l, const Float4x4& r);
+};
+
+// Parent/child transforms.
+// Every entity with a transform is a row in one set of columns (local transform, world matrix, parent, dirty flag).
+// Rows are grouped into blocks, one tree per block, and within a block every parent comes before its children.
+// That makes updating world matrices a single pass from front to back, where each row only needs its parent's
+// world matrix, which has already been worked out. Blocks never share rows, so they can be handed out to different threads.
+// Changing a local transform only flags its row and its block; update skips blocks with nothing flagged,
+// and within a flagged block only recomputes the flagged rows and everything beneath them.
+// Changing the hierarchy only touches the blocks involved:
+// - A new root gets a block of its own on the end, and a new child goes on the end of its parent's block,
+//   which is first moved to the end of the rows if it isn't there already.
+// - Detaching an entity leaves an unused row behind, and its children become roots where they are.
+// - Moving an entity under a new parent moves it, and everything beneath it, onto the end of the parent's block
+//   (unless the parent is an earlier row of the same block, or it becomes a root, which needs nothing moved).
+// So each change costs O(size of the blocks involved). Unused rows have an ID of 0; once they make up more than
+// half of the rows, the next update packs the rest together, which is O(n) but only happens after O(n) changes.
+class TransformComponent {
+public:
+	// Gives an entity a transform, as a child of 'parent' (or a root if 'parent' is 0).
+	// Its world matrix is worked out at the next update.
+	// Returns false if the entity already has a transform, the parent doesn't have one, or a memory allocation failure occurs.
+	bool attach(entity::ID id, const Transform& local = Transform(), entity::ID parent = 0);
+	// Removes an entity's transform. Its children become roots, keeping their local transforms.
+	bool detach(entity::ID id) { return detachMany(std::span<const entity::ID>(&id, 1)) > 0; }
+	// Removes several entities' transforms at once.
+	// Returns the number which had a transform.
+	// Complexity: O(size of the blocks they were in).
+	size_t detachMany(std::span<const entity::ID> ids);
+	bool has(entity::ID id) const { return lookup.find(id) != SIZE_MAX; }
+	size_t size() const { return rows.size() - deadRows; }
+
+	// Moves an entity under a new parent (or makes it a root if 'parent' is 0), keeping its local transform.
+	// Returns false if either entity doesn't have a transform, or if 'parent' is the entity itself or one of its descendants.
+	bool setParent(entity::ID id, entity::ID parent);
+	// Returns an entity's parent, or 0 if it's a root or doesn't have a transform.
+	entity::ID getParent(entity::ID id) const;
+
+	// Changes an entity's local transform; its world matrix, and those of its descendants, are worked out at the next update.
+	bool setLocal(entity::ID id, const Transform& local);
+	const Transform* getLocal(entity::ID id) const {
+		size_t row = findRow(id);
+		return (row == SIZE_MAX) ? nullptr : &rows.at<LOCAL>(row);
+	}
+	// Returns an entity's world matrix as of the last update, or nullptr if it doesn't have a transform.
+	const Float4x4* getWorld(entity::ID id) const {
+		size_t row = findRow(id);
+		return (row == SIZE_MAX) ? nullptr : &rows.at<WORLD>(row);
+	}
+
+	// Every row's entity, and its world matrix as of the last update, in the same order.
+	// Unused rows have an ID of 0, and should be skipped.
+	std::span<const entity::ID> ids() const { return std::span<const entity::ID>(rows.data<ID>(), rows.size()); }
+	std::span<const Float4x4> worlds() const { return std::span<const Float4x4>(rows.data<WORLD>(), rows.size()); }
+
+	// update(exec)
+	// Packs the rows together if too many are unused, then recomputes the world matrix of every flagged row and its descendants.
+	// Flagged blocks are grouped into tasks of roughly GRAIN rows and run on 'exec'; a single block is never split.
+	template <typename ExecT>
+	void update(ExecT& exec) {
+		static constexpr size_t GRAIN = 4096;
+		if (deadRows > rows.size() / 2) compact();
+
+		work.clear();
+		taskStarts.clear();
+		size_t rowsInTask = GRAIN;
+		for (uint32_t t = 0; t < (uint32_t)trees.size(); ++t) {
+			if (!trees[t].dirty) continue;
+			if (rowsInTask >= GRAIN) {
+				taskStarts.push_back(work.size());
+				rowsInTask = 0;
+			}
+			work.push_back(t);
+			rowsInTask += trees[t].count;
+		}
+		if (work.empty()) return;
+		taskStarts.push_back(work.size());
+
+		exec.run(taskStarts.size() - 1, [&](size_t task) {
+			for (size_t i = taskStarts[task]; i < taskStarts[task + 1]; ++i) { updateTree(work[i]); }
+		});
+	}
+	void update() { hvh::serial_executor exec; update(exec); }
+
+private:
+	// The columns of 'rows'.
+	enum { ID = 0, LOCAL, WORLD, PARENT_ID, PARENT, TREE, DIRTY, ORDER };
+	static constexpr uint32_t NONE = UINT32_MAX;
+
+	// A block of rows, [first, first + count), which may include unused rows.
+	// It starts out holding one tree; entities detached from the middle of it leave it holding several.
+	struct Tree {
+		uint32_t first;
+		uint32_t count;
+		uint8_t dirty;
+	};
+
+	size_t findRow(entity::ID id) const {
+		size_t index = lookup.find(id);
+		return (index == SIZE_MAX) ? SIZE_MAX : lookup.at<1>(index);
+	}
+	// Makes sure 'count' more rows can be added without the columns moving.
+	bool makeRoom(size_t count);
+	// Moves a block's rows (leaving out unused ones) to the end, so rows can be added to it.
+	bool moveToEnd(uint32_t tree);
+	// Copies a row onto the end, under the given parent row and into the given block, and leaves the old row unused.
+	// The old row's order column is set to the new row, so its children can follow it. There must be room.
+	void copyToEnd(uint32_t row, uint32_t parent, uint32_t tree);
+	// Marks a row as unused.
+	void killRow(uint32_t row);
+	// Drops every unused row, and rebuilds everything which refers to rows by position.
+	void compact();
+	// Recomputes the flagged rows of one block and everything beneath them, then clears the block's flags.
+	// Blocks share nothing, so different blocks can be updated on different threads at once.
+	void updateTree(uint32_t tree);
+
+	// The order column is scratch space for following rows to their new places.
+	hvh::soa<entity::ID, Transform, Float4x4, entity::ID, uint32_t, uint32_t, uint8_t, uint32_t> rows;
+	// Each entity's row.
+	hvh::htable<entity::ID, uint32_t> lookup;
+	// Each block's rows.
+	std::vector<Tree> trees;
+	// The number of unused rows.
+	size_t deadRows = 0;
+
+	// Scratch space for update, detachMany and compact.
+	std::vector<uint32_t> work;
+	std::vector<size_t> taskStarts;
+	std::vector<uint32_t> remap;
+	std::vector<Tree> compacted;
+};
+
+namespace wc::ecs {
+
+	// The engine's transform hierarchy, updated once per logical frame (after deferred commands are applied).
+	TransformComponent& transforms();
+
+} // namespace wc::ecs
+
+#endif // HVH_WC_ECS_COMPONENTS_TRANSFORM_H
@@ -0,0 +1,173 @@
+#include "SpatialComponent.h"
+#include "tools/rng.h"
+#include "tools/executor.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+	float randf(RNG& rng, float lo, float hi) {
+		return lo + (hi - lo) * (float)(rng.next() % 1000000) / 1000000.0f;
+	}
+
+	AABB randomBox(RNG& rng, float world, float maxsize) {
+		float x = randf(rng, -world, world), y = randf(rng, -world, world), z = randf(rng, -world, world);
+		float s = randf(rng, 0.1f, maxsize);
+		return AABB{ x - s, y - s, z - s, x + s, y + s, z + s };
+	}
+
+	bool overlaps(const AABB& a, const AABB& b) {
+		return (a.minx <= b.maxx && a.maxx >= b.minx && a.miny <= b.maxy && a.maxy >= b.miny && a.minz <= b.maxz && a.maxz >= b.minz);
+	}
+
+} // namespace <anon>
+
+bool spatial_test() {
+	bool success = true;
+	printf("Testing the spatial index...\n");
+
+	RNG rng(42);
+	SpatialComponent spatial(4.0f);
+	std::vector<entity::ID> ids(2000);
+	std::vector<AABB> boxes(ids.size());
+	for (size_t i = 0; i < ids.size(); ++i) {
+		ids[i] = entity::create();
+		boxes[i] = randomBox(rng, 50.0f, 3.0f);
+		spatial.attach(ids[i], boxes[i]);
+	}
+	if (spatial.attach(ids[0], boxes[0]) || spatial.size() != ids.size()) {
+		printf("Attaching an entity twice should fail.\n");
+		success = false;
+	}
+
+	// Move everything (some entities twice), detach a few, then check every kind of query against brute force.
+	hvh::thread_executor exec(4);
+	for (int frame = 0; frame < 3; ++frame) {
+		for (size_t i = 0; i < ids.size(); ++i) {
+			if (i % 7 == 0) spatial.setBounds(ids[i], randomBox(rng, 50.0f, 3.0f));
+			boxes[i] = (i % 3 == 0) ? randomBox(rng, 50.0f, 3.0f) : AABB{ boxes[i].minx + 1, boxes[i].miny, boxes[i].minz, boxes[i].maxx + 1, boxes[i].maxy, boxes[i].maxz };
+			spatial.setBounds(ids[i], boxes[i]);
+		}
+		spatial.update(exec);
+	}
+	for (size_t i = 0; i < ids.size(); i += 10) { spatial.detach(ids[i]); }
+
+	std::vector<entity::ID> found, expected;
+	for (int q = 0; q < 50 && success; ++q) {
+		AABB box = randomBox(rng, 60.0f, (q % 5 == 0) ? 40.0f : 6.0f);
+		spatial.queryBox(box, found);
+		expected.clear();
+		for (size_t i = 0; i < ids.size(); ++i) {
+			if (i % 10 != 0 && overlaps(boxes[i], box)) expected.push_back(ids[i]);
+		}
+		std::sort(found.begin(), found.end());
+		std::sort(expected.begin(), expected.end());
+		if (found != expected) {
+			printf("Box query %i found %zi entities, expected %zi.\n", q, found.size(), expected.size());
+			success = false;
+		}
+
+		float cx = randf(rng, -50, 50), cy = randf(rng, -50, 50), cz = randf(rng, -50, 50), r = randf(rng, 1, 10);
+		spatial.querySphere(cx, cy, cz, r, found);
+		size_t count = 0;
+		for (size_t i = 0; i < ids.size(); ++i) {
+			const AABB& b = boxes[i];
+			float dx = std::max({ b.minx - cx, 0.0f, cx - b.maxx }), dy = std::max({ b.miny - cy, 0.0f, cy - b.maxy }), dz = std::max({ b.minz - cz, 0.0f, cz - b.maxz });
+			if (i % 10 != 0 && dx * dx + dy * dy + dz * dz <= r * r) ++count;
+		}
+		if (found.size() != count) {
+			printf("Sphere query %i found %zi entities, expected %zi.\n", q, found.size(), count);
+			success = false;
+		}
+	}
+
+	// A ray along the x axis hits the boxes in order.
+	SpatialComponent line(2.0f);
+	for (int i = 0; i < 10; ++i) {
+		float x = (float)(10 - i) * 5.0f;
+		line.attach(ids[i], AABB{ x - 1, -1, -1, x + 1, 1, 1 });
+	}
+	line.attach(ids[10], AABB{ 20, 5, 5, 22, 7, 7 });
+	std::vector<SpatialComponent::RayHit> hits;
+	line.raycast(0, 0.5f, 0.25f, 1, 0, 0, 32.0f, hits);
+	bool ordered = (hits.size() == 6);
+	for (size_t i = 0; i < hits.size() && ordered; ++i) {
+		ordered = (hits[i].id == ids[9 - i] && std::abs(hits[i].distance - (float)(i + 1) * 5.0f + 1.0f) < 0.001f);
+	}
+	line.raycast(-100, 6, 6, 1, 0, 0, 1000.0f, hits);
+	if (!ordered || hits.size() != 1 || hits[0].id != ids[10]) {
+		printf("Raycasts hit the wrong entities.\n");
+		success = false;
+	}
+
+	for (entity::ID id : ids) { entity::destroy(id); }
+	return success;
+}
+
+// Moves 100k entities every frame, updating the index serially and in parallel, and runs a batch of queries.
+bool spatial_benchmark() {
+	using namespace std::chrono;
+	bool success = true;
+	printf("Benchmarking the spatial index...\n");
+
+	static const size_t COUNT = 100000;
+	static const int FRAMES = 30;
+	RNG rng(7);
+	SpatialComponent spatial(4.0f);
+	std::vector<entity::ID> ids(COUNT);
+	std::vector<AABB> boxes(COUNT);
+	std::vector<float> velocity(COUNT);
+	for (size_t i = 0; i < COUNT; ++i) {
+		ids[i] = entity::create();
+		boxes[i] = randomBox(rng, 500.0f, 1.0f);
+		velocity[i] = randf(rng, -2.0f, 2.0f);
+		spatial.attach(ids[i], boxes[i]);
+	}
+
+	auto moveAll = [&]() {
+		for (size_t i = 0; i < COUNT; ++i) {
+			boxes[i].minx += velocity[i]; boxes[i].maxx += velocity[i];
+			spatial.setBounds(ids[i], boxes[i]);
+		}
+	};
+
+	hvh::serial_executor serial;
+	hvh::thread_executor threaded;
+	double serialms = 0, threadedms = 0;
+	for (int frame = 0; frame < FRAMES; ++frame) {
+		moveAll();
+		auto start = high_resolution_clock::now();
+		if (frame % 2) spatial.update(threaded);
+		else spatial.update(serial);
+		double ms = duration<double, std::milli>(high_resolution_clock::now() - start).count();
+		((frame % 2) ? threadedms : serialms) += ms;
+	}
+	printf("update 100k moving entities: %.3f ms serial, %.3f ms with thread_executor.\n", serialms / (FRAMES / 2), threadedms / (FRAMES / 2));
+
+	std::vector<entity::ID> found;
+	size_t total = 0;
+	auto start = high_resolution_clock::now();
+	for (int q = 0; q < 1000; ++q) {
+		float x = randf(rng, -500, 500), y = randf(rng, -500, 500), z = randf(rng, -500, 500);
+		spatial.querySphere(x, y, z, 10.0f, found);
+		total += found.size();
+	}
+	double queryus = duration<double, std::micro>(high_resolution_clock::now() - start).count() / 1000;
+	printf("sphere query (radius 10): %.2f us, %.2f entities found on average.\n", queryus, (double)total / 1000);
+
+	// The last frame's positions must be what the index holds.
+	for (size_t i = 0; i < COUNT; i += 997) {
+		if (spatial.getBounds(ids[i])->minx != boxes[i].minx) {
+			printf("The index fell behind the entities' positions.\n");
+			success = false;
+			break;
+		}
+	}
+
+	for (entity::ID id : ids) { entity::destroy(id); }
+	return success;
+}
@@ -0,0 +1,73 @@
+#include "TagsComponent.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+bool tags_test() {
+	bool success = true;
+	printf("Testing tags...\n");
+
+	TagsComponent tags;
+	std::vector<entity::ID> ids(1000);
+	for (entity::ID& id : ids) { id = entity::create(); }
+
+	// Enough tags are made that some don't fit in an entity's inline bits.
+	TagsComponent::TagId byTwo = tags.intern("two"), byThree = tags.intern("three");
+	for (int i = 0; i < 100; ++i) { tags.intern(("filler" + std::to_string(i)).c_str()); }
+	TagsComponent::TagId byFive = tags.intern("five");
+	if (tags.intern("two") != byTwo || tags.find("five") != byFive || tags.find("seven") != TagsComponent::NO_TAG
+		|| byFive < TagsComponent::INLINE_TAGS || tags.tagName(byThree) != "three") {
+		printf("Interning tags should give each name one stable ID.\n");
+		success = false;
+	}
+
+	for (size_t i = 0; i < ids.size(); ++i) {
+		if (i % 2 == 0) tags.addTag(ids[i], byTwo);
+		if (i % 3 == 0) tags.addTag(ids[i], "three");
+		if (i % 5 == 0) tags.addTag(ids[i], byFive);
+	}
+	if (tags.addTag(ids[0], byFive) || !tags.hasTag(ids[10], "five") || tags.hasTag(ids[10], byThree) || tags.hasTag(ids[1], "seven")) {
+		printf("Entities don't have the tags they were given.\n");
+		success = false;
+	}
+
+	// Multiples of 2 and 3 but not 5; then multiples of 3 or 5 which aren't multiples of 2.
+	std::vector<entity::ID> result;
+	TagsComponent::TagId two[] = { byTwo }, threeAndTwo[] = { byThree, byTwo }, threeOrFive[] = { byThree, byFive }, five[] = { byFive };
+	tags.findAll(threeAndTwo, {}, five, result);
+	bool found = (result.size() == 133);
+	for (entity::ID id : result) {
+		size_t i = std::find(ids.begin(), ids.end(), id) - ids.begin();
+		found = found && (i % 6 == 0) && (i % 5 != 0);
+	}
+	tags.findAll({}, threeOrFive, two, result);
+	found = found && (result.size() == 234);
+	if (!found) {
+		printf("Tag queries found the wrong entities.\n");
+		success = false;
+	}
+
+	// Taking tags away (one at a time or all at once) removes the entity from every query.
+	tags.removeTag(ids[6], "two");
+	tags.removeAll(ids[12]);
+	std::vector<TagsComponent::TagId> held;
+	tags.getTags(ids[30], held);
+	tags.findAll(threeAndTwo, {}, {}, result);
+	if (result.size() != 165 || tags.hasTag(ids[12], byThree) || tags.removeTag(ids[12], byTwo) || held.size() != 3) {
+		printf("Removing tags failed.\n");
+		success = false;
+	}
+
+	for (entity::ID id : ids) {
+		tags.removeAll(id);
+		entity::destroy(id);
+	}
+	if (tags.size() != 0 || !tags.entitiesWith(byFive).empty()) {
+		printf("Every tag should have been removed.\n");
+		success = false;
+	}
+
+	return success;
+}
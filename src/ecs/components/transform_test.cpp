@@ -0,0 +1,220 @@
+#include "TransformComponent.h"
+#include "tools/rng.h"
+#include "tools/executor.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+	float randf(RNG& rng, float lo, float hi) {
+		return lo + (hi - lo) * (float)(rng.next() % 1000000) / 1000000.0f;
+	}
+
+	Transform randomTransform(RNG& rng) {
+		Transform t;
+		t.x = randf(rng, -10, 10); t.y = randf(rng, -10, 10); t.z = randf(rng, -10, 10);
+		float qx = randf(rng, -1, 1), qy = randf(rng, -1, 1), qz = randf(rng, -1, 1), qw = randf(rng, -1, 1);
+		float length = std::sqrt(qx * qx + qy * qy + qz * qz + qw * qw);
+		t.qx = qx / length; t.qy = qy / length; t.qz = qz / length; t.qw = qw / length;
+		t.sx = randf(rng, 0.5f, 1.5f); t.sy = randf(rng, 0.5f, 1.5f); t.sz = randf(rng, 0.5f, 1.5f);
+		return t;
+	}
+
+	// Works out a world matrix the slow way, straight from the hierarchy.
+	Float4x4 expectedWorld(const TransformComponent& transforms, entity::ID id) {
+		Float4x4 local = Float4x4::compose(*transforms.getLocal(id));
+		entity::ID parent = transforms.getParent(id);
+		return (parent == 0) ? local : Float4x4::multiply(local, expectedWorld(transforms, parent));
+	}
+
+	bool matchesHierarchy(const TransformComponent& transforms, const std::vector<entity::ID>& ids) {
+		for (entity::ID id : ids) {
+			if (!transforms.has(id)) continue;
+			Float4x4 expected = expectedWorld(transforms, id);
+			const Float4x4& world = *transforms.getWorld(id);
+			for (int i = 0; i < 4; ++i) {
+				for (int j = 0; j < 4; ++j) {
+					float error = std::abs(world.m[i][j] - expected.m[i][j]);
+					if (error > 1e-3f * std::max(1.0f, std::abs(expected.m[i][j]))) return false;
+				}
+			}
+		}
+		return true;
+	}
+
+} // namespace <anon>
+
+bool transform_test() {
+	bool success = true;
+	printf("Testing transforms...\n");
+
+	// A child one unit along x from a parent which is turned a quarter turn about z ends up one unit along y from it.
+	{
+		TransformComponent transforms;
+		entity::ID parent = entity::create(), child = entity::create();
+		Transform p, c;
+		p.x = 1.0f;
+		p.qz = p.qw = std::sqrt(0.5f);
+		c.x = 1.0f;
+		transforms.attach(child, c);
+		transforms.attach(parent, p);
+		transforms.setParent(child, parent);
+		transforms.update();
+		const Float4x4& world = *transforms.getWorld(child);
+		if (std::abs(world.m[3][0] - 1.0f) > 1e-5f || std::abs(world.m[3][1] - 1.0f) > 1e-5f || std::abs(world.m[3][2]) > 1e-5f) {
+			printf("A child's world position is (%f, %f, %f), expected (1, 1, 0).\n", world.m[3][0], world.m[3][1], world.m[3][2]);
+			success = false;
+		}
+		entity::destroy(parent);
+		entity::destroy(child);
+	}
+
+	// A random forest; each entity's parent is an earlier one, so there are no loops.
+	RNG rng(1234);
+	TransformComponent transforms;
+	std::vector<entity::ID> ids(3000);
+	for (size_t i = 0; i < ids.size(); ++i) {
+		ids[i] = entity::create();
+		entity::ID parent = (i == 0 || rng.next() % 5 == 0) ? 0 : ids[rng.next() % i];
+		transforms.attach(ids[i], randomTransform(rng), parent);
+	}
+	if (transforms.attach(ids[5], Transform()) || transforms.attach(entity::create(), Transform(), entity::create())) {
+		printf("Attaching an entity twice, or under a parent without a transform, should fail.\n");
+		success = false;
+	}
+	hvh::thread_executor exec(4);
+	transforms.update(exec);
+	if (!matchesHierarchy(transforms, ids)) {
+		printf("World matrices don't match the hierarchy after the first update.\n");
+		success = false;
+	}
+
+	// Change some local transforms without touching the hierarchy, then move some subtrees around.
+	for (int round = 0; round < 3; ++round) {
+		for (int i = 0; i < 100; ++i) { transforms.setLocal(ids[rng.next() % ids.size()], randomTransform(rng)); }
+		transforms.update(exec);
+		for (int i = 0; i < 50; ++i) {
+			entity::ID id = ids[rng.next() % ids.size()];
+			entity::ID parent = (rng.next() % 4 == 0) ? 0 : ids[rng.next() % ids.size()];
+			transforms.setParent(id, parent);
+		}
+		transforms.update(exec);
+		if (!matchesHierarchy(transforms, ids)) {
+			printf("World matrices don't match the hierarchy after round %i.\n", round);
+			success = false;
+		}
+	}
+
+	// Nothing may become its own ancestor.
+	entity::ID leaf = ids[ids.size() - 1];
+	entity::ID root = leaf;
+	while (transforms.getParent(root) != 0) { root = transforms.getParent(root); }
+	if ((root != leaf && transforms.setParent(root, leaf)) || transforms.setParent(leaf, leaf)) {
+		printf("setParent allowed a loop.\n");
+		success = false;
+	}
+
+	// Removing entities turns their children into roots.
+	std::vector<entity::ID> doomed;
+	for (size_t i = 0; i < ids.size(); i += 7) { doomed.push_back(ids[i]); }
+	doomed.push_back(ids[0]);
+	if (transforms.detachMany(doomed) != doomed.size() - 1 || transforms.size() != ids.size() - (doomed.size() - 1)) {
+		printf("detachMany removed the wrong number of entities.\n");
+		success = false;
+	}
+	for (entity::ID id : ids) {
+		entity::ID parent = transforms.getParent(id);
+		if (parent != 0 && !transforms.has(parent)) {
+			printf("An entity kept a parent which was detached.\n");
+			success = false;
+			break;
+		}
+	}
+	transforms.update();
+	if (!matchesHierarchy(transforms, ids)) {
+		printf("World matrices don't match the hierarchy after detaching.\n");
+		success = false;
+	}
+
+	// Churn the hierarchy for a while, so unused rows pile up and get packed away.
+	for (int round = 0; round < 20; ++round) {
+		for (int i = 0; i < 200; ++i) {
+			entity::ID id = ids[rng.next() % ids.size()];
+			entity::ID parent = (rng.next() % 4 == 0) ? 0 : ids[rng.next() % ids.size()];
+			switch (rng.next() % 3) {
+			case 0: transforms.detach(id); break;
+			case 1: transforms.attach(id, randomTransform(rng), parent); break;
+			default: transforms.setParent(id, parent); break;
+			}
+		}
+		transforms.update(exec);
+		size_t attached = 0, rows = 0;
+		for (entity::ID id : ids) { attached += transforms.has(id) ? 1 : 0; }
+		for (entity::ID id : transforms.ids()) { rows += (id != 0) ? 1 : 0; }
+		if (!matchesHierarchy(transforms, ids) || attached != transforms.size() || rows != transforms.size()) {
+			printf("World matrices don't match the hierarchy after churning it in round %i.\n", round);
+			success = false;
+			break;
+		}
+	}
+
+	for (entity::ID id : ids) { entity::destroy(id); }
+	return success;
+}
+
+// 100k entities in 1000 trees; each frame moves a few roots and a few other entities, then updates serially or in parallel.
+bool transform_benchmark() {
+	using namespace std::chrono;
+	printf("Benchmarking transforms...\n");
+
+	static const size_t TREES = 1000, PER_TREE = 100;
+	static const int FRAMES = 30;
+	RNG rng(99);
+	TransformComponent transforms;
+	std::vector<entity::ID> ids(TREES * PER_TREE);
+	for (size_t t = 0; t < TREES; ++t) {
+		for (size_t i = 0; i < PER_TREE; ++i) {
+			size_t n = t * PER_TREE + i;
+			ids[n] = entity::create();
+			transforms.attach(ids[n], randomTransform(rng), (i == 0) ? 0 : ids[t * PER_TREE + rng.next() % i]);
+		}
+	}
+	auto start = high_resolution_clock::now();
+	transforms.update();
+	printf("first update (every world matrix): %.3f ms\n", duration<double, std::milli>(high_resolution_clock::now() - start).count());
+
+	hvh::serial_executor serial;
+	hvh::thread_executor threaded;
+	double serialms = 0, threadedms = 0;
+	for (int frame = 0; frame < FRAMES; ++frame) {
+		for (int i = 0; i < 50; ++i) { transforms.setLocal(ids[(rng.next() % TREES) * PER_TREE], randomTransform(rng)); }
+		for (int i = 0; i < 500; ++i) { transforms.setLocal(ids[rng.next() % ids.size()], randomTransform(rng)); }
+		start = high_resolution_clock::now();
+		if (frame % 2) transforms.update(threaded);
+		else transforms.update(serial);
+		((frame % 2) ? threadedms : serialms) += duration<double, std::milli>(high_resolution_clock::now() - start).count();
+	}
+	printf("update with 50 roots and 500 other entities moved: %.3f ms serial, %.3f ms with thread_executor.\n", serialms / (FRAMES / 2), threadedms / (FRAMES / 2));
+
+	// Structural changes only touch the trees involved: each frame, a few entities are destroyed and replaced by new children.
+	double churnms = 0;
+	std::vector<entity::ID> destroyed;
+	for (int frame = 0; frame < FRAMES; ++frame) {
+		start = high_resolution_clock::now();
+		destroyed.clear();
+		for (int i = 0; i < 10; ++i) { destroyed.push_back(ids[rng.next() % ids.size()]); }
+		transforms.detachMany(destroyed);
+		for (int i = 0; i < 10; ++i) { transforms.attach(destroyed[i], randomTransform(rng), ids[rng.next() % ids.size()]); }
+		transforms.update(serial);
+		churnms += duration<double, std::milli>(high_resolution_clock::now() - start).count();
+	}
+	printf("update after detaching and re-attaching 10 entities: %.3f ms\n", churnms / FRAMES);
+
+	bool success = matchesHierarchy(transforms, ids);
+	if (!success) printf("World matrices don't match the hierarchy.\n");
+	for (entity::ID id : ids) { entity::destroy(id); }
+	return success;
+}
@@ -1,31 +1,146 @@
 #include "entity.h"
 
 #include <chrono>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
 
 #include "tools/rng.h"
 #include "tools/stringhelper.h"
+#include "tools/htable.hpp"
+#include "tools/sparse_soa.hpp"
 
 namespace {
 
-} // namespace <anon>
-
-namespace entity {
-
 	using namespace std::chrono;
 
+	// The current generation of every index which has ever been used.
+	// Destroying an entity bumps its generation before the index goes on the free list,
+	// so no ID which has been handed out can match the generation of a free index.
+	std::vector<uint32_t> generations;
+	// Indices of destroyed entities, waiting to be reused.
+	std::vector<uint32_t> freeIndices;
+	size_t numAliveEntities = 0;
+	// Entities destroyed since the last call to entity::takeDestroyed.
+	std::vector<entity::ID> destroyedIds;
+	// Command buffers create entities from job threads, and systems check IDs from job threads, so everything here is locked.
+	// Creating or destroying an entity, or handing out a persistent ID, takes it exclusively; lookups share it.
+	std::shared_mutex indicesMutex;
+
+	// Persistent IDs are made from the time and a random number, so they're unique across sessions.
 	RNG rng(time_point_cast<milliseconds>(system_clock().now()).time_since_epoch().count());
+	hvh::sparse_soa<entity::ID, uint64_t> persistentIds;
+	hvh::htable<uint64_t, entity::ID> persistentLookup;
 
-	ID create() {
+	uint64_t makePersistentId() {
 		uint64_t timepart = time_point_cast<seconds>(system_clock().now()).time_since_epoch().count();
 		uint32_t randpart = rng.next();
-		uint64_t result = (timepart << 32) | (uint64_t)(randpart);
-		return result;
+		return (timepart << 32) | (uint64_t)(randpart);
+	}
+
+	// Must be called with 'indicesMutex' held (shared or exclusive).
+	bool isAliveLocked(entity::ID id) {
+		uint32_t i = entity::index(id);
+		return (i < generations.size() && generations[i] == entity::generation(id));
+	}
+
+	// Must be called with 'indicesMutex' held exclusively.
+	void destroyLocked(entity::ID id) {
+		if (!isAliveLocked(id)) return;
+		uint32_t i = entity::index(id);
+
+		size_t pindex = persistentIds.find(id);
+		if (pindex != SIZE_MAX) {
+			persistentLookup.erase(persistentIds.at<1>(pindex));
+			persistentIds.erase(id);
+		}
+
+		// Generation 0 is never used, so that no ID is ever 0.
+		if (++generations[i] == 0) generations[i] = 1;
+		freeIndices.push_back(i);
+		destroyedIds.push_back(id);
+		--numAliveEntities;
+	}
+
+} // namespace <anon>
+
+namespace entity {
+
+	ID create() {
+		std::lock_guard<std::shared_mutex> lock(indicesMutex);
+		uint32_t index;
+		if (!freeIndices.empty()) {
+			index = freeIndices.back();
+			freeIndices.pop_back();
+		}
+		else {
+			index = (uint32_t)generations.size();
+			generations.push_back(1);
+		}
+		++numAliveEntities;
+		return ((ID)generations[index] << 32) | index;
 	}
 
 	void destroy(ID id) {
-		if (id == 0) return;
+		std::lock_guard<std::shared_mutex> lock(indicesMutex);
+		destroyLocked(id);
+	}
+
+	void destroyMany(std::span<const ID> ids) {
+		std::lock_guard<std::shared_mutex> lock(indicesMutex);
+		for (ID id : ids) { destroyLocked(id); }
+	}
+
+	void takeDestroyed(std::vector<ID>& result) {
+		std::lock_guard<std::shared_mutex> lock(indicesMutex);
+		result.clear();
+		std::swap(result, destroyedIds);
+	}
+
+	bool isAlive(ID id) {
+		std::shared_lock<std::shared_mutex> lock(indicesMutex);
+		return isAliveLocked(id);
+	}
+
+	size_t numAlive() {
+		std::shared_lock<std::shared_mutex> lock(indicesMutex);
+		return numAliveEntities;
+	}
+
+	uint64_t persistentId(ID id) {
+		std::lock_guard<std::shared_mutex> lock(indicesMutex);
+		if (!isAliveLocked(id)) return 0;
+		size_t pindex = persistentIds.find(id);
+		if (pindex != SIZE_MAX) return persistentIds.at<1>(pindex);
+
+		uint64_t pid;
+		do { pid = makePersistentId(); } while (pid == 0 || persistentLookup.find(pid) != SIZE_MAX);
+		persistentIds.insert(id, pid);
+		persistentLookup.insert(pid, id);
+		return pid;
+	}
+
+	bool setPersistentId(ID id, uint64_t pid) {
+		std::lock_guard<std::shared_mutex> lock(indicesMutex);
+		if (!isAliveLocked(id) || pid == 0) return false;
+		size_t existing = persistentLookup.find(pid);
+		if (existing != SIZE_MAX) return (persistentLookup.at<1>(existing) == id);
+
+		size_t pindex = persistentIds.find(id);
+		if (pindex != SIZE_MAX) {
+			persistentLookup.erase(persistentIds.at<1>(pindex));
+			persistentIds.erase(id);
+		}
+		persistentIds.insert(id, pid);
+		persistentLookup.insert(pid, id);
+		return true;
+	}
 
-		// TODO: Unlink this entity from every component.
+	ID findPersistent(uint64_t pid) {
+		std::shared_lock<std::shared_mutex> lock(indicesMutex);
+		size_t index = persistentLookup.find(pid);
+		if (index == SIZE_MAX) return 0;
+		return persistentLookup.at<1>(index);
 	}
 
 	std::string toString(ID id) {
@@ -39,4 +154,4 @@ namespace entity {
 		return result;
 	}
 
-} // namespace entity
\ No newline at end of file
+} // namespace entity
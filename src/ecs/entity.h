@@ -2,14 +2,52 @@
 #define HVH_WC_ECS_ENTITY_H
 
 #include <cstdint>
+#include <span>
 #include <string>
 #include <sstream>
+#include <vector>
+
+struct lua_State;
 
 namespace entity {
+	// An entity ID is a 32-bit index in the low bits, and a 32-bit generation in the high bits.
+	// Indices are recycled when entities are destroyed, and the generation is bumped each time,
+	// so an ID which outlives its entity never refers to the new one.
+	// Generations start at 1, so 0 is never a valid ID.
 	typedef uint64_t ID;
 
+	inline uint32_t index(ID id) { return (uint32_t)id; }
+	inline uint32_t generation(ID id) { return (uint32_t)(id >> 32); }
+
+	// Creates a new entity, reusing the index of a destroyed entity if there is one.
+	// Every function here may be called from any thread.
+	// Complexity: O(1).
 	ID create();
+	// Destroys an entity, invalidating every copy of its ID.
+	// This doesn't touch components; entities with components should be destroyed through their wc::ecs::Registry,
+	// which knows which archetype each entity is in and removes it from there before calling this.
+	// Complexity: O(1).
 	void destroy(ID id);
+	// Destroys several entities at once, taking the lock once rather than once per entity.
+	void destroyMany(std::span<const ID> ids);
+	// Moves the IDs of every entity destroyed since the last call into 'result' (replacing its contents),
+	// so deletion events can be fired once per frame rather than once per entity.
+	void takeDestroyed(std::vector<ID>& result);
+	// Returns true if the ID refers to an entity which has not been destroyed.
+	// Complexity: O(1).
+	bool isAlive(ID id);
+	// Returns the number of entities which are currently alive.
+	size_t numAlive();
+
+	// IDs are only meaningful for the current session, since indices are handed out in whatever order entities are created.
+	// Entities which are written to save files can be given a persistent ID instead, which is unique across sessions.
+	// Returns the entity's persistent ID, creating one the first time it's asked for, or 0 if the entity is not alive.
+	uint64_t persistentId(ID id);
+	// Gives an entity a persistent ID loaded from a save file.
+	// Returns false if the entity is not alive, or if another entity already has that persistent ID.
+	bool setPersistentId(ID id, uint64_t pid);
+	// Returns the entity with the given persistent ID, or 0 if there isn't one.
+	ID findPersistent(uint64_t pid);
 
 	inline std::string hexid(ID id) {
 		std::stringstream ss;
@@ -20,6 +58,13 @@ namespace entity {
 	std::string toString(ID id);
 
 	bool initLua();
+	// Pushes an entity's Lua userdata onto the stack.
+	// The same ID always gives the same userdata for as long as Lua holds on to it, so entities pushed from C++
+	// match those created by scripts when used as table keys (which is how event listeners are stored).
+	void pushLua(lua_State* L, ID id);
+	// Fires the Lua 'EVENTS.entity_deletion' event once for a batch of destroyed entities (see takeDestroyed).
+	// Called once per logical frame by the main loop; must only be called from the main thread.
+	void fireDeletionEvents(std::span<const ID> destroyed);
 }
 
-#endif // HVH_WC_ECS_ENTITY_H
\ No newline at end of file
+#endif // HVH_WC_ECS_ENTITY_H
@@ -1,6 +1,16 @@
 #include "entity.h"
 
 #include "lua/luasystem.h"
+#include "debug.h"
+
+#include <vector>
+
+namespace {
+
+	// The registry field holding every entity userdata Lua still refers to, keyed by ID.
+	constexpr const char* USERDATA_CACHE = "entity.userdata";
+
+} // namespace <anon>
 
 namespace entity {
 
@@ -50,15 +60,21 @@ namespace entity {
 
 		} lua_pop(L, 1);
 
+		// Lua compares userdata by identity, so each entity gets a single userdata, shared by every push.
+		// The values are weak, so an entity's userdata is collected once nothing else in Lua refers to it.
+		lua_newtable(L);
+		lua_newtable(L);
+		lua_pushstring(L, "v");
+		lua_setfield(L, -2, "__mode");
+		lua_setmetatable(L, -2);
+		lua_setfield(L, LUA_REGISTRYINDEX, USERDATA_CACHE);
+
 
 		lua_newtable(L); { // Create the 'entity' table.
 
 			// Create a new entity.
 			lua_pushcfunction(L, [](lua_State* L) {
-				ID* id = (ID*)lua_newuserdata(L, sizeof(ID));
-				if (!id) return luaL_error(L, "Entity creation failure.");
-				*id = entity::create();
-				luaL_getmetatable(L, "entity"); lua_setmetatable(L, -2);
+				pushLua(L, entity::create());
 				return 1;
 			}); lua_setfield(L, -2, "create");
 
@@ -66,10 +82,7 @@ namespace entity {
 			// Used to test whether IDs work properly as table keys.
 			lua_pushcfunction(L, [](lua_State* L) {
 				static ID id = entity::create();
-				ID* result = (ID*)lua_newuserdata(L, sizeof(ID));
-				if (!result) return luaL_error(L, "Entity creation failure.");
-				*result = id;
-				luaL_getmetatable(L, "entity"); lua_setmetatable(L, -2);
+				pushLua(L, id);
 				return 1;
 			}); lua_setfield(L, -2, "sameness_test");
 
@@ -87,4 +100,44 @@ namespace entity {
 		return true;
 	}
 
-} // namespace entity
\ No newline at end of file
+	void pushLua(lua_State* L, ID id) {
+		// Lua numbers are doubles, which can't hold every 64-bit ID, so the cache is keyed by the ID's bytes.
+		lua_getfield(L, LUA_REGISTRYINDEX, USERDATA_CACHE);
+		lua_pushlstring(L, (const char*)&id, sizeof(ID));
+		lua_rawget(L, -2);
+		if (lua_isnil(L, -1)) {
+			lua_pop(L, 1);
+			ID* result = (ID*)lua_newuserdata(L, sizeof(ID));
+			*result = id;
+			luaL_getmetatable(L, "entity"); lua_setmetatable(L, -2);
+			lua_pushlstring(L, (const char*)&id, sizeof(ID));
+			lua_pushvalue(L, -2);
+			lua_rawset(L, -4);
+		}
+		lua_remove(L, -2); // pops the cache.
+	}
+
+	void fireDeletionEvents(std::span<const ID> destroyed) {
+		if (destroyed.empty()) return;
+		lua_State* L = wc::lua::getState();
+		if (!L) return;
+
+		// Every entity destroyed this frame goes into one array, which is handed to Lua in a single call.
+		lua_getglobal(L, "EVENTS");
+		lua_getfield(L, -1, "entity_deletion");
+		lua_getfield(L, -1, "execute_local_many");
+		lua_pushvalue(L, -2);
+		lua_createtable(L, (int)destroyed.size(), 0);
+		for (size_t i = 0; i < destroyed.size(); ++i) {
+			pushLua(L, destroyed[i]);
+			lua_rawseti(L, -2, (int)i + 1);
+		}
+		if (lua_pcall(L, 2, 0, 0)) {
+			debug::error("In entity::fireDeletionEvents():\n");
+			debug::errmore(lua_tostring(L, -1), '\n');
+			lua_pop(L, 1);
+		}
+		lua_pop(L, 2); // pops EVENTS.entity_deletion and EVENTS.
+	}
+
+} // namespace entity
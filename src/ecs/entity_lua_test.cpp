@@ -0,0 +1,44 @@
+#include "entity.h"
+
+#include "lua/luasystem.h"
+
+#include <cstdio>
+
+// Needs wc::lua::init and entity::initLua to have run.
+bool entity_lua_test() {
+	bool success = true;
+	printf("Testing entities in Lua...\n");
+	lua_State* L = wc::lua::getState();
+
+	// A script listens for the deletion of an entity it created; the event is then fired from C++.
+	wc::lua::runString(
+		"entity_lua_test = { entity = ENTITY.create(), fired = 0 }\n"
+		"EVENTS.entity_deletion:listen(entity_lua_test.entity, 'entity_lua_test', function(id)\n"
+		"	if rawequal(id, entity_lua_test.entity) then entity_lua_test.fired = entity_lua_test.fired + 1 end\n"
+		"end)\n"
+		"entity_lua_test.same = rawequal(ENTITY.sameness_test(), ENTITY.sameness_test())\n",
+		nullptr, "@entity_lua_test");
+
+	lua_getglobal(L, "entity_lua_test");
+	lua_getfield(L, -1, "entity");
+	entity::ID* id = (entity::ID*)luaL_testudata(L, -1, "entity");
+	entity::ID destroyed[] = { entity::create(), id ? *id : 0 };
+	lua_pop(L, 1);
+	entity::fireDeletionEvents(destroyed);
+
+	lua_getfield(L, -1, "fired");
+	if (lua_tointeger(L, -1) != 1) {
+		printf("A deletion listener registered by a script wasn't called exactly once.\n");
+		success = false;
+	}
+	lua_pop(L, 1);
+	lua_getfield(L, -1, "same");
+	if (!lua_toboolean(L, -1)) {
+		printf("Pushing the same entity twice gave two different userdata.\n");
+		success = false;
+	}
+	lua_pop(L, 2);
+
+	wc::lua::runString("EVENTS.entity_deletion:unlisten(entity_lua_test.entity, 'entity_lua_test') entity_lua_test = nil", nullptr);
+	return success;
+}
@@ -0,0 +1,158 @@
+#include "entity.h"
+#include "tools/htable.hpp"
+#include "tools/sparse_soa.hpp"
+#include "tools/rng.h"
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+bool entity_test() {
+	bool success = true;
+	printf("Testing entities...\n");
+
+	entity::ID first = entity::create();
+	entity::ID second = entity::create();
+	if (first == 0 || second == 0 || first == second || !entity::isAlive(first) || !entity::isAlive(second)) {
+		printf("Newly created entities should be unique, non-zero, and alive.\n");
+		success = false;
+	}
+
+	// Destroying an entity frees its index for reuse, but its old ID must stay dead.
+	entity::destroy(first);
+	entity::ID reused = entity::create();
+	if (entity::isAlive(first) || !entity::isAlive(reused) || entity::index(reused) != entity::index(first) || reused == first) {
+		printf("A destroyed entity's index should be reused with a new generation.\n");
+		success = false;
+	}
+	entity::destroy(first);
+	if (!entity::isAlive(reused)) {
+		printf("Destroying a stale ID destroyed the entity which reused its index.\n");
+		success = false;
+	}
+
+	// Persistent IDs survive being looked up again, and can be restored onto a new entity.
+	uint64_t pid = entity::persistentId(second);
+	if (pid == 0 || entity::persistentId(second) != pid || entity::findPersistent(pid) != second) {
+		printf("Persistent IDs should be stable.\n");
+		success = false;
+	}
+	entity::destroy(second);
+	entity::ID restored = entity::create();
+	if (entity::findPersistent(pid) != 0 || !entity::setPersistentId(restored, pid) || entity::findPersistent(pid) != restored
+		|| entity::setPersistentId(reused, pid)) {
+		printf("Restoring a persistent ID failed.\n");
+		success = false;
+	}
+
+	// Destroyed IDs are collected until they're taken, so deletion events can be batched.
+	std::vector<entity::ID> destroyed;
+	entity::takeDestroyed(destroyed);
+	entity::ID batch[] = { reused, restored, reused };
+	entity::destroyMany(batch);
+	entity::takeDestroyed(destroyed);
+	if (destroyed.size() != 2 || destroyed[0] != reused || destroyed[1] != restored || entity::isAlive(restored)) {
+		printf("Destroying entities in a batch should report each of them once.\n");
+		success = false;
+	}
+	if (entity::numAlive() != 0) {
+		printf("Expected no entities to be alive, found %zi.\n", entity::numAlive());
+		success = false;
+	}
+
+	// Checking and persisting IDs on some threads while others create and destroy entities (and grow the tables).
+	entity::ID watched = entity::create();
+	bool watchedAlive = true;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t) {
+		threads.emplace_back([&, t]() {
+			for (int i = 0; i < 10000; ++i) {
+				if (t % 2 == 0) {
+					entity::ID id = entity::create();
+					if (i % 2 == 0) entity::persistentId(id);
+					entity::destroy(id);
+				}
+				else if (!entity::isAlive(watched) || entity::findPersistent(entity::persistentId(watched)) != watched) {
+					watchedAlive = false;
+				}
+			}
+		});
+	}
+	for (std::thread& thread : threads) { thread.join(); }
+	entity::destroy(watched);
+	entity::takeDestroyed(destroyed);
+	if (!watchedAlive || entity::numAlive() != 0) {
+		printf("Looking up entities while others were created and destroyed went wrong.\n");
+		success = false;
+	}
+
+	return success;
+}
+
+// Times creating, looking up, and destroying a batch of entities with generational IDs and sparse component storage,
+// against the old time-and-random-number IDs with hashed component storage.
+bool entity_benchmark() {
+	using namespace std::chrono;
+	bool success = true;
+	printf("Benchmarking entities...\n");
+
+	static const size_t COUNT = 1 << 20;
+	std::vector<entity::ID> ids(COUNT);
+	size_t found = 0;
+
+	// The old scheme.
+	RNG rng(0xE117);
+	hvh::htable<entity::ID, float> hashed;
+	auto start = high_resolution_clock::now();
+	for (size_t i = 0; i < COUNT; ++i) {
+		uint64_t timepart = time_point_cast<seconds>(system_clock().now()).time_since_epoch().count();
+		ids[i] = (timepart << 32) | (uint64_t)rng.next();
+		hashed.insert(ids[i], (float)i);
+	}
+	auto created = high_resolution_clock::now();
+	for (size_t i = 0; i < COUNT; ++i) {
+		if (hashed.find(ids[(i * 7919) % COUNT]) != SIZE_MAX) ++found;
+	}
+	auto looked = high_resolution_clock::now();
+	for (size_t i = 0; i < COUNT; ++i) { hashed.erase(ids[i]); }
+	auto destroyed = high_resolution_clock::now();
+	printf("time+RNG IDs, htable: create %.2f ns, lookup %.2f ns, destroy %.2f ns.\n",
+		duration<double, std::nano>(created - start).count() / COUNT,
+		duration<double, std::nano>(looked - created).count() / COUNT,
+		duration<double, std::nano>(destroyed - looked).count() / COUNT);
+
+	// Generational IDs.
+	hvh::sparse_soa<entity::ID, float> sparse;
+	start = high_resolution_clock::now();
+	for (size_t i = 0; i < COUNT; ++i) {
+		ids[i] = entity::create();
+		sparse.insert(ids[i], (float)i);
+	}
+	created = high_resolution_clock::now();
+	for (size_t i = 0; i < COUNT; ++i) {
+		if (sparse.find(ids[(i * 7919) % COUNT]) != SIZE_MAX) ++found;
+	}
+	looked = high_resolution_clock::now();
+	size_t alive = 0;
+	for (size_t i = 0; i < COUNT; ++i) {
+		if (entity::isAlive(ids[(i * 7919) % COUNT])) ++alive;
+	}
+	auto checked = high_resolution_clock::now();
+	for (size_t i = 0; i < COUNT; ++i) {
+		sparse.erase(ids[i]);
+		entity::destroy(ids[i]);
+	}
+	destroyed = high_resolution_clock::now();
+	printf("generational IDs, sparse_soa: create %.2f ns, lookup %.2f ns, isAlive %.2f ns, destroy %.2f ns.\n",
+		duration<double, std::nano>(created - start).count() / COUNT,
+		duration<double, std::nano>(looked - created).count() / COUNT,
+		duration<double, std::nano>(checked - looked).count() / COUNT,
+		duration<double, std::nano>(destroyed - checked).count() / COUNT);
+
+	if (found != COUNT * 2 || alive != COUNT) {
+		printf("Expected every lookup to succeed, but only %zi of %zi did.\n", found, COUNT * 2);
+		success = false;
+	}
+	return success;
+}
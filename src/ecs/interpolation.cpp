@@ -0,0 +1,60 @@
+#include "interpolation.h"
+
+#include <cstring>
+
+namespace wc::ecs {
+
+	void InterpolatedState::snapshot() {
+		capturedIds.clear();
+		captured.clear();
+		capture(capturedIds, captured);
+		size_t count = capturedIds.size();
+		captured.resize(count * width);
+
+		// Line up the previous tick's state with the new entities.
+		// Usually nothing has been added or removed, so the entities are in the same order as last time;
+		// the previous tick's rows only need looking up by ID once that stops being true.
+		from.resize(count * width);
+		bool indexed = false;
+		for (size_t i = 0; i < count; ++i) {
+			entity::ID id = capturedIds[i];
+			size_t row = SIZE_MAX;
+			if (i < toIds.size() && toIds[i] == id) row = i;
+			else {
+				if (!indexed) {
+					previousRows.clear();
+					for (size_t j = 0; j < toIds.size(); ++j) { previousRows.insert(toIds[j], (uint32_t)j); }
+					indexed = true;
+				}
+				size_t index = previousRows.find(id);
+				if (index != SIZE_MAX) row = previousRows.at<1>(index);
+			}
+			const float* source = (row != SIZE_MAX) ? to.data() + row * width : captured.data() + i * width;
+			memcpy(from.data() + i * width, source, width * sizeof(float));
+		}
+
+		std::swap(toIds, capturedIds);
+		std::swap(to, captured);
+	}
+
+	InterpolatedState& Interpolator::track(const char* name, size_t width, InterpolatedState::CaptureFunc capture, InterpolatedState::BlendFunc blend) {
+		for (auto& state : states) {
+			if (state.first == name) return *state.second;
+		}
+		states.emplace_back(std::string(name), std::make_unique<InterpolatedState>(width, std::move(capture), blend));
+		return *states.back().second;
+	}
+
+	const InterpolatedState* Interpolator::find(const char* name) const {
+		for (const auto& state : states) {
+			if (state.first == name) return state.second.get();
+		}
+		return nullptr;
+	}
+
+	Interpolator& interpolation() {
+		static Interpolator* result = new Interpolator();
+		return *result;
+	}
+
+} // namespace wc::ecs
@@ -0,0 +1,113 @@
+#ifndef HVH_WC_ECS_INTERPOLATION_H
+#define HVH_WC_ECS_INTERPOLATION_H
+
+#include "entity.h"
+#include "tools/htable.hpp"
+#include "tools/executor.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace wc::ecs {
+
+	// The logic runs at a fixed rate, but frames are drawn whenever they can be, usually somewhere between two logical ticks.
+	// Drawing the state from the latest tick makes motion stutter, so instead the display update draws the state
+	// part way between the last two ticks, 'alpha' of the way from the older one to the newer one
+	// (this puts what's drawn up to one tick behind the logic).
+	//
+	// An InterpolatedState is one piece of per-entity state (a fixed number of floats per entity, such as a world matrix),
+	// kept for the last two logical ticks. 'snapshot' is called at the end of every tick; it copies out the state as it
+	// now is, and lines up the previous tick's copy with it, entity for entity. That leaves 'blend', which runs every
+	// display frame, with a straight pass over two arrays of the same shape.
+	// Every buffer is reused from one tick to the next, so once they've grown to fit, nothing is allocated per entity.
+	class InterpolatedState {
+	public:
+		// Copies out the state as it is now: one entity ID per entity into 'ids', and 'width' floats per entity into 'values',
+		// in the same order. Both vectors arrive empty (but with their old capacity).
+		typedef std::function<void(std::vector<entity::ID>& ids, std::vector<float>& values)> CaptureFunc;
+		// Fills 'out' with the state 'alpha' of the way from 'from' to 'to', for 'count' floats (always a whole number of entities).
+		typedef void (*BlendFunc)(const float* from, const float* to, float alpha, float* out, size_t count);
+
+		// Linear interpolation, which suits positions and most other things.
+		static void lerp(const float* from, const float* to, float alpha, float* out, size_t count) {
+			for (size_t i = 0; i < count; ++i) { out[i] = from[i] + (to[i] - from[i]) * alpha; }
+		}
+
+		InterpolatedState(size_t width, CaptureFunc capture, BlendFunc blend = lerp)
+			: width(width), capture(std::move(capture)), blendFunc(blend) {}
+
+		// Records the state at the end of a logical tick.
+		// Entities which didn't exist at the previous tick appear where they are now; entities which have gone disappear.
+		void snapshot();
+
+		// blend(exec, alpha)
+		// Works out the state to draw, 'alpha' (from 0 to 1) of the way from the previous tick to the latest one.
+		template <typename ExecT>
+		void blend(ExecT& exec, float alpha) {
+			static constexpr size_t GRAIN = 4096;
+			size_t count = toIds.size();
+			blended.resize(to.size());
+			exec.run((count + GRAIN - 1) / GRAIN, [&](size_t task) {
+				size_t first = task * GRAIN * width, num = std::min(GRAIN, count - task * GRAIN) * width;
+				blendFunc(from.data() + first, to.data() + first, alpha, blended.data() + first, num);
+			});
+		}
+		void blend(float alpha) { hvh::serial_executor exec; blend(exec, alpha); }
+
+		// The entities as of the latest tick.
+		std::span<const entity::ID> ids() const { return toIds; }
+		// The state from the last call to blend: 'width' floats for each entity in 'ids', in the same order.
+		std::span<const float> values() const { return blended; }
+		size_t stride() const { return width; }
+
+	private:
+		size_t width;
+		CaptureFunc capture;
+		BlendFunc blendFunc;
+
+		// The latest tick's entities and state, and the previous tick's state lined up with them.
+		std::vector<entity::ID> toIds;
+		std::vector<float> to;
+		std::vector<float> from;
+		std::vector<float> blended;
+		// Scratch space for snapshot.
+		std::vector<entity::ID> capturedIds;
+		std::vector<float> captured;
+		hvh::htable<entity::ID, uint32_t> previousRows;
+	};
+
+	// Every piece of state which is interpolated for drawing, under a name.
+	class Interpolator {
+	public:
+		// Adds a piece of state to snapshot and blend. Returns it, or the existing one if the name is already taken.
+		InterpolatedState& track(const char* name, size_t width, InterpolatedState::CaptureFunc capture, InterpolatedState::BlendFunc blend = InterpolatedState::lerp);
+		// Returns the piece of state with the given name, or nullptr if there isn't one.
+		const InterpolatedState* find(const char* name) const;
+
+		// Snapshots every piece of state; called by the main loop at the end of every logical tick.
+		void snapshot() {
+			for (auto& state : states) { state.second->snapshot(); }
+		}
+		// Blends every piece of state; called by the main loop before each frame is drawn.
+		template <typename ExecT>
+		void blend(ExecT& exec, float alpha) {
+			for (auto& state : states) { state.second->blend(exec, alpha); }
+		}
+		void blend(float alpha) { hvh::serial_executor exec; blend(exec, alpha); }
+
+	private:
+		std::vector<std::pair<std::string, std::unique_ptr<InterpolatedState>>> states;
+	};
+
+	// The engine's interpolated state. ecs::init adds "transform": each entity's world matrix, as 12 floats
+	// (the first three columns of each row of a Float4x4; see TransformComponent).
+	// Rotations are blended linearly too, which is close enough over a single tick.
+	Interpolator& interpolation();
+
+} // namespace wc::ecs
+
+#endif // HVH_WC_ECS_INTERPOLATION_H
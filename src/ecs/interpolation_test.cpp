@@ -0,0 +1,87 @@
+#include "interpolation.h"
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace wc::ecs;
+
+bool interpolation_test() {
+	bool success = true;
+	printf("Testing interpolation...\n");
+
+	// The state being interpolated: two floats per entity.
+	std::vector<entity::ID> ids;
+	std::vector<float> state;
+	InterpolatedState interpolated(2, [&](std::vector<entity::ID>& outIds, std::vector<float>& outValues) {
+		outIds = ids;
+		outValues = state;
+	});
+	auto check = [&](const char* what, std::vector<entity::ID> expectedIds, std::vector<float> expected) {
+		bool same = (interpolated.ids().size() == expectedIds.size() && interpolated.values().size() == expected.size());
+		for (size_t i = 0; same && i < expectedIds.size(); ++i) { same = (interpolated.ids()[i] == expectedIds[i]); }
+		for (size_t i = 0; same && i < expected.size(); ++i) { same = (std::abs(interpolated.values()[i] - expected[i]) < 1e-5f); }
+		if (!same) {
+			printf("Interpolation went wrong %s.\n", what);
+			success = false;
+		}
+	};
+
+	// The first tick has nothing to blend from, so it's drawn as it is.
+	ids = { 1, 2 };
+	state = { 0, 100, 10, 200 };
+	interpolated.snapshot();
+	interpolated.blend(0.5f);
+	check("on the first tick", { 1, 2 }, { 0, 100, 10, 200 });
+
+	ids = { 1, 2 };
+	state = { 2, 100, 20, 300 };
+	interpolated.snapshot();
+	interpolated.blend(0.5f);
+	check("between two ticks", { 1, 2 }, { 1, 100, 15, 250 });
+	interpolated.blend(1.0f);
+	check("at the latest tick", { 1, 2 }, { 2, 100, 20, 300 });
+
+	// Entity 3 is new, so it's drawn where it is; entity 1 is gone; entity 2 has moved to a different row.
+	ids = { 3, 2 };
+	state = { 5, 5, 30, 400 };
+	interpolated.snapshot();
+	interpolated.blend(0.25f);
+	check("after entities came and went", { 3, 2 }, { 5, 5, 22.5f, 325 });
+
+	// Enough entities to be blended in several chunks.
+	InterpolatedState many(3, [&](std::vector<entity::ID>& outIds, std::vector<float>& outValues) {
+		outIds = ids;
+		outValues = state;
+	});
+	ids.resize(10000);
+	state.resize(ids.size() * 3);
+	for (size_t i = 0; i < ids.size(); ++i) {
+		ids[i] = i + 1;
+		state[i * 3] = (float)i; state[i * 3 + 1] = 0.0f; state[i * 3 + 2] = -(float)i;
+	}
+	many.snapshot();
+	for (float& value : state) { value += 4.0f; }
+	many.snapshot();
+	hvh::thread_executor exec(4);
+	many.blend(exec, 0.75f);
+	for (size_t i = 0; i < ids.size(); ++i) {
+		const float* value = many.values().data() + i * many.stride();
+		if (value[0] != (float)i + 3.0f || value[1] != 3.0f || value[2] != -(float)i + 3.0f) {
+			printf("Blending in parallel went wrong at entity %zi.\n", i);
+			success = false;
+			break;
+		}
+	}
+
+	// Tracking the same name twice gives back the same state.
+	Interpolator interpolator;
+	InterpolatedState& first = interpolator.track("test", 1, [](std::vector<entity::ID>&, std::vector<float>&) {});
+	if (&interpolator.track("test", 4, [](std::vector<entity::ID>&, std::vector<float>&) {}) != &first
+		|| interpolator.find("test") != &first || interpolator.find("nothing") != nullptr) {
+		printf("Interpolator::track made a second state with the same name.\n");
+		success = false;
+	}
+
+	return success;
+}
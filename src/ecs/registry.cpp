@@ -0,0 +1,561 @@
+#include "registry.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+#include "debug.h"
+#include "jobs.h"
+
+namespace {
+
+	// Entries are never moved or changed once registered, so they can be read without locking.
+	std::mutex componentTypesMutex;
+	wc::ecs::ComponentInfo componentTypes[wc::ecs::MAX_COMPONENTS];
+	size_t numTypes = 0;
+
+	hvh::soa_malloc_allocator chunkAllocator;
+
+	inline size_t alignUp(size_t bytes, size_t alignment) {
+		return (bytes + alignment - 1) & ~(alignment - 1);
+	}
+
+} // namespace <anon>
+
+namespace wc::ecs {
+
+	ComponentId registerComponent(const ComponentInfo& info) {
+		std::lock_guard<std::mutex> lock(componentTypesMutex);
+		if (numTypes >= MAX_COMPONENTS) {
+			debug::fatal("In wc::ecs::registerComponent(", info.name, "):\n");
+			debug::errmore("Too many component types (the maximum is ", MAX_COMPONENTS, ").\n");
+			std::abort();
+		}
+		componentTypes[numTypes] = info;
+		return (ComponentId)(numTypes++);
+	}
+
+	const ComponentInfo& componentInfo(ComponentId id) {
+		return componentTypes[id];
+	}
+
+	size_t numComponentTypes() {
+		std::lock_guard<std::mutex> lock(componentTypesMutex);
+		return numTypes;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Archetype
+	///////////////////////////////////////////////////////////////////////////
+
+	Archetype::Archetype(const ComponentMask& mask) : mymask(mask) {
+		for (int16_t& column : columnOf) { column = -1; }
+		for (ComponentId id = 0; id < MAX_COMPONENTS; ++id) {
+			if (!mask.test(id)) continue;
+			columnOf[id] = (int16_t)mytypes.size();
+			mytypes.push_back(id);
+			infos.push_back(&componentInfo(id));
+			sizes.push_back(infos.back()->size);
+		}
+
+		// Fit as many rows as we can into a chunk, with every array starting on a cache line.
+		size_t rowbytes = sizeof(entity::ID);
+		for (size_t size : sizes) { rowbytes += size; }
+		chunkRows = std::max<size_t>(16, CHUNK_BYTES / rowbytes);
+		while (true) {
+			size_t offset = alignUp(sizeof(entity::ID) * chunkRows, 64);
+			offsets.clear();
+			for (size_t i = 0; i < sizes.size(); ++i) {
+				offsets.push_back(offset);
+				offset = alignUp(offset + sizes[i] * chunkRows, 64);
+			}
+			chunkBytes = offset;
+			if (chunkBytes <= CHUNK_BYTES || chunkRows == 16) break;
+			--chunkRows;
+		}
+	}
+
+	Archetype::~Archetype() {
+		for (size_t row = 0; row < mysize; ++row) {
+			for (size_t c = 0; c < mytypes.size(); ++c) {
+				if (!infos[c]->trivial) infos[c]->destroy(at(c, row));
+			}
+		}
+		for (void* chunk : chunks) { chunkAllocator.deallocate(chunk, chunkBytes); }
+	}
+
+	size_t Archetype::pushRow(entity::ID id) {
+		if (mysize == chunks.size() * chunkRows) {
+			void* chunk = chunkAllocator.allocate(64, chunkBytes);
+			if (!chunk) return SIZE_MAX;
+			chunks.push_back(chunk);
+		}
+		size_t row = mysize++;
+		entityAt(row) = id;
+		return row;
+	}
+
+	entity::ID Archetype::removeRow(size_t row, bool destroy) {
+		size_t last = mysize - 1;
+		if (destroy) {
+			for (size_t c = 0; c < mytypes.size(); ++c) {
+				if (!infos[c]->trivial) infos[c]->destroy(at(c, row));
+			}
+		}
+		entity::ID moved = 0;
+		if (row != last) {
+			for (size_t c = 0; c < mytypes.size(); ++c) {
+				if (infos[c]->trivial) memcpy(at(c, row), at(c, last), sizes[c]);
+				else infos[c]->relocate(at(c, row), at(c, last));
+			}
+			moved = entityAt(last);
+			entityAt(row) = moved;
+		}
+		--mysize;
+
+		// Keep one spare chunk around, so an entity moving back and forth doesn't allocate every time.
+		if (chunks.size() > numChunks() + 1) {
+			chunkAllocator.deallocate(chunks.back(), chunkBytes);
+			chunks.pop_back();
+		}
+		return moved;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// QueryBase
+	///////////////////////////////////////////////////////////////////////////
+
+	size_t QueryBase::count() const {
+		size_t result = 0;
+		for (Archetype* archetype : archetypes) { result += archetype->size(); }
+		return result;
+	}
+
+	void QueryBase::beginIteration() {
+		std::lock_guard<std::mutex> lock(registry->pendingMutex);
+		++registry->iterating;
+	}
+
+	void QueryBase::endIteration() {
+		std::lock_guard<std::mutex> lock(registry->pendingMutex);
+		if (--registry->iterating == 0 && !registry->pending.empty()) {
+			CommandBuffer* buffers[] = { &registry->pending };
+			registry->applyLocked(buffers);
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// Registry
+	///////////////////////////////////////////////////////////////////////////
+
+	Registry::Registry() {
+		valueOf.fill(NONE);
+		// Archetype 0 holds entities with no components.
+		findArchetype(ComponentMask());
+	}
+
+	Registry::~Registry() {
+		// Entities still in the registry are destroyed along with it.
+		for (auto& archetype : archetypes) {
+			for (size_t chunk = 0; chunk < archetype->numChunks(); ++chunk) {
+				entity::destroyMany(std::span<const entity::ID>(archetype->entities(chunk), archetype->rowsInChunk(chunk)));
+			}
+		}
+	}
+
+	entity::ID Registry::create() {
+		std::lock_guard<std::mutex> lock(pendingMutex);
+		if (iterating > 0) return pending.create();
+		entity::ID id = entity::create();
+		uint32_t index = entity::index(id);
+		if (index >= records.size()) records.resize((size_t)index + 1);
+
+		size_t row = archetypes[0]->pushRow(id);
+		if (row == SIZE_MAX) {
+			entity::destroy(id);
+			return 0;
+		}
+		records[index] = Record{ 0, (uint32_t)row };
+		++numEntities;
+		return id;
+	}
+
+	void Registry::destroy(entity::ID id) {
+		std::lock_guard<std::mutex> lock(pendingMutex);
+		if (iterating > 0) { pending.destroy(id); return; }
+		const Record* rec = record(id);
+		if (!rec) return;
+
+		entity::ID moved = archetypes[rec->archetype]->removeRow(rec->row, true);
+		if (moved) records[entity::index(moved)].row = rec->row;
+		records[entity::index(id)] = Record();
+		--numEntities;
+		entity::destroy(id);
+	}
+
+	void Registry::destroyMany(std::span<const entity::ID> ids) {
+		std::lock_guard<std::mutex> lock(pendingMutex);
+		if (iterating > 0) {
+			for (entity::ID id : ids) { pending.destroy(id); }
+			return;
+		}
+		destroyManyLocked(ids);
+	}
+
+	void Registry::destroyManyLocked(std::span<const entity::ID> ids) {
+
+		// Mark each row as it's found by clearing its record, so duplicate IDs are only counted once.
+		doomedRows.clear();
+		doomedIds.clear();
+		for (entity::ID id : ids) {
+			const Record* rec = record(id);
+			if (!rec) continue;
+			doomedRows.push_back({ rec->archetype, rec->row });
+			doomedIds.push_back(id);
+			records[entity::index(id)] = Record();
+		}
+
+		// Removing rows from the back forwards means the row moved into each hole is never one which is waiting to be removed.
+		std::sort(doomedRows.begin(), doomedRows.end(), [](const auto& a, const auto& b) {
+			return (a.first != b.first) ? (a.first < b.first) : (a.second > b.second);
+		});
+		for (const auto& [archetype, row] : doomedRows) {
+			entity::ID moved = archetypes[archetype]->removeRow(row, true);
+			if (moved) records[entity::index(moved)].row = row;
+		}
+		numEntities -= doomedIds.size();
+		entity::destroyMany(doomedIds);
+	}
+
+	bool Registry::contains(entity::ID id) const {
+		return record(id) != nullptr;
+	}
+
+	const Registry::Record* Registry::record(entity::ID id) const {
+		uint32_t index = entity::index(id);
+		if (index >= records.size()) return nullptr;
+		const Record& rec = records[index];
+		// The entity ID is stored with the row, which catches stale IDs whose index has been reused.
+		if (rec.archetype == NONE || archetypes[rec.archetype]->entityAt(rec.row) != id) return nullptr;
+		return &rec;
+	}
+
+	uint32_t Registry::findArchetype(const ComponentMask& mask) {
+		size_t index = archetypeLookup.find(mask);
+		if (index != SIZE_MAX) return archetypeLookup.at<1>(index);
+
+		uint32_t result = (uint32_t)archetypes.size();
+		archetypes.emplace_back(new Archetype(mask));
+		archetypeLookup.insert(mask, result);
+		for (auto& query : queries) {
+			if (mask.contains(query->mask())) query->match(archetypes.back().get());
+		}
+		return result;
+	}
+
+	uint32_t Registry::addEdge(uint32_t from, ComponentId component) {
+		Archetype& archetype = *archetypes[from];
+		size_t index = archetype.addEdges.find(component);
+		if (index != SIZE_MAX) return archetype.addEdges.at<1>(index);
+
+		ComponentMask mask = archetype.mask();
+		mask.set(component);
+		uint32_t result = findArchetype(mask);
+		archetypes[from]->addEdges.insert(component, result);
+		archetypes[result]->removeEdges.insert(component, from);
+		return result;
+	}
+
+	uint32_t Registry::removeEdge(uint32_t from, ComponentId component) {
+		Archetype& archetype = *archetypes[from];
+		size_t index = archetype.removeEdges.find(component);
+		if (index != SIZE_MAX) return archetype.removeEdges.at<1>(index);
+
+		ComponentMask mask = archetype.mask();
+		mask.reset(component);
+		uint32_t result = findArchetype(mask);
+		archetypes[from]->removeEdges.insert(component, result);
+		archetypes[result]->addEdges.insert(component, from);
+		return result;
+	}
+
+	bool Registry::moveEntity(entity::ID id, uint32_t to) {
+		Record& rec = records[entity::index(id)];
+		Archetype& src = *archetypes[rec.archetype];
+		Archetype& dst = *archetypes[to];
+
+		size_t newrow = dst.pushRow(id);
+		if (newrow == SIZE_MAX) return false;
+
+		for (size_t c = 0; c < src.types().size(); ++c) {
+			ComponentId component = src.types()[c];
+			const ComponentInfo& info = componentInfo(component);
+			int dstcolumn = dst.column(component);
+			if (dstcolumn < 0) {
+				if (!info.trivial) info.destroy(src.at(c, rec.row));
+			}
+			else if (info.trivial) memcpy(dst.at(dstcolumn, newrow), src.at(c, rec.row), info.size);
+			else info.relocate(dst.at(dstcolumn, newrow), src.at(c, rec.row));
+		}
+
+		entity::ID moved = src.removeRow(rec.row, false);
+		if (moved) records[entity::index(moved)].row = rec.row;
+		rec = Record{ to, (uint32_t)newrow };
+		return true;
+	}
+
+	void* Registry::moveToAdd(entity::ID id, ComponentId component, bool& existed) {
+		const Record* rec = record(id);
+		if (!rec) return nullptr;
+		Archetype& current = *archetypes[rec->archetype];
+		int column = current.column(component);
+		existed = (column >= 0);
+		if (existed) return current.at(column, rec->row);
+
+		uint32_t to = addEdge(rec->archetype, component);
+		if (!moveEntity(id, to)) return nullptr;
+		const Record& moved = records[entity::index(id)];
+		Archetype& archetype = *archetypes[moved.archetype];
+		return archetype.at(archetype.column(component), moved.row);
+	}
+
+	bool Registry::removeComponent(entity::ID id, ComponentId component) {
+		const Record* rec = record(id);
+		if (!rec || archetypes[rec->archetype]->column(component) < 0) return false;
+		return moveEntity(id, removeEdge(rec->archetype, component));
+	}
+
+	void* Registry::getComponent(entity::ID id, ComponentId component) const {
+		const Record* rec = record(id);
+		if (!rec) return nullptr;
+		const Archetype& archetype = *archetypes[rec->archetype];
+		int column = archetype.column(component);
+		if (column < 0) return nullptr;
+		return archetype.at(column, rec->row);
+	}
+
+	void Registry::apply(CommandBuffer& buffer) {
+		CommandBuffer* buffers[] = { &buffer };
+		apply(buffers);
+	}
+
+	void Registry::apply(std::span<CommandBuffer* const> buffers) {
+		std::lock_guard<std::mutex> lock(pendingMutex);
+		applyLocked(buffers);
+	}
+
+	void Registry::applyLocked(std::span<CommandBuffer* const> buffers) {
+		// Counting sort the commands by entity, so each entity's commands sit together in the order they were recorded.
+		// Entities get a group the first time one of their commands is seen; 'groupLookup' maps entity indices to groups
+		// (chained through 'sameIndex' in case an index has been reused during the frame) and is reset afterwards.
+		groups.clear();
+		groupOfCommand.clear();
+		for (CommandBuffer* buffer : buffers) {
+			for (CommandBuffer::Command& command : buffer->commands) {
+				uint32_t index = entity::index(command.id);
+				if (index >= groupLookup.size()) groupLookup.resize((size_t)index + 1, NONE);
+				uint32_t group = groupLookup[index];
+				while (group != NONE && groups[group].id != command.id) { group = groups[group].sameIndex; }
+				if (group == NONE) {
+					group = (uint32_t)groups.size();
+					groups.push_back(Group{ command.id, groupLookup[index], 0 });
+					groupLookup[index] = group;
+				}
+				++groups[group].offset;
+				groupOfCommand.push_back(group);
+			}
+		}
+		uint32_t total = 0;
+		for (Group& group : groups) {
+			uint32_t count = group.offset;
+			group.offset = total;
+			total += count;
+			groupLookup[entity::index(group.id)] = NONE;
+		}
+		sorted.resize(total);
+		size_t next = 0;
+		for (CommandBuffer* buffer : buffers) {
+			for (CommandBuffer::Command& command : buffer->commands) { sorted[groups[groupOfCommand[next++]].offset++] = &command; }
+		}
+
+		// Fold each entity's commands into a plan: the archetype it ends up in, and the last value given to each component.
+		// While an entity's commands are folded, 'valueOf' holds where each component's value is in 'values',
+		// so replacing or dropping a value doesn't search; the order of an entity's values doesn't matter.
+		plans.clear();
+		values.clear();
+		destroyed.clear();
+		discarded.clear();
+		auto dropValue = [&](ComponentId component) {
+			uint32_t v = valueOf[component];
+			if (v == NONE) return;
+			values[v] = values.back();
+			valueOf[values[v]->component] = v;
+			values.pop_back();
+			valueOf[component] = NONE;
+		};
+
+		for (size_t g = 0, begin = 0, end = 0; g < groups.size(); ++g, begin = end) {
+			// Each group's offset has been advanced to the start of the next group.
+			end = groups[g].offset;
+			entity::ID id = groups[g].id;
+			const Record* rec = record(id);
+			uint32_t from = rec ? rec->archetype : NONE;
+			ComponentMask mask = rec ? archetypes[from]->mask() : ComponentMask();
+			size_t firstValue = values.size();
+			bool created = false, isDestroyed = false;
+
+			for (size_t r = begin; r < end && !isDestroyed; ++r) {
+				CommandBuffer::Command* command = sorted[r];
+				switch (command->op) {
+				case CommandBuffer::CREATE:
+					created = true;
+					command->id = 0;
+					break;
+				case CommandBuffer::DESTROY:
+					isDestroyed = true;
+					break;
+				case CommandBuffer::ADD:
+					// Earlier values for the same component are destroyed when the buffer is cleared.
+					mask.set(command->component);
+					if (valueOf[command->component] != NONE) values[valueOf[command->component]] = command;
+					else {
+						valueOf[command->component] = (uint32_t)values.size();
+						values.push_back(command);
+					}
+					break;
+				case CommandBuffer::REMOVE:
+					mask.reset(command->component);
+					dropValue(command->component);
+					break;
+				}
+			}
+			for (size_t v = firstValue; v < values.size(); ++v) { valueOf[values[v]->component] = NONE; }
+
+			if (isDestroyed || (!rec && !created)) {
+				values.resize(firstValue);
+				if (rec) destroyed.push_back(id);
+				else if (created) discarded.push_back(id);
+				continue;
+			}
+			uint32_t to;
+			if (rec && mask == archetypes[from]->mask()) to = from;
+			else if (!plans.empty() && mask == archetypes[plans.back().to]->mask()) to = plans.back().to; // Batches tend to repeat.
+			else to = findArchetype(mask);
+			if (to == from && values.size() == firstValue) continue;
+			plans.push_back(Plan{ id, from, to, (uint32_t)firstValue, (uint32_t)(values.size() - firstValue) });
+		}
+
+		// Destroyed entities are removed all at once; ones which were created and destroyed by the commands never joined the registry.
+		destroyManyLocked(destroyed);
+		entity::destroyMany(discarded);
+
+		// Make the moves grouped by archetype, so each archetype's chunks are only walked once.
+		auto byArchetype = [](const Plan& a, const Plan& b) { return (a.to != b.to) ? (a.to < b.to) : (a.from < b.from); };
+		if (!std::is_sorted(plans.begin(), plans.end(), byArchetype)) std::stable_sort(plans.begin(), plans.end(), byArchetype);
+		for (const Plan& plan : plans) {
+			if (plan.from == NONE) {
+				size_t row = archetypes[plan.to]->pushRow(plan.id);
+				if (row == SIZE_MAX) {
+					entity::destroy(plan.id);
+					continue;
+				}
+				uint32_t index = entity::index(plan.id);
+				if (index >= records.size()) records.resize((size_t)index + 1);
+				records[index] = Record{ plan.to, (uint32_t)row };
+				++numEntities;
+			}
+			else if (plan.from != plan.to && !moveEntity(plan.id, plan.to)) continue; // The values are destroyed when the buffers are cleared.
+
+			const Record& rec = records[entity::index(plan.id)];
+			Archetype& archetype = *archetypes[rec.archetype];
+			for (uint32_t v = plan.firstValue; v < plan.firstValue + plan.numValues; ++v) {
+				CommandBuffer::Command* command = values[v];
+				const ComponentInfo& info = componentInfo(command->component);
+				void* mem = archetype.at(archetype.column(command->component), rec.row);
+				if (plan.from != NONE && archetypes[plan.from]->column(command->component) >= 0) info.destroy(mem);
+				info.relocate(mem, command->value);
+				command->value = nullptr;
+			}
+		}
+
+		for (CommandBuffer* buffer : buffers) { buffer->clear(); }
+	}
+
+	Registry& registry() {
+		static Registry* result = new Registry();
+		return *result;
+	}
+
+	DeferredCommands& commands() {
+		static DeferredCommands* result = new DeferredCommands(jobs::numThreads());
+		return *result;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// CommandBuffer
+	///////////////////////////////////////////////////////////////////////////
+
+	void CommandBuffer::clear() {
+		for (Command& command : commands) {
+			if (command.op == ADD && command.value) componentInfo(command.component).destroy(command.value);
+			else if (command.op == CREATE && command.id) entity::destroy(command.id);
+		}
+		commands.clear();
+		for (auto& value : oversized) { chunkAllocator.deallocate(value.first, value.second); }
+		oversized.clear();
+		currentBlock = 0;
+		blockUsed = 0;
+	}
+
+	void* CommandBuffer::allocateValue(size_t size, size_t alignment) {
+		if (size + alignment > BLOCK_BYTES) {
+			void* result = chunkAllocator.allocate(std::max<size_t>(alignment, 64), alignUp(size, 64));
+			oversized.push_back({ result, alignUp(size, 64) });
+			return result;
+		}
+		size_t offset = alignUp(blockUsed, alignment);
+		if (blocks.empty() || offset + size > BLOCK_BYTES) {
+			if (!blocks.empty()) ++currentBlock;
+			if (currentBlock == blocks.size()) blocks.push_back(chunkAllocator.allocate(64, BLOCK_BYTES));
+			offset = 0;
+		}
+		blockUsed = offset + size;
+		return (char*)blocks[currentBlock] + offset;
+	}
+
+	void CommandBuffer::releaseBlocks() {
+		for (void* block : blocks) { chunkAllocator.deallocate(block, BLOCK_BYTES); }
+		blocks.clear();
+		currentBlock = 0;
+		blockUsed = 0;
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// DeferredCommands
+	///////////////////////////////////////////////////////////////////////////
+
+	DeferredCommands::DeferredCommands(size_t numthreads) {
+		for (size_t i = 0; i < numthreads + 1; ++i) { buffers.emplace_back(new CommandBuffer()); }
+	}
+
+	CommandBuffer& DeferredCommands::local() {
+		size_t index = jobs::threadIndex();
+		if (index >= buffers.size() - 1) index = buffers.size() - 1;
+		return *buffers[index];
+	}
+
+	void DeferredCommands::flush(Registry& registry) {
+		pointers.clear();
+		for (auto& buffer : buffers) {
+			if (!buffer->empty()) pointers.push_back(buffer.get());
+		}
+		if (!pointers.empty()) registry.apply(pointers);
+	}
+
+	size_t DeferredCommands::size() const {
+		size_t result = 0;
+		for (auto& buffer : buffers) { result += buffer->size(); }
+		return result;
+	}
+
+} // namespace wc::ecs
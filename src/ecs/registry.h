@@ -0,0 +1,354 @@
+#ifndef HVH_WC_ECS_REGISTRY_H
+#define HVH_WC_ECS_REGISTRY_H
+
+#include "component_info.h"
+#include "commandbuffer.h"
+#include "entity.h"
+#include "tools/htable.hpp"
+#include "tools/executor.hpp"
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace wc::ecs {
+
+	// An archetype stores every entity which has exactly the same set of components.
+	// Rows are stored in chunks of about 16KB; within a chunk, each component is a contiguous array
+	// (with the entity IDs first), so queries can hand whole arrays to systems.
+	// Rows are kept dense by moving the last row into any hole.
+	class Archetype {
+	public:
+		static constexpr size_t CHUNK_BYTES = 16384;
+
+		Archetype(const ComponentMask& mask);
+		~Archetype();
+		Archetype(const Archetype&) = delete;
+		Archetype& operator = (const Archetype&) = delete;
+
+		const ComponentMask& mask() const { return mymask; }
+		// The component types stored here, in increasing ID order; column i stores types()[i].
+		const std::vector<ComponentId>& types() const { return mytypes; }
+		// Returns the column which stores component 'id', or -1 if this archetype doesn't have it.
+		int column(ComponentId id) const { return columnOf[id]; }
+
+		size_t size() const { return mysize; }
+		size_t rowsPerChunk() const { return chunkRows; }
+		// Returns the number of chunks which hold at least one row.
+		size_t numChunks() const { return (mysize + chunkRows - 1) / chunkRows; }
+		// Returns the number of rows in a chunk.
+		size_t rowsInChunk(size_t chunk) const {
+			size_t first = chunk * chunkRows;
+			return (mysize - first < chunkRows) ? (mysize - first) : chunkRows;
+		}
+
+		entity::ID* entities(size_t chunk) const { return (entity::ID*)chunks[chunk]; }
+		void* columnData(size_t column, size_t chunk) const { return (char*)chunks[chunk] + offsets[column]; }
+		entity::ID& entityAt(size_t row) const { return entities(row / chunkRows)[row % chunkRows]; }
+		void* at(size_t column, size_t row) const {
+			return (char*)columnData(column, row / chunkRows) + (row % chunkRows) * sizes[column];
+		}
+
+		// Adds a row for 'id', leaving its components uninitialized.
+		// Returns the new row, or SIZE_MAX if a memory allocation failure occurs.
+		size_t pushRow(entity::ID id);
+		// Removes a row, moving the last row into its place.
+		// If 'destroy' is true, the row's components are destroyed first; otherwise they must already have been moved out.
+		// Returns the ID of the entity which was moved, or 0 if no entity moved.
+		entity::ID removeRow(size_t row, bool destroy);
+
+		// Archetypes reached by adding or removing one component, filled in as they're first needed.
+		hvh::htable<ComponentId, uint32_t> addEdges;
+		hvh::htable<ComponentId, uint32_t> removeEdges;
+
+	private:
+		ComponentMask mymask;
+		std::vector<ComponentId> mytypes;
+		std::vector<size_t> offsets;
+		std::vector<size_t> sizes;
+		std::vector<const ComponentInfo*> infos;
+		int16_t columnOf[MAX_COMPONENTS];
+		std::vector<void*> chunks;
+		size_t chunkRows = 0;
+		size_t chunkBytes = 0;
+		size_t mysize = 0;
+	};
+
+	class Registry;
+
+	// The part of a query which doesn't depend on its component types.
+	// Keeps a list of every archetype which has all of the query's components, which the registry
+	// adds to whenever a new archetype is created, so running a query never searches the archetypes.
+	class QueryBase {
+	public:
+		virtual ~QueryBase() {}
+		const ComponentMask& mask() const { return mymask; }
+		// Returns the number of entities which match the query.
+		size_t count() const;
+
+	protected:
+		friend class Registry;
+		QueryBase(Registry* r, const ComponentMask& m) : registry(r), mymask(m) {}
+		virtual void match(Archetype* archetype) = 0;
+
+		// Structural changes made while a query is running are deferred until it's done.
+		void beginIteration();
+		void endIteration();
+
+		Registry* registry;
+		ComponentMask mymask;
+		std::vector<Archetype*> archetypes;
+	};
+
+	// Query<Ts...>
+	// Finds every entity which has (at least) the components 'Ts...'.
+	// Get one from Registry::query; queries are cached, so this is cheap to call every frame.
+	template <typename... Ts>
+	class Query : public QueryBase {
+		static_assert(sizeof...(Ts) > 0, "A query needs at least one component.");
+	public:
+		// forEach(func)
+		// Calls 'func(std::span<const entity::ID>, std::span<Ts>...)' once for every chunk of matching entities.
+		// Structural changes made by 'func' (through the registry) are deferred until every chunk has been visited.
+		template <typename FuncT>
+		void forEach(FuncT&& func) {
+			beginIteration();
+			for (size_t a = 0; a < archetypes.size(); ++a) {
+				Archetype* archetype = archetypes[a];
+				for (size_t chunk = 0; chunk < archetype->numChunks(); ++chunk) {
+					visitChunk(func, a, chunk, std::index_sequence_for<Ts...>());
+				}
+			}
+			endIteration();
+		}
+
+		// forEach(exec, func)
+		// Like forEach, but chunks are handed out to the executor, so 'func' may be called from several threads at once.
+		// 'func' must not make structural changes through the registry; record them in a per-thread CommandBuffer instead.
+		template <typename ExecT, typename FuncT>
+		void forEach(ExecT& exec, FuncT&& func) {
+			beginIteration();
+			std::vector<std::pair<uint32_t, uint32_t>> tasks;
+			for (size_t a = 0; a < archetypes.size(); ++a) {
+				for (size_t chunk = 0; chunk < archetypes[a]->numChunks(); ++chunk) { tasks.push_back({ (uint32_t)a, (uint32_t)chunk }); }
+			}
+			exec.run(tasks.size(), [&](size_t task) {
+				visitChunk(func, tasks[task].first, tasks[task].second, std::index_sequence_for<Ts...>());
+			});
+			endIteration();
+		}
+
+		// forEachEntity(func)
+		// Calls 'func(entity::ID, Ts&...)' for every matching entity.
+		template <typename FuncT>
+		void forEachEntity(FuncT&& func) {
+			forEach([&](std::span<const entity::ID> ids, std::span<Ts>... columns) {
+				for (size_t i = 0; i < ids.size(); ++i) { func(ids[i], columns[i]...); }
+			});
+		}
+
+	private:
+		friend class Registry;
+		Query(Registry* r) : QueryBase(r, makeMask<Ts...>()) {}
+
+		void match(Archetype* archetype) override {
+			archetypes.push_back(archetype);
+			columns.push_back({ archetype->column(componentId<Ts>())... });
+		}
+
+		template <typename FuncT, size_t... Is>
+		void visitChunk(FuncT& func, size_t a, size_t chunk, std::index_sequence<Is...>) {
+			Archetype* archetype = archetypes[a];
+			size_t rows = archetype->rowsInChunk(chunk);
+			func(std::span<const entity::ID>(archetype->entities(chunk), rows),
+				std::span<Ts>((Ts*)archetype->columnData(columns[a][Is], chunk), rows)...);
+		}
+
+		// For each matched archetype, the column which holds each of 'Ts...'.
+		std::vector<std::array<int, sizeof...(Ts)>> columns;
+	};
+
+	// A unique address for each combination of query types, used to look up cached queries.
+	template <typename... Ts>
+	inline const char queryTypeKey = 0;
+
+	// Registry
+	// Stores components for entities, grouped into archetypes by which components each entity has.
+	// Adding or removing a component moves an entity to another archetype; the moves between archetypes
+	// are cached, so this costs a lookup plus copying the entity's components.
+	// Structural changes made while a query is running are recorded in a command buffer and applied once the outermost
+	// query finishes. Each change holds 'pendingMutex' from checking for a running query until it's done,
+	// and queries take the same mutex to start, so a change is either made before a query starts or deferred until
+	// every query is done, whichever thread either runs on. Queries may run on several threads at once
+	// (from systems which the scheduler runs in parallel); get and has don't lock, so from other threads
+	// they're only safe inside a query, or while nothing else is making structural changes.
+	class Registry {
+	public:
+		Registry();
+		~Registry();
+		Registry(const Registry&) = delete;
+		Registry& operator = (const Registry&) = delete;
+
+		// Creates an entity with no components.
+		// While a query is running, the ID is handed out straight away but the entity only joins the registry
+		// (and 'contains' it) once the queries are done.
+		entity::ID create();
+		// Destroys an entity and all of its components.
+		void destroy(entity::ID id);
+		// destroyMany(ids)
+		// Destroys several entities and all of their components.
+		// Rows are removed grouped by archetype, from the back of each archetype forwards, so each archetype's
+		// chunks are visited together and no row is moved more than once. IDs which aren't in the registry are ignored.
+		void destroyMany(std::span<const entity::ID> ids);
+		// Returns true if the entity was created by this registry and has not been destroyed.
+		bool contains(entity::ID id) const;
+		// Returns the number of entities in the registry.
+		size_t size() const { return numEntities; }
+
+		// Adds a component to an entity, or replaces it if the entity already has one.
+		// Returns false if the entity is not in the registry or a memory allocation failure occurs.
+		template <typename T>
+		bool add(entity::ID id, T value) {
+			std::lock_guard<std::mutex> lock(pendingMutex);
+			if (iterating > 0) { pending.add<T>(id, std::move(value)); return true; }
+			bool existed;
+			void* mem = moveToAdd(id, componentId<T>(), existed);
+			if (!mem) return false;
+			if (existed) *(T*)mem = std::move(value);
+			else new (mem) T(std::move(value));
+			return true;
+		}
+
+		// Removes a component from an entity.
+		// Returns false if the entity is not in the registry or doesn't have the component.
+		template <typename T>
+		bool remove(entity::ID id) {
+			std::lock_guard<std::mutex> lock(pendingMutex);
+			if (iterating > 0) { pending.remove<T>(id); return true; }
+			return removeComponent(id, componentId<T>());
+		}
+
+		// Returns a pointer to an entity's component, or nullptr if it doesn't have one.
+		// The pointer is invalidated by any structural change to the registry.
+		template <typename T>
+		T* get(entity::ID id) { return (T*)getComponent(id, componentId<T>()); }
+
+		template <typename T>
+		bool has(entity::ID id) const { return getComponent(id, componentId<T>()) != nullptr; }
+
+		// Returns the cached query for the given components, creating it the first time it's asked for.
+		// Creating a query is not thread-safe, so systems which run in parallel should create theirs up front.
+		template <typename... Ts>
+		Query<Ts...>& query() {
+			uintptr_t key = (uintptr_t)&queryTypeKey<Ts...>;
+			size_t index = queryLookup.find(key);
+			if (index != SIZE_MAX) return *(Query<Ts...>*)queries[queryLookup.at<1>(index)].get();
+
+			Query<Ts...>* result = new Query<Ts...>(this);
+			for (auto& archetype : archetypes) {
+				if (archetype->mask().contains(result->mask())) result->match(archetype.get());
+			}
+			queryLookup.insert(key, (uint32_t)queries.size());
+			queries.emplace_back(result);
+			return *result;
+		}
+
+		// Applies every command recorded in a command buffer, then clears it.
+		// Must not be called while a query is running.
+		void apply(CommandBuffer& buffer);
+
+		// apply(buffers)
+		// Applies several command buffers at once, then clears them.
+		// Commands are grouped by entity, and each entity's commands (in the order they were recorded) are folded into
+		// a single move to its final archetype; moves are then made grouped by archetype, so a frame's worth of
+		// structural changes costs one move per entity rather than one per command.
+		// Entities which are destroyed never move, and components which are replaced are only relocated once.
+		void apply(std::span<CommandBuffer* const> buffers);
+
+		// Returns the number of archetypes which have been created.
+		size_t numArchetypes() const { return archetypes.size(); }
+
+	private:
+		friend class QueryBase;
+
+		static constexpr uint32_t NONE = UINT32_MAX;
+
+		// Where each entity's components are stored, indexed by entity::index.
+		struct Record {
+			uint32_t archetype = NONE;
+			uint32_t row = 0;
+		};
+
+		// destroyMany and apply, for when 'pendingMutex' is already held and no query is running.
+		void destroyManyLocked(std::span<const entity::ID> ids);
+		void applyLocked(std::span<CommandBuffer* const> buffers);
+
+		// Returns the record for an entity in this registry, or nullptr.
+		const Record* record(entity::ID id) const;
+		// Finds or creates the archetype reached by adding or removing one component.
+		uint32_t findArchetype(const ComponentMask& mask);
+		uint32_t addEdge(uint32_t from, ComponentId component);
+		uint32_t removeEdge(uint32_t from, ComponentId component);
+		// Moves an entity into another archetype, carrying over every component they have in common.
+		// Components which the new archetype doesn't have are destroyed; ones which the old one didn't have are left uninitialized.
+		// Returns false if a memory allocation failure occurs.
+		bool moveEntity(entity::ID id, uint32_t to);
+
+		// Makes room for component 'component' on an entity and returns a pointer to it.
+		// If the entity already had one, 'existed' is set and the existing component is returned.
+		// Returns nullptr if the entity is not in the registry or a memory allocation failure occurs.
+		void* moveToAdd(entity::ID id, ComponentId component, bool& existed);
+		bool removeComponent(entity::ID id, ComponentId component);
+		void* getComponent(entity::ID id, ComponentId component) const;
+
+		std::vector<std::unique_ptr<Archetype>> archetypes;
+		hvh::htable<ComponentMask, uint32_t> archetypeLookup;
+		std::vector<Record> records;
+		size_t numEntities = 0;
+		// Scratch space for apply (see apply for what each is), kept so a flush doesn't allocate once they've grown to fit.
+		// 'groupLookup' is indexed by entity::index and 'valueOf' by component; every entry of both is NONE between calls.
+		struct Group {
+			entity::ID id;
+			uint32_t sameIndex;
+			uint32_t offset;
+		};
+		struct Plan {
+			entity::ID id;
+			uint32_t from; // NONE for entities which were created by the commands.
+			uint32_t to;
+			uint32_t firstValue;
+			uint32_t numValues;
+		};
+		std::vector<uint32_t> groupLookup;
+		std::vector<Group> groups;
+		std::vector<uint32_t> groupOfCommand;
+		std::vector<CommandBuffer::Command*> sorted;
+		std::vector<Plan> plans;
+		std::vector<CommandBuffer::Command*> values;
+		std::array<uint32_t, MAX_COMPONENTS> valueOf;
+		std::vector<entity::ID> destroyed;
+		std::vector<entity::ID> discarded;
+		// Scratch space for destroyMany.
+		std::vector<std::pair<uint32_t, uint32_t>> doomedRows;
+		std::vector<entity::ID> doomedIds;
+
+		std::vector<std::unique_ptr<QueryBase>> queries;
+		hvh::htable<uintptr_t, uint32_t> queryLookup;
+
+		// The number of queries running, and the changes they've deferred.
+		// 'pendingMutex' is held while a query starts or finishes, and for the whole of every structural change.
+		int iterating = 0;
+		std::mutex pendingMutex;
+		CommandBuffer pending;
+	};
+
+	// The engine's registry, and the per-thread command buffers which are applied to it after every logical frame.
+	// Both are created by ecs::init, once the job system is running.
+	Registry& registry();
+	DeferredCommands& commands();
+
+} // namespace wc::ecs
+
+#endif // HVH_WC_ECS_REGISTRY_H
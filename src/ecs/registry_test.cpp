@@ -0,0 +1,262 @@
+#include "registry.h"
+#include "jobs.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+	struct Position { float x, y, z; };
+	struct Velocity { float x, y, z; };
+	struct Label { std::string text; };
+}
+
+bool registry_test() {
+	using namespace wc::ecs;
+	bool success = true;
+	printf("Testing the ECS registry...\n");
+
+	Registry registry;
+	entity::ID a = registry.create();
+	entity::ID b = registry.create();
+	entity::ID c = registry.create();
+	registry.add(a, Position{ 1, 2, 3 });
+	registry.add(b, Position{ 4, 5, 6 });
+	registry.add(b, Velocity{ 1, 1, 1 });
+	registry.add(c, Label{ "a label long enough to live on the heap" });
+	registry.add(c, Velocity{ 2, 2, 2 });
+
+	if (!registry.has<Position>(a) || registry.has<Velocity>(a) || !registry.has<Velocity>(b)
+		|| registry.get<Position>(b)->y != 5 || registry.get<Label>(c)->text != "a label long enough to live on the heap") {
+		printf("Components weren't stored where they were added.\n");
+		success = false;
+	}
+
+	// Every entity with Position and Velocity moves; 'a' has no velocity, so it stays put.
+	auto& moving = registry.query<Position, Velocity>();
+	if (&registry.query<Position, Velocity>() != &moving || moving.count() != 1) {
+		printf("Expected one cached query matching one entity, found %zi.\n", moving.count());
+		success = false;
+	}
+	moving.forEachEntity([](entity::ID, Position& pos, Velocity& vel) { pos.x += vel.x; });
+	if (registry.get<Position>(a)->x != 1 || registry.get<Position>(b)->x != 5) {
+		printf("Query updated the wrong entities.\n");
+		success = false;
+	}
+
+	// Structural changes during iteration are deferred, and queries pick up archetypes created later.
+	size_t visited = 0;
+	registry.query<Velocity>().forEachEntity([&](entity::ID id, Velocity&) {
+		++visited;
+		if (!registry.has<Position>(id)) registry.add(id, Position{ 0, 0, 0 });
+		registry.remove<Velocity>(b);
+	});
+	if (visited != 2 || moving.count() != 1 || !registry.has<Position>(c) || registry.has<Velocity>(b)) {
+		printf("Deferred changes weren't applied correctly.\n");
+		success = false;
+	}
+	if (registry.get<Label>(c)->text != "a label long enough to live on the heap" || registry.get<Position>(b)->x != 5) {
+		printf("Components were damaged while moving between archetypes.\n");
+		success = false;
+	}
+
+	// Destroying an entity removes it from every query, and stale IDs are rejected.
+	registry.destroy(a);
+	if (registry.contains(a) || registry.has<Position>(a) || registry.size() != 2 || registry.query<Position>().count() != 2) {
+		printf("Destroyed entity is still in the registry.\n");
+		success = false;
+	}
+	if (registry.add(a, Position{ 0, 0, 0 })) {
+		printf("Adding a component to a destroyed entity should fail.\n");
+		success = false;
+	}
+
+	// Command buffers recorded elsewhere are applied in order.
+	CommandBuffer commands;
+	commands.add(b, Label{ "added later" });
+	commands.remove<Position>(c);
+	commands.destroy(b);
+	registry.apply(commands);
+	if (registry.contains(b) || registry.has<Position>(c) || !commands.empty() || registry.size() != 1) {
+		printf("Command buffer wasn't applied correctly.\n");
+		success = false;
+	}
+
+	// Entities created by a command buffer which is never applied are destroyed with it.
+	entity::ID orphan = commands.create();
+	commands.clear();
+	if (entity::isAlive(orphan)) {
+		printf("Clearing a command buffer didn't destroy the entities it created.\n");
+		success = false;
+	}
+
+	// Commands recorded on several job threads are folded together per entity when they're flushed.
+	wc::jobs::init(4);
+	DeferredCommands deferred(wc::jobs::numThreads());
+	std::vector<entity::ID> created(64);
+	wc::jobs::parallelFor(0, created.size(), 4, [&](size_t first, size_t last) {
+		CommandBuffer& local = deferred.local();
+		for (size_t i = first; i < last; ++i) {
+			created[i] = local.create();
+			local.add(created[i], Position{ (float)i, 0, 0 });
+			local.add(created[i], Velocity{ 0, 0, 0 });
+			local.add(created[i], Position{ (float)i * 2, 0, 0 });
+			if (i % 4 == 0) local.remove<Velocity>(created[i]);
+			if (i % 8 == 1) local.destroy(created[i]);
+		}
+	});
+	deferred.local().add(c, Label{ "replaced" });
+	deferred.flush(registry);
+	wc::jobs::shutdown();
+	bool folded = (registry.size() == 57 && deferred.size() == 0 && registry.get<Label>(c)->text == "replaced");
+	for (size_t i = 0; i < created.size() && folded; ++i) {
+		if (i % 8 == 1) folded = !registry.contains(created[i]) && !entity::isAlive(created[i]);
+		else folded = registry.get<Position>(created[i])->x == (float)i * 2 && registry.has<Velocity>(created[i]) == (i % 4 != 0);
+	}
+	if (!folded) {
+		printf("Deferred commands from several threads weren't applied correctly.\n");
+		success = false;
+	}
+
+	// Removing a component whose value isn't the last one recorded for its entity keeps the others,
+	// and a second flush starts from clean scratch space.
+	CommandBuffer& local = deferred.local();
+	entity::ID shuffled = local.create();
+	local.add(shuffled, Position{ 1, 0, 0 });
+	local.add(shuffled, Velocity{ 2, 0, 0 });
+	local.add(shuffled, Label{ "shuffled" });
+	local.remove<Position>(shuffled);
+	local.add(shuffled, Velocity{ 3, 0, 0 });
+	local.add(c, Position{ 4, 0, 0 });
+	deferred.flush(registry);
+	if (registry.has<Position>(shuffled) || registry.get<Velocity>(shuffled)->x != 3 || registry.get<Label>(shuffled)->text != "shuffled"
+		|| registry.get<Position>(c)->x != 4 || registry.get<Label>(c)->text != "replaced") {
+		printf("Deferred commands which removed a component in the middle of an entity's values weren't applied correctly.\n");
+		success = false;
+	}
+	registry.destroy(shuffled);
+	registry.remove<Position>(c);
+
+	// Structural changes from another thread are either made before a query starts or deferred until every query is done.
+	{
+		Registry shared;
+		for (int i = 0; i < 256; ++i) { shared.add(shared.create(), Position{ 1, 0, 0 }); }
+		Query<Position>& positions = shared.query<Position>();
+		std::thread changer([&]() {
+			for (int i = 0; i < 2000; ++i) {
+				entity::ID id = shared.create();
+				shared.add(id, Position{ 1, 0, 0 });
+				shared.add(id, Velocity{ 0, 0, 0 });
+				shared.destroy(id);
+			}
+		});
+		size_t damaged = 0;
+		for (int i = 0; i < 200; ++i) {
+			positions.forEach([&](std::span<const entity::ID>, std::span<Position> chunk) {
+				for (const Position& position : chunk) { if (position.x != 1) ++damaged; }
+			});
+		}
+		changer.join();
+		if (damaged != 0 || shared.size() != 256 || positions.count() != 256) {
+			printf("Structural changes from another thread disturbed a running query.\n");
+			success = false;
+		}
+	}
+
+	// Destroying many entities at once removes exactly those entities, whichever archetypes they're in.
+	std::vector<entity::ID> doomed;
+	size_t alive = 0;
+	for (size_t i = 0; i < created.size(); i += 3) {
+		doomed.push_back(created[i]);
+		if (registry.contains(created[i])) ++alive;
+	}
+	doomed.push_back(doomed.front()); // Duplicates and stale IDs are ignored.
+	doomed.push_back(created[1]);
+	size_t before = registry.size();
+	registry.destroyMany(doomed);
+	bool unlinked = (registry.size() == before - alive && registry.contains(c));
+	for (size_t i = 0; i < created.size() && unlinked; ++i) {
+		bool expected = (i % 3 != 0 && i % 8 != 1);
+		unlinked = (registry.contains(created[i]) == expected) && (!expected || registry.get<Position>(created[i])->x == (float)i * 2);
+	}
+	if (!unlinked) {
+		printf("Destroying many entities at once removed the wrong ones.\n");
+		success = false;
+	}
+
+	return success;
+}
+
+// Integrates 1M entities' positions, as a system running at the logical update rate would,
+// on one thread and then on every hardware thread.
+bool registry_benchmark() {
+	using namespace wc::ecs;
+	using namespace std::chrono;
+	bool success = true;
+	printf("Benchmarking the ECS registry...\n");
+
+	static const size_t COUNT = 1 << 20;
+	static const int FRAMES = 30;
+	Registry registry;
+
+	auto start = high_resolution_clock::now();
+	for (size_t i = 0; i < COUNT; ++i) {
+		entity::ID id = registry.create();
+		registry.add(id, Position{ 0, 0, 0 });
+		registry.add(id, Velocity{ 1, 0, 0 });
+	}
+	auto created = high_resolution_clock::now();
+	printf("create + 2 components: %.2f ns per entity.\n", duration<double, std::nano>(created - start).count() / COUNT);
+
+	// The same again, but recorded into a command buffer and applied at once, as systems and scripts do during a frame.
+	{
+		Registry batched;
+		CommandBuffer commands;
+		auto recordStart = high_resolution_clock::now();
+		for (size_t i = 0; i < COUNT / 4; ++i) {
+			entity::ID id = commands.create();
+			commands.add(id, Position{ 0, 0, 0 });
+			commands.add(id, Velocity{ 1, 0, 0 });
+		}
+		batched.apply(commands);
+		auto applied = high_resolution_clock::now();
+		printf("create + 2 components, deferred: %.2f ns per entity.\n", duration<double, std::nano>(applied - recordStart).count() / (COUNT / 4));
+		if (batched.query<Position, Velocity>().count() != COUNT / 4) {
+			printf("Deferred entities went missing.\n");
+			success = false;
+		}
+	}
+
+	auto integrate = [](std::span<const entity::ID>, std::span<Position> pos, std::span<Velocity> vel) {
+		for (size_t i = 0; i < pos.size(); ++i) {
+			pos[i].x += vel[i].x * (1.0f / 30.0f);
+			pos[i].y += vel[i].y * (1.0f / 30.0f);
+			pos[i].z += vel[i].z * (1.0f / 30.0f);
+		}
+	};
+	auto& query = registry.query<Position, Velocity>();
+
+	hvh::serial_executor serial;
+	start = high_resolution_clock::now();
+	for (int frame = 0; frame < FRAMES; ++frame) { query.forEach(serial, integrate); }
+	auto serialDone = high_resolution_clock::now();
+
+	hvh::thread_executor threads;
+	for (int frame = 0; frame < FRAMES; ++frame) { query.forEach(threads, integrate); }
+	auto threadedDone = high_resolution_clock::now();
+
+	printf("update, serial: %.3f ms per frame.\n", duration<double, std::milli>(serialDone - start).count() / FRAMES);
+	printf("update, thread_executor: %.3f ms per frame.\n", duration<double, std::milli>(threadedDone - serialDone).count() / FRAMES);
+
+	size_t wrong = 0;
+	query.forEachEntity([&](entity::ID, Position& pos, Velocity&) {
+		if (pos.x < 1.99f || pos.x > 2.01f) ++wrong;
+	});
+	if (wrong != 0) {
+		printf("%zi of %zi entities ended up in the wrong place.\n", wrong, COUNT);
+		success = false;
+	}
+	return success;
+}
@@ -0,0 +1,130 @@
+#include "scheduler.h"
+
+#include <algorithm>
+
+namespace wc::ecs {
+
+	SystemId Scheduler::add(const char* name, Phase phase, const SystemAccess& access, std::function<void()> func) {
+		SystemId id = (SystemId)systems.size();
+		System system;
+		system.name = name;
+		system.phase = phase;
+		system.access = access;
+		system.func = std::move(func);
+		systems.push_back(std::move(system));
+		phases[(size_t)phase].push_back(id);
+		dirty = true;
+		return id;
+	}
+
+	void Scheduler::setEnabled(SystemId id, bool enabled) {
+		if (systems[id].enabled == enabled) return;
+		systems[id].enabled = enabled;
+		dirty = true;
+	}
+
+	const std::vector<SystemId>& Scheduler::dependencies(SystemId id) {
+		build();
+		return systems[id].dependencies;
+	}
+
+	void Scheduler::build() {
+		if (!dirty) return;
+		for (System& system : systems) {
+			system.dependencies.clear();
+			system.dependents.clear();
+		}
+
+		// A system depends on every earlier system in its phase which it conflicts with.
+		// Edges which are implied by other edges aren't removed; it's cheaper to count them than to find them.
+		for (const std::vector<SystemId>& phase : phases) {
+			for (size_t j = 0; j < phase.size(); ++j) {
+				System& later = systems[phase[j]];
+				if (!later.enabled) continue;
+				for (size_t i = 0; i < j; ++i) {
+					System& earlier = systems[phase[i]];
+					if (!earlier.enabled || !earlier.access.conflicts(later.access)) continue;
+					later.dependencies.push_back(phase[i]);
+					earlier.dependents.push_back(phase[j]);
+				}
+			}
+		}
+		dirty = false;
+	}
+
+	bool Scheduler::hasMainThreadSystems(Phase phase) const {
+		for (SystemId id : phases[(size_t)phase]) {
+			if (systems[id].enabled && systems[id].access.mainThread) return true;
+		}
+		return false;
+	}
+
+	size_t Scheduler::beginPhase(Phase phase) {
+		build();
+		std::lock_guard<std::mutex> lock(mutex);
+		if (waitingCapacity < systems.size()) {
+			waitingCapacity = systems.size();
+			waitingOn.reset(new std::atomic<uint32_t>[waitingCapacity]);
+		}
+		ready.clear();
+		remaining = 0;
+		for (SystemId id : phases[(size_t)phase]) {
+			if (!systems[id].enabled) continue;
+			waitingOn[id] = (uint32_t)systems[id].dependencies.size();
+			if (waitingOn[id] == 0) ready.push_back(id);
+			++remaining;
+		}
+		// Take systems in the order they were added when there's a choice.
+		std::reverse(ready.begin(), ready.end());
+		return remaining;
+	}
+
+	void Scheduler::work() {
+		std::unique_lock<std::mutex> lock(mutex);
+		while (remaining > 0) {
+			if (ready.empty()) {
+				// Another worker is running a system which something still waits on.
+				wakeup.wait(lock);
+				continue;
+			}
+			SystemId id = ready.back();
+			ready.pop_back();
+
+			lock.unlock();
+			systems[id].func();
+			lock.lock();
+
+			--remaining;
+			for (SystemId dependent : systems[id].dependents) {
+				if (--waitingOn[dependent] == 0) ready.push_back(dependent);
+			}
+			wakeup.notify_all();
+		}
+	}
+
+	void Scheduler::run(Phase phase) {
+		if (beginPhase(phase) == 0) return;
+		jobs::Counter counter;
+		for (SystemId id : ready) { launch(id, counter); }
+		jobs::wait(counter);
+	}
+
+	void Scheduler::launch(SystemId id, jobs::Counter& counter) {
+		auto job = [this, id, &counter]() {
+			systems[id].func();
+			// Dependents are queued before this job finishes, so the counter can't reach zero early.
+			for (SystemId dependent : systems[id].dependents) {
+				if (waitingOn[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1) launch(dependent, counter);
+			}
+		};
+		// The main thread picks up its jobs while it waits on the counter in 'run'.
+		if (systems[id].access.mainThread) jobs::runOnMainThread(std::move(job), &counter);
+		else jobs::run(std::move(job), &counter);
+	}
+
+	Scheduler& scheduler() {
+		static Scheduler* result = new Scheduler();
+		return *result;
+	}
+
+} // namespace wc::ecs
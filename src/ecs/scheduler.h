@@ -0,0 +1,167 @@
+#ifndef HVH_WC_ECS_SCHEDULER_H
+#define HVH_WC_ECS_SCHEDULER_H
+
+#include "component_info.h"
+#include "jobs.h"
+#include "tools/executor.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace wc::ecs {
+
+	// The phases of a logical update which systems run in.
+	// Each phase runs alongside the matching event in 'events' (earlyLogicalUpdate, onLogicalUpdate, lateLogicalUpdate),
+	// and every system in one phase finishes before the next phase starts.
+	enum class Phase {
+		EARLY,
+		ON,
+		LATE
+	};
+	static constexpr size_t NUM_PHASES = 3;
+
+	// The components a system reads and writes.
+	// Two systems may run at the same time unless one of them writes a component which the other reads or writes.
+	// An exclusive system never runs alongside any other system; use this for anything which touches
+	// state that isn't a component but is shared between systems.
+	// Exclusive says nothing about which thread a system runs on. A main-thread system always runs on the main thread
+	// (see jobs::runOnMainThread); use this for anything which touches Lua or the window.
+	struct SystemAccess {
+		ComponentMask reads;
+		ComponentMask writes;
+		bool exclusive = false;
+		bool mainThread = false;
+
+		// Returns the access for a system over 'Ts...', where const types are read and non-const types are written.
+		template <typename... Ts>
+		static SystemAccess of() {
+			SystemAccess result;
+			(result.add<Ts>(), ...);
+			return result;
+		}
+		static SystemAccess makeExclusive() {
+			SystemAccess result;
+			result.exclusive = true;
+			return result;
+		}
+		static SystemAccess makeMainThread() {
+			SystemAccess result;
+			result.mainThread = true;
+			return result;
+		}
+
+		// Returns true if a system with this access can't run at the same time as one with 'other'.
+		bool conflicts(const SystemAccess& other) const {
+			return exclusive || other.exclusive
+				|| writes.intersects(other.reads) || writes.intersects(other.writes) || reads.intersects(other.writes);
+		}
+
+	private:
+		template <typename T>
+		void add() {
+			if (std::is_const_v<T>) reads.set(componentId<std::remove_const_t<T>>());
+			else writes.set(componentId<T>());
+		}
+	};
+
+	typedef uint32_t SystemId;
+
+	// Scheduler
+	// Runs systems once per logical frame, in parallel wherever their component access allows.
+	// Within a phase, systems are ordered by a dependency graph: a system waits for every system which was
+	// added before it in the same phase and conflicts with it. Systems which don't conflict run at the same time.
+	// The graph is rebuilt whenever systems are added or enabled or disabled, not every frame.
+	class Scheduler {
+	public:
+		Scheduler() {}
+		Scheduler(const Scheduler&) = delete;
+		Scheduler& operator = (const Scheduler&) = delete;
+
+		// Adds a system which calls 'func()' once per frame in the given phase.
+		// Returns an ID which can be used to enable or disable the system.
+		SystemId add(const char* name, Phase phase, const SystemAccess& access, std::function<void()> func);
+
+		// add<Ts...>(name, phase, func)
+		// Adds a system which accesses 'Ts...', where const types are read and non-const types are written.
+		template <typename... Ts>
+		SystemId add(const char* name, Phase phase, std::function<void()> func) {
+			return add(name, phase, SystemAccess::of<Ts...>(), std::move(func));
+		}
+
+		// Disabled systems are skipped, and nothing waits on them.
+		void setEnabled(SystemId id, bool enabled);
+		bool isEnabled(SystemId id) const { return systems[id].enabled; }
+
+		const char* name(SystemId id) const { return systems[id].name; }
+		size_t numSystems() const { return systems.size(); }
+		// Returns the systems which 'id' waits for before it runs.
+		const std::vector<SystemId>& dependencies(SystemId id);
+
+		// run(phase)
+		// Runs every enabled system in a phase on the job system, and waits for them all to finish.
+		// Each system is queued as a job as soon as everything it depends on has finished;
+		// main-thread systems are queued for the main thread, so this must be called from the main thread.
+		void run(Phase phase);
+
+		// run(phase, exec)
+		// Like run(phase), but the systems are handed out to the executor's threads instead.
+		// Each executor task takes systems until the phase is done, waiting whenever none are ready,
+		// so this should only be given executors with dedicated threads (not jobs::executor).
+		// The executor's threads can't run main-thread systems, so if the phase has any (enabled), nothing is run.
+		// Returns false if the phase wasn't run.
+		template <typename ExecT>
+		bool run(Phase phase, ExecT& exec) {
+			if (hasMainThreadSystems(phase)) return false;
+			size_t workers = beginPhase(phase);
+			if (workers == 0) return true;
+			exec.run(workers, [this](size_t) { work(); });
+			return true;
+		}
+
+	private:
+		struct System {
+			const char* name;
+			Phase phase;
+			SystemAccess access;
+			std::function<void()> func;
+			bool enabled = true;
+			std::vector<SystemId> dependencies;
+			std::vector<SystemId> dependents;
+		};
+
+		// Rebuilds the dependency graph if it's out of date.
+		void build();
+		// Returns true if any enabled system in a phase must run on the main thread.
+		bool hasMainThreadSystems(Phase phase) const;
+		// Sets up a phase to run, and returns how many workers it can use.
+		size_t beginPhase(Phase phase);
+		// Runs systems from the current phase until every one has finished.
+		void work();
+		// Queues a system as a job, which queues its dependents once it's done.
+		void launch(SystemId id, jobs::Counter& counter);
+
+		std::vector<System> systems;
+		std::vector<SystemId> phases[NUM_PHASES];
+		bool dirty = false;
+
+		// The state of the phase which is currently running, guarded by 'mutex'.
+		std::mutex mutex;
+		std::condition_variable wakeup;
+		std::vector<SystemId> ready;
+		// How many unfinished systems each system is still waiting for.
+		std::unique_ptr<std::atomic<uint32_t>[]> waitingOn;
+		size_t waitingCapacity = 0;
+		size_t remaining = 0;
+	};
+
+	// The engine's scheduler, which runs its systems every logical update.
+	Scheduler& scheduler();
+
+} // namespace wc::ecs
+
+#endif // HVH_WC_ECS_SCHEDULER_H
@@ -0,0 +1,114 @@
+#include "scheduler.h"
+#include "registry.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace {
+	struct SchedPosition { float x, y, z; };
+	struct SchedVelocity { float x, y, z; };
+	struct SchedHealth { float hp; };
+}
+
+bool scheduler_test() {
+	using namespace wc::ecs;
+	bool success = true;
+	printf("Testing the system scheduler...\n");
+
+	// Each system records when it started and finished, so we can check that conflicting systems never overlapped.
+	std::atomic<int> clock = 0;
+	struct Span { int start = -1, end = -1; };
+	std::vector<Span> spans(6);
+	auto timed = [&](size_t i) {
+		return [&, i]() {
+			spans[i].start = clock++;
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			spans[i].end = clock++;
+		};
+	};
+
+	Scheduler scheduler;
+	SystemId move = scheduler.add<SchedPosition, const SchedVelocity>("move", Phase::ON, timed(0));
+	SystemId damage = scheduler.add<SchedHealth>("damage", Phase::ON, timed(1));
+	SystemId render = scheduler.add<const SchedPosition>("render", Phase::ON, timed(2));
+	SystemId steer = scheduler.add<SchedVelocity>("steer", Phase::ON, timed(3));
+	SystemId script = scheduler.add("script", Phase::ON, SystemAccess::makeExclusive(), timed(4));
+	SystemId early = scheduler.add<SchedPosition>("early", Phase::EARLY, timed(5));
+
+	auto dependsOn = [&](SystemId a, SystemId b) {
+		const std::vector<SystemId>& deps = scheduler.dependencies(a);
+		return std::find(deps.begin(), deps.end(), b) != deps.end();
+	};
+	if (!dependsOn(render, move) || !dependsOn(steer, move) || dependsOn(damage, move) || dependsOn(render, damage)
+		|| !dependsOn(script, move) || !dependsOn(script, damage) || scheduler.dependencies(early).size() != 0) {
+		printf("The dependency graph is wrong.\n");
+		success = false;
+	}
+
+	hvh::thread_executor threads(4);
+	scheduler.run(Phase::EARLY, threads);
+	scheduler.run(Phase::ON, threads);
+	auto after = [&](SystemId a, SystemId b) { return spans[a].start > spans[b].end; };
+	if (!after(render, move) || !after(steer, move) || !after(script, render) || !after(script, damage) || !after(move, early)) {
+		printf("Systems ran before the systems they depend on finished.\n");
+		success = false;
+	}
+
+	// Disabled systems don't run, and nothing waits for them.
+	scheduler.setEnabled(move, false);
+	spans.assign(6, Span());
+	scheduler.run(Phase::ON, threads);
+	if (spans[move].start != -1 || dependsOn(render, move) || spans[render].start == -1) {
+		printf("Disabling a system didn't take it out of the graph.\n");
+		success = false;
+	}
+
+	// Main-thread systems run on the main thread, even when they're queued by a system which ran on another one.
+	wc::jobs::init(4);
+	Scheduler mainThread;
+	std::atomic<int> onMainThread = 0, offMainThread = 0;
+	auto recordThread = [&]() { ++(wc::jobs::isMainThread() ? onMainThread : offMainThread); };
+	SystemAccess luaAccess = SystemAccess::of<const SchedPosition>();
+	luaAccess.mainThread = true;
+	mainThread.add<SchedPosition>("move", Phase::ON, timed(0));
+	mainThread.add("lua", Phase::ON, luaAccess, recordThread);
+	mainThread.add("window", Phase::ON, SystemAccess::makeMainThread(), recordThread);
+	mainThread.run(Phase::ON);
+	bool rejected = !mainThread.run(Phase::ON, threads);
+	wc::jobs::shutdown();
+	if (onMainThread != 2 || offMainThread != 0 || !rejected) {
+		printf("Main-thread systems ran on another thread (or were handed to an executor).\n");
+		success = false;
+	}
+
+	// Systems which query a registry in parallel have their structural changes deferred until every query is done.
+	Registry registry;
+	for (int i = 0; i < 100; ++i) {
+		entity::ID id = registry.create();
+		registry.add(id, SchedPosition{ 0, 0, 0 });
+		registry.add(id, SchedHealth{ (float)(i % 10) });
+	}
+	// Queries are cached on first use, which isn't thread-safe, so create them up front.
+	registry.query<SchedPosition>();
+	registry.query<SchedHealth>();
+	Scheduler ecs;
+	ecs.add<SchedPosition>("move", Phase::ON, [&]() {
+		registry.query<SchedPosition>().forEachEntity([](entity::ID, SchedPosition& pos) { pos.x += 1; });
+	});
+	ecs.add<SchedHealth>("reap", Phase::ON, [&]() {
+		registry.query<SchedHealth>().forEachEntity([&](entity::ID id, SchedHealth& health) {
+			if (health.hp == 0) registry.destroy(id);
+		});
+	});
+	ecs.run(Phase::ON, threads);
+	if (registry.size() != 90) {
+		printf("Expected 90 entities to survive, found %zi.\n", registry.size());
+		success = false;
+	}
+
+	return success;
+}
@@ -0,0 +1,148 @@
+#include "world.h"
+#include "registry.h"
+#include "interpolation.h"
+#include "components/TransformComponent.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "debug.h"
+#include "jobs.h"
+
+namespace {
+
+	std::unique_ptr<wc::ecs::World> theWorld;
+
+} // namespace <anon>
+
+namespace wc::ecs {
+
+	World::World(int32_t threads) {
+		if (threads == 0) {
+			// The calling thread is counted by both pools.
+			int32_t hardware = std::max((int32_t)std::thread::hardware_concurrency(), 1);
+			int32_t jobThreads = std::max((int32_t)jobs::numThreads(), 1);
+			threads = std::max(hardware - jobThreads + 1, 1);
+		}
+		if (threads > 1) myworld.set_threads(threads);
+		myworld.component<EntityRef>();
+		myworld.component<Name>();
+	}
+
+	World::~World() {
+		// The entities' IDs are released along with the flecs world.
+		for (size_t i = 0; i < mapping.size(); ++i) { entity::destroy(mapping.at<0>(i)); }
+	}
+
+	entity::ID World::create() {
+		entity::ID id = entity::create();
+		flecs::entity e = myworld.entity().set<EntityRef>({ id });
+		if (!mapping.insert(id, e.id())) {
+			debug::error("In wc::ecs::World::create():\n");
+			debug::errmore("Failed to map ", entity::toString(id), " to a flecs entity.\n");
+			e.destruct();
+			entity::destroy(id);
+			return 0;
+		}
+		return id;
+	}
+
+	void World::destroy(entity::ID id) {
+		flecs::entity_t e = lookup(id);
+		if (!e) return;
+		names.removeName(id);
+		flecs::entity(myworld, e).destruct();
+		mapping.erase(id);
+		entity::destroy(id);
+	}
+
+	void World::detachMany(std::span<const entity::ID> ids) {
+		for (entity::ID id : ids) {
+			flecs::entity_t e = lookup(id);
+			if (!e || entity::isAlive(id)) continue;
+			names.removeName(id);
+			flecs::entity(myworld, e).destruct();
+			mapping.erase(id);
+		}
+	}
+
+	void World::setName(entity::ID id, const char* name) {
+		strings::Handle handle = strings::intern(name);
+		if (progressing) {
+			std::lock_guard<std::mutex> lock(pendingMutex);
+			pendingNames.push_back({ id, handle });
+			return;
+		}
+		applyName(id, handle);
+	}
+
+	void World::removeName(entity::ID id) {
+		if (progressing) {
+			std::lock_guard<std::mutex> lock(pendingMutex);
+			pendingNames.push_back({ id, 0 });
+			return;
+		}
+		applyName(id, 0);
+	}
+
+	void World::applyName(entity::ID id, strings::Handle handle) {
+		flecs::entity_t e = lookup(id);
+		if (!e) return;
+		names.setName(id, handle);
+		if (handle == 0) flecs::entity(myworld, e).remove<Name>();
+		else flecs::entity(myworld, e).set<Name>({ handle });
+	}
+
+	void World::progress(double deltatime) {
+		progressing = true;
+		myworld.progress((ecs_ftime_t)deltatime);
+		progressing = false;
+		for (const auto& [id, handle] : pendingNames) { applyName(id, handle); }
+		pendingNames.clear();
+	}
+
+	flecs::entity_t World::flecsPhase(Phase phase) {
+		switch (phase) {
+		case Phase::EARLY: return flecs::PreUpdate;
+		case Phase::LATE: return flecs::PostUpdate;
+		default: return flecs::OnUpdate;
+		}
+	}
+
+	World& world() {
+		return *theWorld;
+	}
+
+	bool init() {
+		// The deferred command buffers are sized to the job system, so they're made once it's running.
+		registry();
+		commands();
+		theWorld = std::make_unique<World>();
+
+		// World matrices are drawn part way between the last two logical ticks.
+		interpolation().track("transform", 12, [](std::vector<entity::ID>& ids, std::vector<float>& values) {
+			std::span<const entity::ID> source = transforms().ids();
+			std::span<const Float4x4> worlds = transforms().worlds();
+			ids.clear();
+			values.resize(source.size() * 12);
+			float* out = values.data();
+			for (size_t i = 0; i < source.size(); ++i) {
+				// Unused rows have an ID of 0.
+				if (source[i] == 0) continue;
+				ids.push_back(source[i]);
+				for (int row = 0; row < 4; ++row, out += 3) {
+					out[0] = worlds[i].m[row][0]; out[1] = worlds[i].m[row][1]; out[2] = worlds[i].m[row][2];
+				}
+			}
+			values.resize(ids.size() * 12);
+		});
+		return true;
+	}
+
+	void shutdown() {
+		theWorld.reset();
+	}
+
+} // namespace wc::ecs
@@ -0,0 +1,171 @@
+#ifndef HVH_WC_ECS_WORLD_H
+#define HVH_WC_ECS_WORLD_H
+
+#include "flecs.h"
+
+#include "entity.h"
+#include "scheduler.h"
+#include "components/NameComponent.h"
+#include "stringtable.h"
+#include "tools/sparse_soa.hpp"
+
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace wc::ecs {
+
+	// Every flecs entity made through a World carries the engine's ID for it,
+	// so systems can hand engine IDs (rather than flecs IDs) back to game code.
+	struct EntityRef {
+		entity::ID id;
+	};
+
+	// An entity's name, stored as a flecs component so systems can read it (see wc::strings::view).
+	// Set names through World::setName, which also keeps the name lookup up to date.
+	struct Name {
+		strings::Handle value;
+	};
+
+	// World
+	// Entities and components backed by flecs.
+	// Entities are created through entity::create, so they share the engine's IDs (and persistent IDs);
+	// each one is paired with a flecs entity, which holds its components.
+	// Systems are registered into flecs' pipeline and all run once per call to 'progress'.
+	//
+	// Every entity belongs to exactly one store: the World or the Registry which created it.
+	// Each ignores IDs made by the other (or by a bare entity::create): lookups fail, and destroy does nothing.
+	// Entities should be destroyed through the World which created them. One which is destroyed with entity::destroy
+	// instead keeps its flecs entity (and appears in 'contains') until it's passed to detachMany, which the main loop
+	// does at the end of every logical frame with everything destroyed during it.
+	class World {
+	public:
+		// Creates a world whose systems run on 'threads' threads, counting the calling thread.
+		// More than one makes flecs start worker threads of its own, alongside the job system's.
+		// If 'threads' is 0, the world uses every hardware thread which the job system doesn't, plus the calling thread,
+		// so the two pools share the cores rather than competing for them (see jobs::init in main).
+		World(int32_t threads = 0);
+		~World();
+		World(const World&) = delete;
+		World& operator = (const World&) = delete;
+
+		// Creates an entity with no components.
+		// Complexity: O(1).
+		entity::ID create();
+		// Destroys an entity and all of its components.
+		// Complexity: O(components).
+		void destroy(entity::ID id);
+		// Drops the flecs entities of entities which were destroyed without going through this world.
+		// IDs which aren't in this world, or whose entities are still alive, are ignored.
+		// Complexity: O(n).
+		void detachMany(std::span<const entity::ID> ids);
+		// Returns true if the entity was created by this world and has not been destroyed.
+		bool contains(entity::ID id) const { return mapping.contains(id); }
+		// Returns the number of entities in the world.
+		size_t size() const { return mapping.size(); }
+
+		// Sets an entity's component, adding it if the entity doesn't have one.
+		// Returns false if the entity is not in this world.
+		template <typename T>
+		bool set(entity::ID id, const T& value) {
+			flecs::entity_t e = lookup(id);
+			if (!e) return false;
+			flecs::entity(myworld, e).set<T>(value);
+			return true;
+		}
+
+		// Returns a pointer to an entity's component, or nullptr if it doesn't have one.
+		// The pointer is invalidated when components are added to or removed from the entity.
+		template <typename T>
+		const T* get(entity::ID id) const {
+			flecs::entity_t e = lookup(id);
+			return e ? flecs::entity(myworld, e).get<T>() : nullptr;
+		}
+		template <typename T>
+		T* getMut(entity::ID id) {
+			flecs::entity_t e = lookup(id);
+			if (!e || !flecs::entity(myworld, e).has<T>()) return nullptr;
+			return flecs::entity(myworld, e).get_mut<T>();
+		}
+
+		template <typename T>
+		bool has(entity::ID id) const {
+			flecs::entity_t e = lookup(id);
+			return e && flecs::entity(myworld, e).has<T>();
+		}
+
+		// Removes a component from an entity.
+		// Returns false if the entity is not in this world or doesn't have the component.
+		template <typename T>
+		bool remove(entity::ID id) {
+			flecs::entity_t e = lookup(id);
+			if (!e || !flecs::entity(myworld, e).has<T>()) return false;
+			flecs::entity(myworld, e).remove<T>();
+			return true;
+		}
+
+		// Names are kept both as a flecs component and in a name index, so entities can be found by name.
+		// Systems may rename entities while 'progress' is running; the changes are recorded, and applied in the order
+		// they were made once every system has finished, so the index never changes underneath a system reading it.
+		// Otherwise names must only be changed from the main thread.
+		void setName(entity::ID id, const char* name);
+		const char* getName(entity::ID id) const { return names.getName(id); }
+		void removeName(entity::ID id);
+		entity::ID findWithName(const char* name) const { return names.findWithName(name); }
+		// See NameComponent::findWithPrefix and NameComponent::findMatching.
+		void findWithPrefix(const char* prefix, std::vector<entity::ID>& result) const { names.findWithPrefix(prefix, result); }
+		void findMatching(const char* pattern, std::vector<entity::ID>& result) const { names.findMatching(pattern, result); }
+
+		// system<Ts...>(name, phase, func)
+		// Registers a system which calls 'func(entity::ID, Ts&...)' for every entity with all of 'Ts...',
+		// once per call to 'progress', in flecs' PreUpdate, OnUpdate, or PostUpdate pipeline phase.
+		// Systems may run on several threads at once, each taking a share of the entities,
+		// so 'func' must only touch the components it's given.
+		template <typename... Ts, typename FuncT>
+		flecs::entity system(const char* name, Phase phase, FuncT&& func) {
+			return myworld.system<const EntityRef, Ts...>(name)
+				.kind(flecsPhase(phase))
+				.multi_threaded(true)
+				.each([func = std::forward<FuncT>(func)](const EntityRef& ref, Ts&... components) {
+					func(ref.id, components...);
+				});
+		}
+
+		// Runs every system once.
+		void progress(double deltatime);
+
+		// The underlying flecs world, for anything the facade doesn't cover.
+		flecs::world& flecsWorld() { return myworld; }
+
+	private:
+		static flecs::entity_t flecsPhase(Phase phase);
+
+		// Returns the flecs entity paired with an engine entity, or 0 if it's not in this world.
+		flecs::entity_t lookup(entity::ID id) const {
+			size_t index = mapping.find(id);
+			return (index == SIZE_MAX) ? 0 : mapping.template at<1>(index);
+		}
+
+		// Gives an entity an interned name (or removes it, for handle 0), now.
+		void applyName(entity::ID id, strings::Handle handle);
+
+		flecs::world myworld;
+		hvh::sparse_soa<entity::ID, flecs::entity_t> mapping;
+		NameComponent names;
+
+		// True while 'progress' is running systems, and the name changes they've made, which are applied afterwards.
+		bool progressing = false;
+		std::mutex pendingMutex;
+		std::vector<std::pair<entity::ID, strings::Handle>> pendingNames;
+	};
+
+	// The engine's world, which exists between wc::startup and wc::shutdown.
+	// Its systems are run once per logical update, after the onLogicalUpdate event.
+	World& world();
+	bool init();
+	void shutdown();
+
+} // namespace wc::ecs
+
+#endif // HVH_WC_ECS_WORLD_H
@@ -0,0 +1,196 @@
+#include "world.h"
+#include "main.h"
+#include "tools/htable.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+	struct WorldPosition { float x, y, z; };
+	struct WorldVelocity { float x, y, z; };
+}
+
+bool world_test() {
+	using namespace wc::ecs;
+	bool success = true;
+	printf("Testing the flecs world...\n");
+
+	World world(1);
+	entity::ID a = world.create();
+	entity::ID b = world.create();
+	world.set(a, WorldPosition{ 0, 0, 0 });
+	world.set(a, WorldVelocity{ 1, 2, 3 });
+	world.set(b, WorldPosition{ 5, 5, 5 });
+	world.setName(b, "bee");
+
+	if (!world.contains(a) || !entity::isAlive(a) || !world.has<WorldVelocity>(a) || world.has<WorldVelocity>(b)
+		|| world.get<WorldPosition>(b)->x != 5) {
+		printf("Components weren't stored where they were set.\n");
+		success = false;
+	}
+	if (world.findWithName("bee") != b || strcmp(world.getName(b), "bee") != 0 || world.findWithName("a") != 0) {
+		printf("Name lookup failed.\n");
+		success = false;
+	}
+
+	// Names can be searched by prefix and by wildcard pattern; renaming an entity moves it in the index.
+	std::vector<entity::ID> found;
+	std::vector<entity::ID> named;
+	for (int i = 0; i < 20; ++i) {
+		named.push_back(world.create());
+		world.setName(named.back(), ((i % 2 ? "goblin_" : "gobbler_") + std::to_string(i)).c_str());
+	}
+	world.setName(named[0], "orc_0");
+	world.findWithPrefix("gob", found);
+	bool searched = (found.size() == 19);
+	world.findWithPrefix("goblin_1", found);
+	searched = searched && (found.size() == 6); // 1, 11, 13, 15, 17 and 19.
+	world.findMatching("gob*_?", found);
+	searched = searched && (found.size() == 9); // Every one-digit number but 0, which is now an orc.
+	world.findMatching("*_1?", found);
+	searched = searched && (found.size() == 10);
+	world.findMatching("orc_0", found);
+	searched = searched && (found.size() == 1 && found[0] == named[0] && strcmp(world.getName(named[0]), "orc_0") == 0);
+	if (!searched) {
+		printf("Name searches found the wrong entities.\n");
+		success = false;
+	}
+	for (entity::ID id : named) { world.destroy(id); }
+	world.findWithPrefix("", found);
+	if (found.size() != 1 || found[0] != b) {
+		printf("Destroyed entities are still in the name index.\n");
+		success = false;
+	}
+
+	// Systems see the engine's IDs, and only run on entities with every component they ask for.
+	size_t visited = 0;
+	world.system<WorldPosition, const WorldVelocity>("Move", Phase::ON, [&](entity::ID id, WorldPosition& pos, const WorldVelocity& vel) {
+		if (id == a) ++visited;
+		pos.x += vel.x; pos.y += vel.y; pos.z += vel.z;
+	});
+	world.progress(wc::LOGICAL_SECONDS_PER_FRAME);
+	world.progress(wc::LOGICAL_SECONDS_PER_FRAME);
+	if (visited != 2 || world.get<WorldPosition>(a)->z != 6 || world.get<WorldPosition>(b)->x != 5) {
+		printf("System ran on the wrong entities.\n");
+		success = false;
+	}
+
+	// Names changed by systems are only applied once every system has run.
+	bool renamedEarly = false;
+	world.system<const WorldPosition>("Rename", Phase::LATE, [&](entity::ID id, const WorldPosition&) {
+		if (id != b) return;
+		world.setName(b, "wasp");
+		renamedEarly = (strcmp(world.getName(b), "bee") != 0);
+	});
+	world.progress(wc::LOGICAL_SECONDS_PER_FRAME);
+	if (renamedEarly || strcmp(world.getName(b), "wasp") != 0 || world.findWithName("bee") != 0 || world.findWithName("wasp") != b) {
+		printf("Renaming an entity from a system wasn't deferred until the systems were done.\n");
+		success = false;
+	}
+
+	// An entity destroyed behind the world's back keeps its flecs entity until it's detached.
+	entity::ID stray = world.create();
+	world.set(stray, WorldPosition{ 1, 1, 1 });
+	world.setName(stray, "stray");
+	entity::destroy(stray);
+	world.detachMany(std::span<const entity::ID>(&b, 1));
+	world.detachMany(std::span<const entity::ID>(&stray, 1));
+	if (world.contains(stray) || !world.contains(b) || world.findWithName("stray") != 0 || world.size() != 2) {
+		printf("Detaching an entity destroyed elsewhere didn't drop it (or dropped a live one).\n");
+		success = false;
+	}
+
+	world.destroy(b);
+	if (world.contains(b) || entity::isAlive(b) || world.findWithName("wasp") != 0 || world.size() != 1) {
+		printf("Destroyed entity is still in the world.\n");
+		success = false;
+	}
+	world.destroy(a);
+
+	return success;
+}
+
+// Compares setting, getting, and updating components in a flecs world against
+// the old path of one htable per component, keyed by entity ID.
+// The world is measured running its systems on one thread, then multithreaded across every hardware thread.
+bool world_benchmark() {
+	using namespace wc::ecs;
+	using namespace std::chrono;
+	bool success = true;
+	printf("Benchmarking the flecs world...\n");
+
+	static const size_t COUNT = 1 << 18;
+	static const int FRAMES = 30;
+	std::vector<entity::ID> ids(COUNT);
+	float total = 0;
+
+	// The htable path.
+	hvh::htable<entity::ID, WorldPosition> positions;
+	hvh::htable<entity::ID, WorldVelocity> velocities;
+	auto start = high_resolution_clock::now();
+	for (size_t i = 0; i < COUNT; ++i) {
+		ids[i] = entity::create();
+		positions.insert(ids[i], WorldPosition{ 0, 0, 0 });
+		velocities.insert(ids[i], WorldVelocity{ 1, 0, 0 });
+	}
+	auto created = high_resolution_clock::now();
+	for (size_t i = 0; i < COUNT; ++i) { total += positions.at<1>(positions.find(ids[(i * 7919) % COUNT])).x; }
+	auto looked = high_resolution_clock::now();
+	for (int frame = 0; frame < FRAMES; ++frame) {
+		for (size_t i = 0; i < velocities.size(); ++i) {
+			size_t p = positions.find(velocities.at<0>(i));
+			if (p == SIZE_MAX) continue;
+			positions.at<1>(p).x += velocities.at<1>(i).x;
+		}
+	}
+	auto updated = high_resolution_clock::now();
+	printf("htable components: create %.2f ns, get %.2f ns, update %.3f ms per frame.\n",
+		duration<double, std::nano>(created - start).count() / COUNT,
+		duration<double, std::nano>(looked - created).count() / COUNT,
+		duration<double, std::milli>(updated - looked).count() / FRAMES);
+	for (entity::ID id : ids) { entity::destroy(id); }
+
+	// The flecs world, with systems on the calling thread and then on flecs' worker threads.
+	int32_t hardware = std::max((int32_t)std::thread::hardware_concurrency(), 2);
+	for (int32_t threads : { 1, hardware }) {
+		World world(threads);
+		start = high_resolution_clock::now();
+		for (size_t i = 0; i < COUNT; ++i) {
+			ids[i] = world.create();
+			world.set(ids[i], WorldPosition{ 0, 0, 0 });
+			world.set(ids[i], WorldVelocity{ 1, 0, 0 });
+		}
+		created = high_resolution_clock::now();
+		for (size_t i = 0; i < COUNT; ++i) { total += world.get<WorldPosition>(ids[(i * 7919) % COUNT])->x; }
+		looked = high_resolution_clock::now();
+		world.system<WorldPosition, const WorldVelocity>("Move", Phase::ON, [](entity::ID, WorldPosition& pos, const WorldVelocity& vel) {
+			pos.x += vel.x;
+		});
+		for (int frame = 0; frame < FRAMES; ++frame) { world.progress(wc::LOGICAL_SECONDS_PER_FRAME); }
+		updated = high_resolution_clock::now();
+		printf("flecs world (%i threads): create %.2f ns, get %.2f ns, update %.3f ms per frame.\n", (int)threads,
+			duration<double, std::nano>(created - start).count() / COUNT,
+			duration<double, std::nano>(looked - created).count() / COUNT,
+			duration<double, std::milli>(updated - looked).count() / FRAMES);
+
+		bool updatedAll = true;
+		for (size_t i = 0; i < COUNT; ++i) {
+			if (world.get<WorldPosition>(ids[i])->x != (float)FRAMES) { updatedAll = false; }
+		}
+		if (!updatedAll) {
+			printf("Some entities weren't updated every frame with %i threads.\n", (int)threads);
+			success = false;
+		}
+	}
+
+	if (total != 0) {
+		printf("Components were read back wrong.\n");
+		success = false;
+	}
+	return success;
+}
@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <fstream>
 #include "debug.h"
+#include "jobs.h"
 #include "tools/soa.hpp"
 #include "tools/stringhelper.h"
 #include "tools/crossplatform.h"
@@ -68,7 +69,30 @@ namespace wc {
 			return false;
 		}
 
-		if (_header.numfiles > 0) {
+		if (_header.numfiles > 0 && _header.version >= 4) {
+			// Since version 5 the header says how large the dictionary is;
+			// version 4 archives only wrote it at 'back' and left it running to the end of the file.
+			size_t dictsize = _header.dictbytes;
+			if (_header.version == 4) {
+				fseek64(_file, 0, SEEK_END);
+				int64_t fileend = ftell64(_file);
+				dictsize = (fileend > (int64_t)_header.back) ? (size_t)(fileend - _header.back) : 0;
+			}
+			std::vector<uint8_t> dictdata(dictsize);
+			fseek64(_file, _header.back, SEEK_SET);
+			size_t bytesread = fread(dictdata.data(), 1, dictdata.size(), _file);
+
+			if (bytesread != dictdata.size() || !_dictionary.load(dictdata.data(), dictdata.size()) || _dictionary.size() != _header.numfiles) {
+				debug::error("In wc::Archive::open():\n");
+				debug::errmore("Failed to load dictionary data.\n");
+				_dictionary.clear();
+				fclose(_file);
+				_file = nullptr;
+				return false;
+			}
+		}
+		else if (_header.numfiles > 0) {
+			// Archives older than version 4 store the dictionary as a raw memory dump.
 			// Reserve space for the dictionary.
 			size_t dictbytes;
 			void* dictmem = _dictionary.deserialize(_header.numfiles, dictbytes);
@@ -108,10 +132,8 @@ namespace wc {
 
 			_dictionary.shrink_to_fit();
 			_header.numfiles = (uint32_t)_dictionary.size();
-
-			// Update the archive header.
-			fseek64(_file, 0, SEEK_SET);
-			fwrite(&_header, sizeof(Archive::Header), 1, _file);
+			// The dictionary is always saved in the current format, even if the archive was older.
+			_header.version = CURRENT_VERSION;
 
 			// If we deleted or overwrote anything in the archive,
 			// we should rebuild the whole thing.
@@ -120,15 +142,21 @@ namespace wc {
 			}
 			else {
 				// Otherwise, we can just re-write the dictionary at the end.
-				fseek64(_file, _header.back, SEEK_SET);
+				// Whatever was in the file past the new dictionary is left alone; the header says where the dictionary stops.
+				std::vector<uint8_t> dictdata;
+				_dictionary.save(dictdata, true);
+				_header.dictbytes = (uint32_t)dictdata.size();
+
+				// Update the archive header.
+				fseek64(_file, 0, SEEK_SET);
+				fwrite(&_header, sizeof(Archive::Header), 1, _file);
 
-				size_t dictbytes;
-				void* dictmem = _dictionary.serialize(dictbytes);
-				size_t byteswritten = fwrite(dictmem, 1, dictbytes, _file);
-				if (byteswritten != dictbytes) {
+				fseek64(_file, _header.back, SEEK_SET);
+				size_t byteswritten = fwrite(dictdata.data(), 1, dictdata.size(), _file);
+				if (byteswritten != dictdata.size()) {
 					debug::error("In wc::Archive::close():\n");
 					debug::errmore("Failed to save the dictionary data.\n");
-					debug::errmore("Expected ", dictbytes, " bytes, wrote ", byteswritten, ".\n");
+					debug::errmore("Expected ", dictdata.size(), " bytes, wrote ", byteswritten, ".\n");
 				}
 			}
 		}
@@ -154,6 +182,7 @@ namespace wc {
 		FILE* tempfile = fopen_w(temppath.c_str());
 
 		// First we write the header to the new archive.
+		_header.version = CURRENT_VERSION;
 		fwrite(&_header, sizeof(Archive::Header), 1, tempfile);
 		uint64_t newback = sizeof(Archive::Header);
 
@@ -184,12 +213,13 @@ namespace wc {
 		}
 
 		// Now we write the dictionary to the temporary archive.
-		size_t dictbytes;
-		void* dictmem = _dictionary.serialize(dictbytes);
-		fwrite(dictmem, 1, dictbytes, tempfile);
+		std::vector<uint8_t> dictdata;
+		_dictionary.save(dictdata, true);
+		fwrite(dictdata.data(), 1, dictdata.size(), tempfile);
 
 		//Since our 'back' has changed, we need to correct it and re-write the header.
 		_header.back = newback;
+		_header.dictbytes = (uint32_t)dictdata.size();
 		fseek64(tempfile, 0, SEEK_SET);
 		fwrite(&_header, sizeof(Archive::Header), 1, tempfile);
 
@@ -210,13 +240,13 @@ namespace wc {
 		if (_file == nullptr) return -1;
 
 		// Find the index of the file we're looking for.
-		fixedstring<Archive::FILEPATH_FIXEDLEN> fixedpath(path);
-		size_t index = _dictionary.find(fixedpath, true);
+		auto it = _dictionary.equal_range(path).begin();
+		size_t index = *it;
 		if (index == SIZE_MAX) {
 			return -1;
 		}
 
-		_dictionary.erase_found();
+		_dictionary.erase(it);
 		_modified = true;
 		_files_deleted = true;
 
@@ -228,8 +258,7 @@ namespace wc {
 		if (_file == nullptr) return false;
 
 		// Look for the file.
-		fixedstring<Archive::FILEPATH_FIXEDLEN> fixedpath(path);
-		size_t index = _dictionary.find(fixedpath);
+		size_t index = _dictionary.find(path);
 		return (index != SIZE_MAX);
 	}
 
@@ -238,8 +267,7 @@ namespace wc {
 		if (_file == nullptr) { return false; }
 
 		// Search for the file we're looking for.
-		fixedstring<Archive::FILEPATH_FIXEDLEN> fixedpath(path);
-		size_t index = _dictionary.find(fixedpath);
+		size_t index = _dictionary.find(path);
 		if (index == SIZE_MAX) {
 			debug::error("In wc::Archive::extract_data(\"", path, "\"):\n");
 			debug::errmore("Failed to find file.\n");
@@ -314,49 +342,60 @@ namespace wc {
 		}
 	}
 
+	void Archive::compress_data(const char* path, const void* buffer, int32_t size, timestamp_t timestamp, CompressEnum compress, FileInfo& info, std::vector<char>& compressed) {
+		info = {};
+		info.size_compressed = size;
+		info.size_uncompressed = size;
+		info.timestamp = timestamp;
+		compressed.clear();
+		if (compress == DO_NOT_COMPRESS) return;
+
+		compressed.resize(LZ4_compressBound(size));
+		int32_t result = 0;
+		if (compress == COMPRESS_FAST) {
+			result = LZ4_compress_default((const char*)buffer, compressed.data(), size, (int)compressed.size());
+		}
+		else if (compress == COMPRESS_SMALL) {
+			result = LZ4_compress_HC((const char*)buffer, compressed.data(), size, (int)compressed.size(), 9);
+		}
+		// Compression failed
+		if (result <= 0) {
+			debug::warning("In wc::Archive::insert_data(\"", path, "\"):\n");
+			debug::warnmore("Failed to compress file; will store uncompressed.\n");
+			compressed.clear();
+		}
+		// Compression success
+		else {
+			info.size_compressed = result;
+			info.flags |= FILEFLAG_COMPRESSED;
+			compressed.resize(result);
+		}
+	}
+
 	bool Archive::insert_data(const char* path, void* buffer, int32_t size, timestamp_t timestamp, ReplaceEnum replace, CompressEnum compress) {
 		// Make sure the archive is open.
 		if (_file == nullptr) return false;
 
+		// Handle file compression.
+		FileInfo newinfo;
+		std::vector<char> compressed_buffer;
+		compress_data(path, buffer, size, timestamp, compress, newinfo, compressed_buffer);
+		return insert_compressed(path, compressed_buffer.empty() ? buffer : compressed_buffer.data(), newinfo, replace);
+	}
+
+	bool Archive::insert_compressed(const char* path, const void* data, FileInfo newinfo, ReplaceEnum replace) {
 		// Copy the file's path and convert backslashes to forward slashes.
 		// Functions like extract and exists will simply fail if given backslashes.
 		fixedstring<FILEPATH_FIXEDLEN> newpath(path);
 		strip_backslashes(newpath.c_str);
-
-		// Create a dictionary entry for the new file.
-		FileInfo newinfo = {};
 		newinfo.offset = _header.back;
-		newinfo.size_compressed = size;
-		newinfo.size_uncompressed = size;
-		newinfo.timestamp = timestamp;
-
-		// Handle file compression.
-		std::vector<char> compressed_buffer(LZ4_compressBound(size));
-		if (compress != DO_NOT_COMPRESS) {
-			if (compress == COMPRESS_FAST) {
-				newinfo.size_compressed = LZ4_compress_default((const char*)buffer, compressed_buffer.data(), size, (int)compressed_buffer.size());
-			}
-			else if (compress == COMPRESS_SMALL) {
-				newinfo.size_compressed = LZ4_compress_HC((const char*)buffer, compressed_buffer.data(), size, (int)compressed_buffer.size(), 9);
-			}
-			// Compression failed
-			if (newinfo.size_compressed <= 0) {
-				debug::warning("In wc::Archive::insert_data(\"", path, "\"):\n");
-				debug::warnmore("Failed to compress file; will store uncompressed.\n");
-				newinfo.size_compressed = size;
-			}
-			// Compression success
-			else {
-				newinfo.flags |= FILEFLAG_COMPRESSED;
-				buffer = compressed_buffer.data();
-			}
-		}
 
 		// Find the file we're looking for.
-		size_t index = _dictionary.find(newpath);
+		size_t hash = _dictionary.hash_key(newpath);
+		size_t index = _dictionary.find_hashed(newpath, hash);
 		if (index == SIZE_MAX) {
-			_dictionary.insert(newpath, newinfo);
-			index = _dictionary.find(newpath);
+			_dictionary.insert_hashed(newpath, hash, newinfo);
+			index = _dictionary.size() - 1;
 		}
 		else {
 			// The specified file is already in this archive, so use 'replace' to decide what to do.
@@ -369,7 +408,7 @@ namespace wc {
 				_fileinfos[index] = newinfo;
 				break;
 			case REPLACE_IF_NEWER:
-				if (timestamp > _fileinfos[index].timestamp) {
+				if (newinfo.timestamp > _fileinfos[index].timestamp) {
 					_files_deleted = true;
 					_fileinfos[index] = newinfo;
 				}
@@ -385,7 +424,7 @@ namespace wc {
 		if (newinfo.size_compressed > 0) {
 			// We write the file contents.
 			fseek64(_file, _header.back, SEEK_SET);
-			fwrite(buffer, 1, (size_t)newinfo.size_compressed, _file);
+			fwrite(data, 1, (size_t)newinfo.size_compressed, _file);
 			_header.back += newinfo.size_compressed;
 		}
 
@@ -393,7 +432,7 @@ namespace wc {
 		return true;
 	}
 
-	bool Archive::insert_file(const char* path, const char* srcfilename, ReplaceEnum replace, CompressEnum compress) {
+	bool Archive::read_source(const char* path, const char* srcfilename, std::vector<char>& buffer, timestamp_t& timestamp) {
 		// Make sure the path isn't too long.
 		if (strlen(path) > (Archive::FILEPATH_FIXEDLEN-1)) {
 			debug::error("In wc::Archive::insert_file():\n");
@@ -404,7 +443,7 @@ namespace wc {
 		std::filesystem::path srcpath = std::filesystem::u8path(srcfilename);
 
 		// Get the file's 'last write time' and convert it to a usable integer.
-		timestamp_t timestamp = std::chrono::clock_cast<std::chrono::utc_clock>(std::filesystem::last_write_time(srcpath));
+		timestamp = std::chrono::clock_cast<std::chrono::utc_clock>(std::filesystem::last_write_time(srcpath));
 
 		// Open the file.
 		std::ifstream srcfile(srcpath, std::ios::binary);
@@ -418,19 +457,27 @@ namespace wc {
 		srcfile.seekg(0, srcfile.end);
 		size_t len = srcfile.tellg();
 		srcfile.seekg(0, srcfile.beg);
-		std::vector<char> buffer(len);
+		buffer.resize(len);
 		srcfile.read(buffer.data(), buffer.size());
 		if (!srcfile) {
 			debug::error("In wc::Archive::insert_file('", path, "'):\n");
 			debug::errmore("Only read ", srcfile.gcount(), " bytes out of ", len, ".\n");
 			return false;
 		}
+		return true;
+	}
+
+	bool Archive::insert_file(const char* path, const char* srcfilename, ReplaceEnum replace, CompressEnum compress) {
+		std::vector<char> buffer;
+		timestamp_t timestamp;
+		if (!read_source(path, srcfilename, buffer, timestamp)) return false;
 
 		// Insert the file into the archive.
 		return insert_data(path, buffer.data(), (uint32_t)buffer.size(), timestamp, replace, compress);
 	}
 
-	void recursive_pack(Archive& archive, const std::filesystem::path& parent, std::filesystem::path child, Archive::ReplaceEnum replace, Archive::CompressEnum compress) {
+	// Finds every file in a folder (recursively), along with the path each one will have in the archive.
+	void recursive_find(const std::filesystem::path& parent, std::filesystem::path child, std::vector<std::pair<std::string, std::string>>& found) {
 		for (std::filesystem::directory_iterator it(parent / child); it != std::filesystem::directory_iterator(); ++it) {
 			// Path doesn't exist.  This case should never happen, but hey, just in case!
 			if (!std::filesystem::exists(it->path()))
@@ -438,10 +485,10 @@ namespace wc {
 
 			// Path is a directory, so we need to go deeper.
 			if (std::filesystem::is_directory(it->path()))
-				recursive_pack(archive, parent, child / it->path().filename(), replace, compress);
-			// Path is a file, so we insert it into the archive.
+				recursive_find(parent, child / it->path().filename(), found);
+			// Path is a file, so we'll insert it into the archive.
 			else if (std::filesystem::is_regular_file(it->path()))
-				archive.insert_file((child / it->path().filename()).string().c_str(), it->path().string().c_str(), replace, compress);
+				found.push_back({ (child / it->path().filename()).string(), it->path().string() });
 		}
 	}
 
@@ -461,7 +508,36 @@ namespace wc {
 			return;
 		}
 
-		recursive_pack(*this, srcpath, "", replace, compress);
+		std::vector<std::pair<std::string, std::string>> found;
+		recursive_find(srcpath, "", found);
+
+		// Files are read and compressed on the job threads, a batch at a time so we don't hold the whole folder in memory,
+		// then written to the archive in order on this thread.
+		static const size_t BATCH_SIZE = 64;
+		struct Prepared {
+			bool ok;
+			FileInfo info;
+			std::vector<char> source;
+			std::vector<char> compressed;
+		};
+		std::vector<Prepared> batch(BATCH_SIZE);
+		for (size_t first = 0; first < found.size(); first += BATCH_SIZE) {
+			size_t count = std::min(BATCH_SIZE, found.size() - first);
+			jobs::parallelFor(0, count, 1, [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; ++i) {
+					const auto& [path, srcfilename] = found[first + i];
+					Prepared& file = batch[i];
+					timestamp_t timestamp;
+					file.ok = read_source(path.c_str(), srcfilename.c_str(), file.source, timestamp);
+					if (file.ok) compress_data(path.c_str(), file.source.data(), (int32_t)file.source.size(), timestamp, compress, file.info, file.compressed);
+				}
+			});
+			for (size_t i = 0; i < count; ++i) {
+				Prepared& file = batch[i];
+				if (!file.ok) continue;
+				insert_compressed(found[first + i].first.c_str(), file.compressed.empty() ? file.source.data() : file.compressed.data(), file.info, replace);
+			}
+		}
 	}
 
 	void Archive::unpack(const char* dstfolder) {
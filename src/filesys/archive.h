@@ -123,7 +123,7 @@ namespace wc {
 	private:
 
 		static constexpr const char* MAGIC = "WCARCHV";
-		static constexpr const uint16_t CURRENT_VERSION = 3;
+		static constexpr const uint16_t CURRENT_VERSION = 5;
 		static constexpr const size_t FILEPATH_FIXEDLEN = 64;
 
 		struct Header {
@@ -132,8 +132,11 @@ namespace wc {
 			uint32_t flags = 0;
 			uint32_t numfiles = 0;
 			uint16_t version = 0; // Which version of this software was used to create the archive?
-			char _reserved[38] = {}; // Reserved in case we need it for future versions without having to break compatability.
+			uint16_t _padding = 0;
+			uint32_t dictbytes = 0; // How many bytes the dictionary takes up after 'back' (since version 5).
+			char _reserved[32] = {}; // Reserved in case we need it for future versions without having to break compatability.
 		} _header;
+		static_assert(sizeof(Header) == 64, "Archive headers must stay 64 bytes, so older archives can still be read.");
 
 		struct FileInfo
 		{
@@ -145,10 +148,23 @@ namespace wc {
 			char _reserved[4] = {}; // Reserved for future use.  May or may not actually use.
 		};
 
-		hvh::htable<fixedstring<FILEPATH_FIXEDLEN>, FileInfo> _dictionary;
+		// Since version 4, the dictionary is written using 'save'.  Older archives store it as a raw memory dump,
+		// so the table must keep the original hashmap layout to be able to read them.
+		hvh::basic_htable<hvh::hash_policy_odd, fixedstring<FILEPATH_FIXEDLEN>, FileInfo> _dictionary;
 		fixedstring<FILEPATH_FIXEDLEN>* const& _filepaths = _dictionary.data<0>();
 		FileInfo* const& _fileinfos = _dictionary.data<1>();
 
+		// Compresses a file's contents (if asked to) and fills out its dictionary entry, except for the offset.
+		// If the data was compressed, it's written to 'compressed'; otherwise 'compressed' is left empty.
+		// This doesn't touch the archive, so it can be run on several files at once.
+		static void compress_data(const char* path, const void* buffer, int32_t size, timestamp_t timestamp, CompressEnum compress, FileInfo& info, std::vector<char>& compressed);
+
+		// Reads a file on disc into 'buffer'.
+		static bool read_source(const char* path, const char* srcfilename, std::vector<char>& buffer, timestamp_t& timestamp);
+
+		// Adds a file which has been through 'compress_data' to the dictionary, and writes its contents to the archive.
+		bool insert_compressed(const char* path, const void* data, FileInfo info, ReplaceEnum replace);
+
 		FILE* _file = nullptr;
 		std::string _savedpath;
 		bool _modified = false;
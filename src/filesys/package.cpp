@@ -142,18 +142,20 @@ namespace wc {
 			fixedstring<64> mypath = filepath.c_str();
 
 			// Remove backslashes from the path, and ensure the file isn't reserved.
+			// Both tables share a key type, so the path only needs to be hashed once.
 			strip_backslashes(mypath.c_str);
-			if (reserved_filenames.count(mypath) > 0) {
+			size_t hash = file_list.hash_key(mypath);
+			if (reserved_filenames.find_hashed(mypath, hash) != SIZE_MAX) {
 				continue;
 			}
 
 			// File appeared twice (somehow..?)
-			if (file_list.count(mypath) > 0) {
+			if (file_list.find_hashed(mypath, hash) != SIZE_MAX) {
 				continue;
 			}
 
 			// FINALLY we can insert this file path into our list.
-			file_list.insert(mypath);
+			file_list.insert_hashed(mypath, hash);
 		}
 	}
 
@@ -33,7 +33,7 @@ namespace wc {
 		inline const hvh::htable<fixedstring<64>>& getFileTable() const { return _file_table; }
 		inline const Archive& getArchive() const { return _archive; }
 
-		inline bool operator < (const Package& rhs) {
+		inline bool operator < (const Package& rhs) const {
 			// Compare priority first.
 			if (_priority < rhs._priority) return true;
 			if (_priority > rhs._priority) return false;
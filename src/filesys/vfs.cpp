@@ -52,7 +52,7 @@ namespace vfs {
 				Package pkg;
 				if (pkg.open(it->path().string().c_str())) {
 					debug::info("Found package '$user/", it->path().filename().string().c_str(), "'.\n");
-					if (packages.count(pkg.getName().c_str()) > 0)
+					if (packages.count(std::string_view(pkg.getName())) > 0)
 						debug::infomore("A package with this name is already present.\n");
 					else
 						packages.insert(pkg.getName().c_str(), std::move(pkg));
@@ -74,7 +74,7 @@ namespace vfs {
 				Package pkg;
 				if (pkg.open(it->path().string().c_str())) {
 					debug::info("Found package '$install/", it->path().filename().string().c_str(), "'.\n");
-					if (packages.count(pkg.getName().c_str()) > 0)
+					if (packages.count(std::string_view(pkg.getName())) > 0)
 						debug::infomore("A package with this name is already present.\n");
 					else
 						packages.insert(pkg.getName().c_str(), std::move(pkg));
@@ -142,11 +142,13 @@ namespace vfs {
 		// If path is not null, then we're not continuing from last time.
 		if (u8path) {
 			// Clear the list and tell it to reserve enough space for our files.
+			// The path is looked up directly, without copying it into a fixedstring.
+			std::string_view path(u8path);
 			list.clear();
-			list.reserve(files.count(u8path));
+			list.reserve(files.count(path));
 
 			// Get the module indices from the map and save them in the list.
-			for (size_t index = files.find(u8path, true); index != SIZE_MAX; index = files.find(u8path, false)) {
+			for (size_t index : files.equal_range(path)) {
 				list.push_back(files.at<1>(index));
 			}
 
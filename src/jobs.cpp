@@ -0,0 +1,313 @@
+#include "jobs.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <thread>
+
+#include "debug.h"
+
+namespace wc {
+namespace jobs {
+
+	struct Job {
+		std::function<void()> func;
+		Counter* counter;
+
+		static Job* create(std::function<void()> func, Counter* counter) {
+			if (counter) counter->increment();
+			return new Job{ std::move(func), counter };
+		}
+
+		// Runs the job, then deletes it.
+		static void execute(Job* job) {
+			job->func();
+			Counter* counter = job->counter;
+			delete job;
+			if (counter) counter->decrement();
+		}
+	};
+
+	void Counter::increment() {
+		value.fetch_add(1);
+	}
+
+}} // namespace wc::jobs
+
+namespace {
+
+	using wc::jobs::Job;
+
+	// A Chase-Lev work-stealing deque.
+	// The thread which owns the deque pushes and pops jobs at the bottom, without locking;
+	// any other thread can steal jobs from the top. The ring of jobs grows when it fills up;
+	// old rings are kept until the deque is destroyed, since a thief might still be reading one.
+	class JobDeque {
+	public:
+		JobDeque() : ring(new Ring(1024)) { retired.emplace_back(ring.load(std::memory_order_relaxed)); }
+
+		// Only called by the owning thread.
+		void push(Job* job) {
+			int64_t b = bottom.load(std::memory_order_relaxed);
+			int64_t t = top.load(std::memory_order_acquire);
+			Ring* r = ring.load(std::memory_order_relaxed);
+			if (b - t > r->mask) r = grow(r, b, t);
+			r->put(b, job);
+			bottom.store(b + 1, std::memory_order_release);
+		}
+
+		// Only called by the owning thread.
+		Job* pop() {
+			int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+			Ring* r = ring.load(std::memory_order_relaxed);
+			bottom.store(b, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t t = top.load(std::memory_order_relaxed);
+			if (t > b) {
+				// The deque was empty.
+				bottom.store(b + 1, std::memory_order_relaxed);
+				return nullptr;
+			}
+			Job* job = r->get(b);
+			if (t == b) {
+				// This was the last job, so race any thieves for it.
+				if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) job = nullptr;
+				bottom.store(b + 1, std::memory_order_relaxed);
+			}
+			return job;
+		}
+
+		// Called by any thread.
+		Job* steal() {
+			int64_t t = top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t b = bottom.load(std::memory_order_acquire);
+			if (t >= b) return nullptr;
+			Ring* r = ring.load(std::memory_order_acquire);
+			Job* job = r->get(t);
+			if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return nullptr;
+			return job;
+		}
+
+	private:
+		struct Ring {
+			int64_t mask;
+			std::unique_ptr<std::atomic<Job*>[]> items;
+
+			Ring(int64_t capacity) : mask(capacity - 1), items(new std::atomic<Job*>[capacity]) {}
+			Job* get(int64_t i) const { return items[i & mask].load(std::memory_order_relaxed); }
+			void put(int64_t i, Job* job) { items[i & mask].store(job, std::memory_order_relaxed); }
+		};
+
+		Ring* grow(Ring* old, int64_t b, int64_t t) {
+			Ring* result = new Ring((old->mask + 1) * 2);
+			for (int64_t i = t; i < b; ++i) { result->put(i, old->get(i)); }
+			retired.emplace_back(result);
+			ring.store(result, std::memory_order_release);
+			return result;
+		}
+
+		alignas(64) std::atomic<int64_t> top = 0;
+		alignas(64) std::atomic<int64_t> bottom = 0;
+		std::atomic<Ring*> ring;
+		std::vector<std::unique_ptr<Ring>> retired;
+	};
+
+	thread_local size_t myThreadIndex = SIZE_MAX;
+
+	std::vector<std::unique_ptr<JobDeque>> deques;
+	std::vector<std::thread> workers;
+	size_t numJobThreads = 0;
+
+	// Jobs run from threads outside of the job system.
+	std::mutex sharedMutex;
+	std::deque<Job*> sharedQueue;
+
+	// Jobs which must run on the main thread.
+	std::mutex mainMutex;
+	std::deque<Job*> mainQueue;
+
+	// Idle workers sleep until a job is queued.
+	// 'queued' counts jobs which have been queued but not yet taken; it can briefly run high, but never stays low.
+	std::atomic<int64_t> queued = 0;
+	std::atomic<int> sleeping = 0;
+	std::mutex sleepMutex;
+	std::condition_variable wakeup;
+	std::atomic<bool> stopping = false;
+
+	void notifyQueued() {
+		queued.fetch_add(1, std::memory_order_seq_cst);
+		if (sleeping.load(std::memory_order_seq_cst) > 0) {
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			wakeup.notify_one();
+		}
+	}
+
+	void enqueue(Job* job) {
+		if (numJobThreads == 0) {
+			Job::execute(job);
+			return;
+		}
+		if (myThreadIndex < numJobThreads) deques[myThreadIndex]->push(job);
+		else {
+			std::lock_guard<std::mutex> lock(sharedMutex);
+			sharedQueue.push_back(job);
+		}
+		notifyQueued();
+	}
+
+	// Finds a job for the calling thread: first its own, then one stolen from another thread, then a shared one.
+	Job* findJob() {
+		size_t self = myThreadIndex;
+		Job* job = nullptr;
+		if (self < numJobThreads) job = deques[self]->pop();
+		if (!job) {
+			// Start with the next thread along, so thieves spread out instead of all hitting thread 0.
+			size_t start = (self < numJobThreads) ? self + 1 : 0;
+			for (size_t i = 0; i < numJobThreads && !job; ++i) {
+				size_t victim = (start + i) % numJobThreads;
+				if (victim != self) job = deques[victim]->steal();
+			}
+		}
+		if (!job) {
+			std::lock_guard<std::mutex> lock(sharedMutex);
+			if (!sharedQueue.empty()) {
+				job = sharedQueue.front();
+				sharedQueue.pop_front();
+			}
+		}
+		if (job) queued.fetch_sub(1, std::memory_order_relaxed);
+		return job;
+	}
+
+	Job* findMainThreadJob() {
+		std::lock_guard<std::mutex> lock(mainMutex);
+		if (mainQueue.empty()) return nullptr;
+		Job* job = mainQueue.front();
+		mainQueue.pop_front();
+		return job;
+	}
+
+	void workerMain(size_t index) {
+		myThreadIndex = index;
+		while (true) {
+			Job* job = findJob();
+			if (job) {
+				Job::execute(job);
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			sleeping.fetch_add(1, std::memory_order_seq_cst);
+			wakeup.wait(lock, []() { return queued.load(std::memory_order_seq_cst) > 0 || stopping.load(); });
+			sleeping.fetch_sub(1, std::memory_order_seq_cst);
+			if (stopping.load() && queued.load() <= 0) return;
+		}
+	}
+
+} // namespace <anon>
+
+namespace wc {
+namespace jobs {
+
+	void Counter::decrement() {
+		// 'busy' keeps the counter from looking done until we've stopped touching it,
+		// since whoever is waiting on it may destroy it as soon as it's done.
+		busy.fetch_add(1);
+		if (value.fetch_sub(1) == 1) {
+			std::vector<std::pair<std::function<void()>, Counter*>> ready;
+			{
+				std::lock_guard<std::mutex> lock(continuationMutex);
+				ready.swap(continuations);
+			}
+			for (auto& continuation : ready) { run(std::move(continuation.first), continuation.second); }
+		}
+		busy.fetch_sub(1);
+	}
+
+	bool init(size_t numthreads) {
+		if (numJobThreads != 0) return true;
+		if (numthreads == 0) numthreads = std::thread::hardware_concurrency();
+		if (numthreads == 0) numthreads = 1;
+
+		stopping = false;
+		numJobThreads = numthreads;
+		for (size_t i = 0; i < numthreads; ++i) { deques.emplace_back(new JobDeque()); }
+		myThreadIndex = 0;
+		for (size_t i = 1; i < numthreads; ++i) { workers.emplace_back(workerMain, i); }
+		debug::info("Started the job system with ", numthreads, " threads.\n");
+		return true;
+	}
+
+	void shutdown() {
+		if (numJobThreads == 0) return;
+
+		// Finish everything that's already been queued, including main thread jobs.
+		while (queued.load() > 0) {
+			Job* job = findJob();
+			if (job) Job::execute(job);
+			else std::this_thread::yield();
+		}
+		runMainThreadJobs();
+
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			stopping = true;
+			wakeup.notify_all();
+		}
+		for (std::thread& worker : workers) { worker.join(); }
+		workers.clear();
+		deques.clear();
+		numJobThreads = 0;
+		myThreadIndex = SIZE_MAX;
+	}
+
+	size_t numThreads() { return numJobThreads; }
+	size_t threadIndex() { return myThreadIndex; }
+	bool isMainThread() { return (myThreadIndex == 0); }
+
+	void run(std::function<void()> func, Counter* counter) {
+		enqueue(Job::create(std::move(func), counter));
+	}
+
+	void runAfter(Counter& dependency, std::function<void()> func, Counter* counter) {
+		{
+			std::lock_guard<std::mutex> lock(dependency.continuationMutex);
+			// The last job to finish takes the continuations under this lock after the count reaches zero,
+			// so checking the count here (rather than 'done') can't miss it.
+			if (dependency.value.load() != 0) {
+				// The counter is incremented now, so anything waiting on it also waits for this job.
+				if (counter) counter->increment();
+				dependency.continuations.push_back({ [func = std::move(func), counter]() {
+					func();
+					if (counter) counter->decrement();
+				}, nullptr });
+				return;
+			}
+		}
+		run(std::move(func), counter);
+	}
+
+	void runOnMainThread(std::function<void()> func, Counter* counter) {
+		Job* job = Job::create(std::move(func), counter);
+		if (numJobThreads == 0 || isMainThread()) {
+			Job::execute(job);
+			return;
+		}
+		std::lock_guard<std::mutex> lock(mainMutex);
+		mainQueue.push_back(job);
+	}
+
+	void runMainThreadJobs() {
+		while (Job* job = findMainThreadJob()) { Job::execute(job); }
+	}
+
+	void wait(Counter& counter) {
+		while (!counter.done()) {
+			Job* job = findJob();
+			if (!job && isMainThread()) job = findMainThreadJob();
+			if (job) Job::execute(job);
+			else std::this_thread::yield();
+		}
+	}
+
+}} // namespace wc::jobs
@@ -0,0 +1,113 @@
+#ifndef HVH_WC_JOBS_H
+#define HVH_WC_JOBS_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace wc {
+namespace jobs {
+
+	// A Counter tracks a group of jobs.
+	// Each job which is run with a counter increments it, and decrements it once the job finishes,
+	// so a counter reaches zero once every job in its group is done.
+	// Jobs can be queued to run once a counter reaches zero, using 'runAfter'.
+	// A counter must outlive every job which uses it; wait on it (or check 'done') before destroying it.
+	class Counter {
+	public:
+		Counter() = default;
+		Counter(const Counter&) = delete;
+		Counter& operator = (const Counter&) = delete;
+
+		bool done() const { return (value.load() == 0 && busy.load() == 0); }
+		int pending() const { return value.load(); }
+
+	private:
+		friend struct Job;
+		friend void runAfter(Counter&, std::function<void()>, Counter*);
+		void increment();
+		void decrement();
+
+		std::atomic<int> value = 0;
+		std::atomic<int> busy = 0;
+		std::mutex continuationMutex;
+		std::vector<std::pair<std::function<void()>, Counter*>> continuations;
+	};
+
+	// Starts the worker threads.
+	// If 'numthreads' is 0, one thread is used for every hardware thread; the main thread counts as one of them.
+	// Jobs which are run before init (or after shutdown) run immediately on the calling thread.
+	bool init(size_t numthreads = 0);
+	// Finishes any queued jobs, then stops the worker threads.
+	void shutdown();
+
+	// Returns the number of threads which run jobs, including the main thread.
+	size_t numThreads();
+	// Returns the index of the calling thread in [0, numThreads()), or SIZE_MAX if it isn't one of the job threads.
+	// The main thread is always thread 0.
+	size_t threadIndex();
+	bool isMainThread();
+
+	// Runs 'func' on whichever job thread gets to it first.
+	// If 'counter' isn't null, it's incremented now and decremented once 'func' returns.
+	// Jobs run from a job thread go onto that thread's own queue, where other threads can steal them;
+	// jobs run from any other thread go onto a shared queue.
+	void run(std::function<void()> func, Counter* counter = nullptr);
+
+	// Runs 'func' once 'dependency' reaches zero (or right away, if it already has).
+	void runAfter(Counter& dependency, std::function<void()> func, Counter* counter = nullptr);
+
+	// Runs 'func' on the main thread, the next time it calls runMainThreadJobs or waits on a counter.
+	// Anything which touches Lua or the window must run on the main thread.
+	void runOnMainThread(std::function<void()> func, Counter* counter = nullptr);
+
+	// Runs every job which is waiting for the main thread.
+	// Called by the main loop once per iteration; must only be called from the main thread.
+	void runMainThreadJobs();
+
+	// Waits for a counter to reach zero.
+	// Rather than sleeping, the calling thread runs other jobs while it waits
+	// (including main thread jobs, if it's the main thread), so jobs can safely wait on other jobs.
+	void wait(Counter& counter);
+
+	// parallelFor(begin, end, grain, func)
+	// Splits [begin, end) into batches of up to 'grain' indices and calls 'func(first, last)' for each batch,
+	// spread across every job thread. Returns once every batch has finished.
+	// The calling thread runs the first batch itself, then helps with the rest.
+	template <typename FuncT>
+	void parallelFor(size_t begin, size_t end, size_t grain, FuncT&& func) {
+		if (end <= begin) return;
+		if (grain == 0) grain = 1;
+		size_t batches = (end - begin + grain - 1) / grain;
+		if (batches == 1 || numThreads() <= 1) {
+			func(begin, end);
+			return;
+		}
+		Counter counter;
+		for (size_t batch = 1; batch < batches; ++batch) {
+			size_t first = begin + batch * grain;
+			size_t last = (end - first < grain) ? end : first + grain;
+			run([&func, first, last]() { func(first, last); }, &counter);
+		}
+		func(begin, begin + grain);
+		wait(counter);
+	}
+
+	// executor
+	// Adapts the job system to the executor interface from tools/executor.hpp,
+	// so containers and the system scheduler can run their work on the job threads.
+	struct executor {
+		template <typename FuncT>
+		void run(size_t numtasks, FuncT&& func) {
+			parallelFor(0, numtasks, 1, [&](size_t first, size_t last) {
+				for (size_t task = first; task < last; ++task) { func(task); }
+			});
+		}
+		size_t num_threads() const { return numThreads(); }
+	};
+
+}} // namespace wc::jobs
+
+#endif // HVH_WC_JOBS_H
@@ -0,0 +1,123 @@
+#include "jobs.h"
+#include "tools/executor.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+bool jobs_test() {
+	using namespace wc;
+	bool success = true;
+	printf("Testing the job system...\n");
+
+	jobs::init(4);
+
+	// Every job runs exactly once, and the counter tracks them.
+	std::atomic<int> ran = 0;
+	jobs::Counter counter;
+	for (int i = 0; i < 1000; ++i) { jobs::run([&]() { ++ran; }, &counter); }
+	jobs::wait(counter);
+	if (ran != 1000 || !counter.done()) {
+		printf("Expected 1000 jobs to run, %i did.\n", ran.load());
+		success = false;
+	}
+
+	// Jobs which spawn and wait on more jobs don't deadlock.
+	ran = 0;
+	jobs::Counter outer;
+	for (int i = 0; i < 16; ++i) {
+		jobs::run([&]() {
+			jobs::Counter inner;
+			for (int j = 0; j < 16; ++j) { jobs::run([&]() { ++ran; }, &inner); }
+			jobs::wait(inner);
+		}, &outer);
+	}
+	jobs::wait(outer);
+	if (ran != 256) {
+		printf("Expected 256 nested jobs to run, %i did.\n", ran.load());
+		success = false;
+	}
+
+	// A job run after a counter waits for every job in that counter.
+	std::atomic<int> first = 0;
+	int seen = -1;
+	jobs::Counter firstGroup, secondGroup;
+	for (int i = 0; i < 8; ++i) {
+		jobs::run([&]() { std::this_thread::sleep_for(std::chrono::milliseconds(1)); ++first; }, &firstGroup);
+	}
+	jobs::runAfter(firstGroup, [&]() { seen = first.load(); }, &secondGroup);
+	jobs::wait(secondGroup);
+	if (seen != 8) {
+		printf("A dependent job ran before its dependencies finished.\n");
+		success = false;
+	}
+
+	// parallelFor covers the whole range exactly once.
+	std::vector<int> hits(10007, 0);
+	jobs::parallelFor(0, hits.size(), 100, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) { ++hits[i]; }
+	});
+	for (int hit : hits) {
+		if (hit != 1) {
+			printf("parallelFor missed or repeated an index.\n");
+			success = false;
+			break;
+		}
+	}
+
+	// Main thread jobs only run on the main thread.
+	bool onMain = false;
+	jobs::Counter mainGroup;
+	jobs::run([&]() { jobs::runOnMainThread([&]() { onMain = jobs::isMainThread(); }, &mainGroup); }, &counter);
+	jobs::wait(counter);
+	jobs::wait(mainGroup);
+	if (!onMain) {
+		printf("A main thread job ran on another thread.\n");
+		success = false;
+	}
+
+	jobs::shutdown();
+	return success;
+}
+
+// Compares running many small batches on the job system against starting threads for each batch.
+bool jobs_benchmark() {
+	using namespace wc;
+	using namespace std::chrono;
+	bool success = true;
+	printf("Benchmarking the job system...\n");
+
+	static const size_t COUNT = 1 << 16;
+	static const int ROUNDS = 200;
+	std::vector<float> data(COUNT, 1.0f);
+	auto work = [&](size_t task) {
+		for (size_t i = task * 1024; i < (task + 1) * 1024; ++i) { data[i] = data[i] * 0.5f + 1.0f; }
+	};
+
+	hvh::thread_executor threads;
+	auto start = high_resolution_clock::now();
+	for (int round = 0; round < ROUNDS; ++round) { threads.run(COUNT / 1024, work); }
+	auto threaded = high_resolution_clock::now();
+
+	jobs::init();
+	jobs::executor pool;
+	auto pooledStart = high_resolution_clock::now();
+	for (int round = 0; round < ROUNDS; ++round) { pool.run(COUNT / 1024, work); }
+	auto pooled = high_resolution_clock::now();
+	jobs::shutdown();
+
+	printf("thread_executor: %.2f us per batch; jobs::executor: %.2f us per batch.\n",
+		duration<double, std::micro>(threaded - start).count() / ROUNDS,
+		duration<double, std::micro>(pooled - pooledStart).count() / ROUNDS);
+
+	for (float value : data) {
+		if (value < 1.99f || value > 2.01f) {
+			printf("Batches didn't converge.\n");
+			success = false;
+			break;
+		}
+	}
+	return success;
+}
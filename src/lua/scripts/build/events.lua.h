@@ -1,4 +1,4 @@
-#define luaJIT_BC_events_SIZE 1563
+#define luaJIT_BC_events_SIZE 1745
 static const unsigned char luaJIT_BC_events[] = {
 27,76,74,2,2,85,0,4,6,1,1,0,17,45,4,0,0,57,5,0,0,56,4,5,4,56,4,1,4,11,4,0,0,
 88,4,5,128,45,4,0,0,57,5,0,0,56,4,5,4,52,5,0,0,60,5,1,4,45,4,0,0,57,5,0,0,56,
@@ -32,30 +32,36 @@ static const unsigned char luaJIT_BC_events[] = {
 105,108,46,13,116,111,115,116,114,105,110,103,7,39,40,8,39,46,39,22,69,114,
 114,111,114,32,101,120,101,99,117,116,105,110,103,32,39,10,112,114,105,110,
 116,10,112,99,97,108,108,10,112,97,105,114,115,12,101,118,101,110,116,105,100,
-235,1,0,1,4,1,11,0,15,45,1,0,0,52,2,0,0,60,2,0,1,54,1,0,0,53,2,1,0,61,0,2,2,
-54,3,3,0,61,3,4,2,54,3,5,0,61,3,6,2,54,3,7,0,61,3,8,2,54,3,9,0,61,3,10,2,68,1,
-2,0,0,192,18,101,120,101,99,117,116,101,95,108,111,99,97,108,32,71,69,78,69,
-82,73,67,95,69,86,69,78,84,95,69,88,69,67,85,84,69,95,76,79,67,65,76,19,101,
-120,101,99,117,116,101,95,103,108,111,98,97,108,33,71,69,78,69,82,73,67,95,69,
-86,69,78,84,95,69,88,69,67,85,84,69,95,71,76,79,66,65,76,13,117,110,108,105,
-115,116,101,110,27,71,69,78,69,82,73,67,95,69,86,69,78,84,95,85,78,76,73,83,
-84,69,78,11,108,105,115,116,101,110,25,71,69,78,69,82,73,67,95,69,86,69,78,84,
-95,76,73,83,84,69,78,12,101,118,101,110,116,105,100,1,0,0,13,114,101,97,100,
-111,110,108,121,164,3,3,0,4,0,19,0,43,52,0,0,0,55,0,0,0,54,0,1,0,54,1,3,0,54,
-2,0,0,66,1,2,2,61,1,2,0,52,0,0,0,51,1,4,0,55,1,5,0,51,1,6,0,55,1,7,0,51,1,8,0,
-55,1,9,0,51,1,10,0,55,1,11,0,51,1,12,0,55,1,13,0,54,1,0,0,54,2,13,0,61,2,14,1,
-54,1,0,0,54,2,13,0,39,3,15,0,66,2,2,2,61,2,15,1,54,1,0,0,54,2,13,0,39,3,16,0,
-66,2,2,2,61,2,16,1,54,1,0,0,54,2,13,0,39,3,17,0,66,2,2,2,61,2,17,1,54,1,0,0,
-54,2,13,0,39,3,18,0,66,2,2,2,61,2,18,1,50,0,0,128,75,0,1,0,20,101,110,116,105,
-116,121,95,100,101,108,101,116,105,111,110,20,97,110,105,109,97,116,105,111,
-110,95,101,118,101,110,116,19,100,105,115,112,108,97,121,95,117,112,100,97,
-116,101,19,108,111,103,105,99,97,108,95,117,112,100,97,116,101,25,99,114,101,
-97,116,101,95,103,101,110,101,114,105,99,95,101,118,101,110,116,25,67,82,69,
-65,84,69,95,71,69,78,69,82,73,67,95,69,86,69,78,84,0,32,71,69,78,69,82,73,67,
-95,69,86,69,78,84,95,69,88,69,67,85,84,69,95,76,79,67,65,76,0,33,71,69,78,69,
-82,73,67,95,69,86,69,78,84,95,69,88,69,67,85,84,69,95,71,76,79,66,65,76,0,27,
-71,69,78,69,82,73,67,95,69,86,69,78,84,95,85,78,76,73,83,84,69,78,0,25,71,69,
-78,69,82,73,67,95,69,86,69,78,84,95,76,73,83,84,69,78,0,13,114,101,97,100,111,
-110,108,121,11,101,118,101,110,116,115,12,83,65,78,68,66,79,88,11,69,86,69,78,
-84,83,0
+79,2,2,10,0,1,0,11,41,2,1,0,21,3,1,0,41,4,1,0,77,2,6,128,54,6,0,0,18,7,0,0,56,
+8,5,1,71,9,2,0,65,6,2,1,79,2,250,127,75,0,1,0,32,71,69,78,69,82,73,67,95,69,
+86,69,78,84,95,69,88,69,67,85,84,69,95,76,79,67,65,76,167,2,0,1,4,1,13,0,17,
+45,1,0,0,52,2,0,0,60,2,0,1,54,1,0,0,53,2,1,0,61,0,2,2,54,3,3,0,61,3,4,2,54,3,
+5,0,61,3,6,2,54,3,7,0,61,3,8,2,54,3,9,0,61,3,10,2,54,3,11,0,61,3,12,2,68,1,2,
+0,0,192,23,101,120,101,99,117,116,101,95,108,111,99,97,108,95,109,97,110,121,
+37,71,69,78,69,82,73,67,95,69,86,69,78,84,95,69,88,69,67,85,84,69,95,76,79,67,
+65,76,95,77,65,78,89,18,101,120,101,99,117,116,101,95,108,111,99,97,108,32,71,
+69,78,69,82,73,67,95,69,86,69,78,84,95,69,88,69,67,85,84,69,95,76,79,67,65,76,
+19,101,120,101,99,117,116,101,95,103,108,111,98,97,108,33,71,69,78,69,82,73,
+67,95,69,86,69,78,84,95,69,88,69,67,85,84,69,95,71,76,79,66,65,76,13,117,110,
+108,105,115,116,101,110,27,71,69,78,69,82,73,67,95,69,86,69,78,84,95,85,78,76,
+73,83,84,69,78,11,108,105,115,116,101,110,25,71,69,78,69,82,73,67,95,69,86,69,
+78,84,95,76,73,83,84,69,78,12,101,118,101,110,116,105,100,1,0,0,13,114,101,97,
+100,111,110,108,121,206,3,3,0,4,0,21,0,45,52,0,0,0,55,0,0,0,54,0,1,0,54,1,3,0,
+54,2,0,0,66,1,2,2,61,1,2,0,52,0,0,0,51,1,4,0,55,1,5,0,51,1,6,0,55,1,7,0,51,1,
+8,0,55,1,9,0,51,1,10,0,55,1,11,0,51,1,12,0,55,1,13,0,51,1,14,0,55,1,15,0,54,1,
+0,0,54,2,15,0,61,2,16,1,54,1,0,0,54,2,15,0,39,3,17,0,66,2,2,2,61,2,17,1,54,1,
+0,0,54,2,15,0,39,3,18,0,66,2,2,2,61,2,18,1,54,1,0,0,54,2,15,0,39,3,19,0,66,2,
+2,2,61,2,19,1,54,1,0,0,54,2,15,0,39,3,20,0,66,2,2,2,61,2,20,1,50,0,0,128,75,0,
+1,0,20,101,110,116,105,116,121,95,100,101,108,101,116,105,111,110,20,97,110,
+105,109,97,116,105,111,110,95,101,118,101,110,116,19,100,105,115,112,108,97,
+121,95,117,112,100,97,116,101,19,108,111,103,105,99,97,108,95,117,112,100,97,
+116,101,25,99,114,101,97,116,101,95,103,101,110,101,114,105,99,95,101,118,101,
+110,116,25,67,82,69,65,84,69,95,71,69,78,69,82,73,67,95,69,86,69,78,84,0,37,
+71,69,78,69,82,73,67,95,69,86,69,78,84,95,69,88,69,67,85,84,69,95,76,79,67,65,
+76,95,77,65,78,89,0,32,71,69,78,69,82,73,67,95,69,86,69,78,84,95,69,88,69,67,
+85,84,69,95,76,79,67,65,76,0,33,71,69,78,69,82,73,67,95,69,86,69,78,84,95,69,
+88,69,67,85,84,69,95,71,76,79,66,65,76,0,27,71,69,78,69,82,73,67,95,69,86,69,
+78,84,95,85,78,76,73,83,84,69,78,0,25,71,69,78,69,82,73,67,95,69,86,69,78,84,
+95,76,73,83,84,69,78,0,13,114,101,97,100,111,110,108,121,11,101,118,101,110,
+116,115,12,83,65,78,68,66,79,88,11,69,86,69,78,84,83,0
 };
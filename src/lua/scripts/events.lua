@@ -52,6 +52,13 @@ function GENERIC_EVENT_EXECUTE_LOCAL(self, id, ...)
 	end
 end
 
+-- Executes the event once for each id in the array 'ids', so a whole batch costs one call from C++.
+function GENERIC_EVENT_EXECUTE_LOCAL_MANY(self, ids, ...)
+	for i = 1, #ids do
+		GENERIC_EVENT_EXECUTE_LOCAL(self, ids[i], ...)
+	end
+end
+
 function CREATE_GENERIC_EVENT(eventname)
 	listeners[eventname] = {}
 	return readonly({
@@ -60,6 +67,7 @@ function CREATE_GENERIC_EVENT(eventname)
 		unlisten = GENERIC_EVENT_UNLISTEN,
 		execute_global = GENERIC_EVENT_EXECUTE_GLOBAL,
 		execute_local = GENERIC_EVENT_EXECUTE_LOCAL,
+		execute_local_many = GENERIC_EVENT_EXECUTE_LOCAL_MANY,
 	})
 end
 
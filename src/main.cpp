@@ -1,19 +1,28 @@
 #include "main.h"
 
 #include <iostream>
+#include <algorithm>
 #include <chrono>
+#include <thread>
 using namespace std;
 
 #include "appconfig.h"
 #include "filesys/paths.h"
 #include "userconfig.h"
 #include "debug.h"
+#include "jobs.h"
 #include "filesys/vfs.h"
 #include "lua/luasystem.h"
 #include "window.h"
 #include "graphics/renderer.h"
 #include "events.h"
 #include "ecs/entity.h"
+#include "ecs/world.h"
+#include "ecs/registry.h"
+#include "ecs/scheduler.h"
+#include "ecs/interpolation.h"
+#include "ecs/components/SpatialComponent.h"
+#include "ecs/components/TransformComponent.h"
 
 namespace wc {
 
@@ -36,21 +45,29 @@ namespace wc {
 			if (!wc::initPaths()) return 10;
 			userconfig::init();
 			debug::init(wc::getUserPath().string().c_str());
+			// The job system takes about half of the hardware threads; the world's flecs workers take the rest (see ecs::World).
+			// Both count the main thread, which runs jobs while it waits and runs flecs systems during 'progress'.
+			size_t hardware = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+			if (!jobs::init(std::min(hardware, hardware - hardware / 2 + 1))) return 15;
 			lua::init();
 			if (!vfs::init()) return 20;
 			if (!window::init()) return 30;
 			if (!gfx::init()) return 40;
 
 			entity::initLua();
+			ecs::initSpatialLua();
+			if (!ecs::init()) return 50;
 
 			return 0;
 		}
 
 		// Shut down subsystems.
 		void shutdown() {
+			ecs::shutdown();
 			gfx::shutdown();
 			window::shutdown();
 			vfs::shutdown();
+			jobs::shutdown();
 			debug::showCrashReports(); debug::shutdown();
 			userconfig::shutdown();
 		}
@@ -88,6 +105,9 @@ namespace wc {
 				}
 			}
 
+			// Run anything which other threads have handed to the main thread.
+			jobs::runMainThreadJobs();
+
 			// Handle terminal input.
 			std::string terminal_input;
 			while (debug::popInput(terminal_input)) {
@@ -95,18 +115,54 @@ namespace wc {
 				lua::runString(terminal_input.c_str(), "CONSOLE", "@CLI");
 			}
 
-			// Run onLogicalUpdate events.
+			// Run onLogicalUpdate events, each followed by the systems in the same phase.
 			events::earlyLogicalUpdate().Execute();
+			ecs::scheduler().run(ecs::Phase::EARLY);
 			events::onLogicalUpdate().Execute();
+			ecs::scheduler().run(ecs::Phase::ON);
+			ecs::world().progress(LOGICAL_SECONDS_PER_FRAME);
 			events::lateLogicalUpdate().Execute();
+			ecs::scheduler().run(ecs::Phase::LATE);
+			// Apply the structural changes which were deferred during this frame, all at once.
+			ecs::commands().flush(ecs::registry());
+			// Drop every entity which was destroyed this frame from the spatial index, the transform hierarchy and the world,
+			// file every entity which moved under its new cell, so next frame's queries see it,
+			// and bring the world matrices of every moved subtree up to date.
+			static std::vector<entity::ID> destroyed;
+			entity::takeDestroyed(destroyed);
+			for (entity::ID id : destroyed) { ecs::spatial().detach(id); }
+			ecs::transforms().detachMany(destroyed);
+			ecs::world().detachMany(destroyed);
+			jobs::executor exec;
+			ecs::spatial().update(exec);
+			ecs::transforms().update(exec);
+			// Keep this tick's state, so frames drawn before the next tick can be blended towards it.
+			ecs::interpolation().snapshot();
+			// Let scripts know about every entity which was destroyed this frame.
+			entity::fireDeletionEvents(destroyed);
 
 			++logical_frame_counter;
 			logical_time += LOGICAL_SECONDS_PER_FRAME;
 			logical_time_budget -= LOGICAL_SECONDS_PER_FRAME;
 		}
 
+		// What's left of the time budget is how far the display is between the last two logical updates.
+		float interpolation = (float)(logical_time_budget / LOGICAL_SECONDS_PER_FRAME);
+		jobs::executor exec;
+		ecs::interpolation().blend(exec, interpolation);
+
 		// Run onDisplayUpdate events.
+		events::earlyDisplayUpdate().Execute(interpolation);
+		events::onDisplayUpdate().Execute(interpolation);
+		events::lateDisplayUpdate().Execute(interpolation);
 		// Draw the frame.
+		gfx::drawFrame(interpolation);
+		events::earlyPostDisplayUpdate().Execute(interpolation);
+		events::onPostDisplayUpdate().Execute(interpolation);
+		events::latePostDisplayUpdate().Execute(interpolation);
+
+		++display_frame_counter;
+		display_time += delta_time;
 	}
 
 
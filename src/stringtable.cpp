@@ -0,0 +1,90 @@
+#include "stringtable.h"
+
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+#include "tools/htable.hpp"
+
+namespace {
+
+	// Text is copied (with a null terminator) into blocks which are never moved or freed, so pointers into them stay valid.
+	static constexpr size_t BLOCK_BYTES = 65536;
+
+	std::shared_mutex stringsMutex;
+	std::vector<std::unique_ptr<char[]>> blocks;
+	size_t blockUsed = BLOCK_BYTES;
+	// Long strings get an allocation of their own, rather than wasting what's left of the current block.
+	std::vector<std::unique_ptr<char[]>> oversized;
+	// The lookup is keyed on views (which carry their length) so that keys are hashed and compared without calling strlen;
+	// every view points at null-terminated text.
+	std::vector<std::string_view> views = { std::string_view("") };
+	hvh::htable<std::string_view, wc::strings::Handle> lookup;
+
+	// Must be called with 'stringsMutex' held exclusively.
+	std::string_view store(std::string_view str) {
+		size_t bytes = str.size() + 1;
+		char* mem;
+		if (bytes > BLOCK_BYTES / 4) {
+			oversized.emplace_back(new char[bytes]);
+			mem = oversized.back().get();
+		}
+		else {
+			if (blockUsed + bytes > BLOCK_BYTES) {
+				blocks.emplace_back(new char[BLOCK_BYTES]);
+				blockUsed = 0;
+			}
+			mem = blocks.back().get() + blockUsed;
+			blockUsed += bytes;
+		}
+		memcpy(mem, str.data(), str.size());
+		mem[str.size()] = '\0';
+		return std::string_view(mem, str.size());
+	}
+
+} // namespace <anon>
+
+namespace wc {
+namespace strings {
+
+	Handle intern(const char* text) {
+		if (!text || !*text) return 0;
+		std::string_view str(text);
+		{
+			std::shared_lock<std::shared_mutex> lock(stringsMutex);
+			size_t index = lookup.find(str);
+			if (index != SIZE_MAX) return lookup.at<1>(index);
+		}
+		std::unique_lock<std::shared_mutex> lock(stringsMutex);
+		// Another thread may have interned the same string while the lock was released.
+		size_t index = lookup.find(str);
+		if (index != SIZE_MAX) return lookup.at<1>(index);
+
+		Handle result = (Handle)views.size();
+		std::string_view stored = store(str);
+		views.push_back(stored);
+		lookup.insert(stored, result);
+		return result;
+	}
+
+	Handle find(const char* text) {
+		if (!text || !*text) return 0;
+		std::string_view str(text);
+		std::shared_lock<std::shared_mutex> lock(stringsMutex);
+		size_t index = lookup.find(str);
+		return (index == SIZE_MAX) ? 0 : lookup.at<1>(index);
+	}
+
+	const char* view(Handle handle) {
+		std::shared_lock<std::shared_mutex> lock(stringsMutex);
+		return (handle < views.size()) ? views[handle].data() : "";
+	}
+
+	size_t count() {
+		std::shared_lock<std::shared_mutex> lock(stringsMutex);
+		return views.size();
+	}
+
+}} // namespace wc::strings
@@ -0,0 +1,33 @@
+#ifndef HVH_WC_STRINGTABLE_H
+#define HVH_WC_STRINGTABLE_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace wc {
+namespace strings {
+
+	// A Handle stands for an interned string.
+	// Interning the same text always gives the same handle, so handles can be compared and hashed as integers,
+	// and the text is stored once no matter how many things refer to it.
+	// Handle 0 is the empty string.
+	typedef uint32_t Handle;
+
+	// Returns the handle for a string, copying it into the string table the first time it's seen.
+	// Interned strings are never freed, so don't intern text which is only needed briefly.
+	// May be called from any thread.
+	Handle intern(const char* str);
+
+	// Returns the handle for a string, or 0 if it has never been interned.
+	Handle find(const char* str);
+
+	// Returns the text of an interned string, or an empty string if the handle isn't valid.
+	// The text is null-terminated, and stays valid for as long as the program runs.
+	const char* view(Handle handle);
+
+	// Returns the number of strings which have been interned, including the empty string.
+	size_t count();
+
+}} // namespace wc::strings
+
+#endif // HVH_WC_STRINGTABLE_H
@@ -0,0 +1,54 @@
+#include "stringtable.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+bool stringtable_test() {
+	using namespace wc;
+	bool success = true;
+	printf("Testing the string table...\n");
+
+	// The same text always gives the same handle, and the text survives the original string.
+	strings::Handle hello;
+	{
+		std::string temporary = "hello";
+		hello = strings::intern(temporary.c_str());
+	}
+	if (hello == 0 || strings::intern("hello") != hello || strings::find("hello") != hello || strcmp(strings::view(hello), "hello") != 0
+		|| strings::intern("") != 0 || strings::intern(nullptr) != 0 || strings::view(0)[0] != '\0' || strings::find("never interned") != 0) {
+		printf("Interned strings should have one stable handle each.\n");
+		success = false;
+	}
+
+	// Threads interning the same strings at once agree on their handles.
+	std::vector<std::vector<strings::Handle>> handles(4, std::vector<strings::Handle>(2000));
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < handles.size(); ++t) {
+		threads.emplace_back([&, t]() {
+			for (size_t i = 0; i < handles[t].size(); ++i) { handles[t][i] = strings::intern(("thread string " + std::to_string(i)).c_str()); }
+		});
+	}
+	for (std::thread& thread : threads) { thread.join(); }
+	for (size_t i = 0; i < handles[0].size() && success; ++i) {
+		for (size_t t = 1; t < handles.size(); ++t) {
+			if (handles[t][i] != handles[0][i] || strings::view(handles[t][i]) != "thread string " + std::to_string(i)) {
+				printf("Threads interning the same string got different handles.\n");
+				success = false;
+				break;
+			}
+		}
+	}
+
+	// Long strings are stored separately, but work the same way.
+	std::string longString(100000, 'x');
+	strings::Handle longHandle = strings::intern(longString.c_str());
+	if (strings::view(longHandle) != longString || strings::find(longString.c_str()) != longHandle || strcmp(strings::view(hello), "hello") != 0) {
+		printf("Interning a long string failed.\n");
+		success = false;
+	}
+
+	return success;
+}
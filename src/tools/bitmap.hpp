@@ -0,0 +1,376 @@
+/* bitmap.hpp
+ * A compressed set of 32-bit integers
+ * by Haydn V. Harach
+ * Created October 2026
+ *
+ * Values are split into blocks of 65536 by their high 16 bits, as in a roaring bitmap.
+ * Each block which holds anything is a container, kept in increasing order of block:
+ * sparse containers are a sorted array of the low 16 bits (2 bytes per value),
+ * and dense ones are a plain 65536-bit bitset (8KB, however many values it holds).
+ * A container switches to a bitset once it holds more than ARRAY_MAX values, and back to an array
+ * once it drops to half that, so a set never takes much more than 2 bytes per value,
+ * and intersecting, uniting or subtracting two sets works a container at a time (a word at a time for bitsets).
+ */
+#ifndef HVH_TOOLS_BITMAP_H
+#define HVH_TOOLS_BITMAP_H
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+namespace hvh {
+
+	class bitmap {
+	public:
+
+		// The most values an array container holds before it becomes a bitset.
+		// At this size, both kinds of container take 8KB.
+		static constexpr size_t ARRAY_MAX = 4096;
+
+		// bitmap()
+		// Default constructor for a bitmap.
+		// No memory is allocated until the first value is inserted.
+		// Complexity: O(1).
+		bitmap() {}
+
+		// size()
+		// Returns the number of values in the set.
+		// Complexity: O(1).
+		size_t size() const { return mysize; }
+		bool empty() const { return (mysize == 0); }
+
+		// clear()
+		// Removes every value and frees the memory used by the set.
+		// Complexity: O(number of containers).
+		void clear() { containers.clear(); mysize = 0; }
+
+		// insert(value)
+		// Adds a value to the set.
+		// Returns true if it was added, or false if it was already there.
+		// Complexity: O(log(containers)) to find the container, plus O(ARRAY_MAX) to insert into an array container.
+		bool insert(uint32_t value) {
+			uint16_t key = (uint16_t)(value >> 16), low = (uint16_t)value;
+			auto it = lower_bound(key);
+			if (it == containers.end() || it->key != key) {
+				it = containers.insert(it, container(key));
+			}
+			if (!it->add(low)) return false;
+			++mysize;
+			return true;
+		}
+
+		// erase(value)
+		// Removes a value from the set.
+		// Returns true if it was removed, or false if it wasn't there.
+		// Complexity: O(log(containers)) to find the container, plus O(ARRAY_MAX) to remove from an array container.
+		bool erase(uint32_t value) {
+			uint16_t key = (uint16_t)(value >> 16), low = (uint16_t)value;
+			auto it = lower_bound(key);
+			if (it == containers.end() || it->key != key || !it->remove(low)) return false;
+			if (it->count == 0) containers.erase(it);
+			--mysize;
+			return true;
+		}
+
+		// contains(value)
+		// Returns true if the value is in the set.
+		// Complexity: O(log(containers)) plus O(1) for a bitset, or O(log(ARRAY_MAX)) for an array.
+		bool contains(uint32_t value) const {
+			uint16_t key = (uint16_t)(value >> 16);
+			auto it = std::lower_bound(containers.begin(), containers.end(), key, [](const container& c, uint16_t k) { return c.key < k; });
+			return (it != containers.end() && it->key == key && it->has((uint16_t)value));
+		}
+
+		// for_each(func)
+		// Calls 'func(uint32_t)' for every value in the set, in increasing order.
+		// Complexity: O(n), plus O(1024) for each bitset container.
+		template <typename FuncT>
+		void for_each(FuncT&& func) const {
+			for (const container& c : containers) {
+				uint32_t high = (uint32_t)c.key << 16;
+				if (c.is_bitset()) {
+					for (size_t w = 0; w < BITSET_WORDS; ++w) {
+						for (uint64_t word = c.words[w]; word != 0; word &= word - 1) {
+							func(high | (uint32_t)(w * 64 + std::countr_zero(word)));
+						}
+					}
+				}
+				else {
+					for (uint16_t low : c.values) { func(high | low); }
+				}
+			}
+		}
+
+		// to_vector(result)
+		// Fills 'result' with every value in the set, in increasing order.
+		void to_vector(std::vector<uint32_t>& result) const {
+			result.clear();
+			result.reserve(mysize);
+			for_each([&](uint32_t value) { result.push_back(value); });
+		}
+
+		// operator &= (rhs)
+		// Removes every value which isn't also in 'rhs'.
+		// Complexity: O(containers), plus O(values) for each pair of matching containers.
+		bitmap& operator &= (const bitmap& rhs) {
+			auto out = containers.begin();
+			auto r = rhs.containers.begin();
+			for (auto it = containers.begin(); it != containers.end(); ++it) {
+				while (r != rhs.containers.end() && r->key < it->key) { ++r; }
+				if (r == rhs.containers.end()) break;
+				if (r->key != it->key) continue;
+				it->intersect(*r);
+				if (it->count > 0) {
+					if (out != it) *out = std::move(*it);
+					++out;
+				}
+			}
+			containers.erase(out, containers.end());
+			recount();
+			return *this;
+		}
+
+		// operator |= (rhs)
+		// Adds every value in 'rhs'.
+		// Complexity: O(containers), plus O(values) for each pair of matching containers.
+		bitmap& operator |= (const bitmap& rhs) {
+			std::vector<container> result;
+			result.reserve(containers.size() + rhs.containers.size());
+			auto l = containers.begin();
+			auto r = rhs.containers.begin();
+			while (l != containers.end() || r != rhs.containers.end()) {
+				if (r == rhs.containers.end() || (l != containers.end() && l->key < r->key)) {
+					result.push_back(std::move(*l++));
+				}
+				else if (l == containers.end() || r->key < l->key) {
+					result.push_back(*r++);
+				}
+				else {
+					l->unite(*r++);
+					result.push_back(std::move(*l++));
+				}
+			}
+			containers.swap(result);
+			recount();
+			return *this;
+		}
+
+		// operator -= (rhs)
+		// Removes every value which is in 'rhs' (AND NOT).
+		// Complexity: O(containers), plus O(values) for each pair of matching containers.
+		bitmap& operator -= (const bitmap& rhs) {
+			auto out = containers.begin();
+			auto r = rhs.containers.begin();
+			for (auto it = containers.begin(); it != containers.end(); ++it) {
+				while (r != rhs.containers.end() && r->key < it->key) { ++r; }
+				if (r != rhs.containers.end() && r->key == it->key) it->subtract(*r);
+				if (it->count > 0) {
+					if (out != it) *out = std::move(*it);
+					++out;
+				}
+			}
+			containers.erase(out, containers.end());
+			recount();
+			return *this;
+		}
+
+		friend bitmap operator & (bitmap lhs, const bitmap& rhs) { lhs &= rhs; return lhs; }
+		friend bitmap operator | (bitmap lhs, const bitmap& rhs) { lhs |= rhs; return lhs; }
+		friend bitmap operator - (bitmap lhs, const bitmap& rhs) { lhs -= rhs; return lhs; }
+
+		bool operator == (const bitmap& rhs) const {
+			if (mysize != rhs.mysize || containers.size() != rhs.containers.size()) return false;
+			for (size_t i = 0; i < containers.size(); ++i) {
+				if (!containers[i].equals(rhs.containers[i])) return false;
+			}
+			return true;
+		}
+		bool operator != (const bitmap& rhs) const { return !(*this == rhs); }
+
+		// bytes()
+		// Returns the number of bytes used by the containers' values.
+		size_t bytes() const {
+			size_t result = 0;
+			for (const container& c : containers) {
+				result += c.is_bitset() ? (BITSET_WORDS * sizeof(uint64_t)) : (c.values.size() * sizeof(uint16_t));
+			}
+			return result;
+		}
+
+	private:
+
+		static constexpr size_t BITSET_WORDS = 65536 / 64;
+
+		// The values in one block of 65536, stored in 'values' (sorted) or in 'words' (a bitset), but never both.
+		struct container {
+			uint16_t key = 0;
+			uint32_t count = 0;
+			std::vector<uint16_t> values;
+			std::vector<uint64_t> words;
+
+			container() = default;
+			explicit container(uint16_t k) : key(k) {}
+
+			bool is_bitset() const { return !words.empty(); }
+
+			bool has(uint16_t low) const {
+				if (is_bitset()) return (words[low / 64] >> (low % 64)) & 1;
+				return std::binary_search(values.begin(), values.end(), low);
+			}
+
+			bool add(uint16_t low) {
+				if (is_bitset()) {
+					uint64_t bit = (uint64_t)1 << (low % 64);
+					if (words[low / 64] & bit) return false;
+					words[low / 64] |= bit;
+				}
+				else {
+					auto it = std::lower_bound(values.begin(), values.end(), low);
+					if (it != values.end() && *it == low) return false;
+					values.insert(it, low);
+					if (values.size() > ARRAY_MAX) to_bitset();
+				}
+				++count;
+				return true;
+			}
+
+			bool remove(uint16_t low) {
+				if (is_bitset()) {
+					uint64_t bit = (uint64_t)1 << (low % 64);
+					if (!(words[low / 64] & bit)) return false;
+					words[low / 64] &= ~bit;
+					// Switching back at half the threshold stops a container near it from switching on every change.
+					if (--count <= ARRAY_MAX / 2) to_array();
+				}
+				else {
+					auto it = std::lower_bound(values.begin(), values.end(), low);
+					if (it == values.end() || *it != low) return false;
+					values.erase(it);
+					--count;
+				}
+				return true;
+			}
+
+			void to_bitset() {
+				words.assign(BITSET_WORDS, 0);
+				for (uint16_t low : values) { words[low / 64] |= (uint64_t)1 << (low % 64); }
+				values.clear();
+				values.shrink_to_fit();
+			}
+
+			void to_array() {
+				values.clear();
+				values.reserve(count);
+				for (size_t w = 0; w < BITSET_WORDS; ++w) {
+					for (uint64_t word = words[w]; word != 0; word &= word - 1) { values.push_back((uint16_t)(w * 64 + std::countr_zero(word))); }
+				}
+				words.clear();
+				words.shrink_to_fit();
+			}
+
+			// Recounts a bitset after a bulk operation, and turns it into an array if it's become sparse.
+			void finish_bitset() {
+				count = 0;
+				for (uint64_t word : words) { count += (uint32_t)std::popcount(word); }
+				if (count <= ARRAY_MAX) to_array();
+			}
+
+			void intersect(const container& rhs) {
+				if (is_bitset() && rhs.is_bitset()) {
+					for (size_t w = 0; w < BITSET_WORDS; ++w) { words[w] &= rhs.words[w]; }
+					finish_bitset();
+				}
+				else if (is_bitset()) {
+					values.clear();
+					for (uint16_t low : rhs.values) {
+						if ((words[low / 64] >> (low % 64)) & 1) values.push_back(low);
+					}
+					words.clear();
+					words.shrink_to_fit();
+					count = (uint32_t)values.size();
+				}
+				else if (rhs.is_bitset()) {
+					values.erase(std::remove_if(values.begin(), values.end(), [&](uint16_t low) { return !rhs.has(low); }), values.end());
+					count = (uint32_t)values.size();
+				}
+				else {
+					std::vector<uint16_t> result;
+					std::set_intersection(values.begin(), values.end(), rhs.values.begin(), rhs.values.end(), std::back_inserter(result));
+					values.swap(result);
+					count = (uint32_t)values.size();
+				}
+			}
+
+			void unite(const container& rhs) {
+				if (!is_bitset() && !rhs.is_bitset()) {
+					std::vector<uint16_t> result;
+					result.reserve(values.size() + rhs.values.size());
+					std::set_union(values.begin(), values.end(), rhs.values.begin(), rhs.values.end(), std::back_inserter(result));
+					values.swap(result);
+					count = (uint32_t)values.size();
+					if (count > ARRAY_MAX) to_bitset();
+					return;
+				}
+				if (!is_bitset()) to_bitset();
+				if (rhs.is_bitset()) {
+					for (size_t w = 0; w < BITSET_WORDS; ++w) { words[w] |= rhs.words[w]; }
+				}
+				else {
+					for (uint16_t low : rhs.values) { words[low / 64] |= (uint64_t)1 << (low % 64); }
+				}
+				count = 0;
+				for (uint64_t word : words) { count += (uint32_t)std::popcount(word); }
+			}
+
+			void subtract(const container& rhs) {
+				if (is_bitset()) {
+					if (rhs.is_bitset()) {
+						for (size_t w = 0; w < BITSET_WORDS; ++w) { words[w] &= ~rhs.words[w]; }
+					}
+					else {
+						for (uint16_t low : rhs.values) { words[low / 64] &= ~((uint64_t)1 << (low % 64)); }
+					}
+					finish_bitset();
+				}
+				else if (rhs.is_bitset()) {
+					values.erase(std::remove_if(values.begin(), values.end(), [&](uint16_t low) { return rhs.has(low); }), values.end());
+					count = (uint32_t)values.size();
+				}
+				else {
+					std::vector<uint16_t> result;
+					std::set_difference(values.begin(), values.end(), rhs.values.begin(), rhs.values.end(), std::back_inserter(result));
+					values.swap(result);
+					count = (uint32_t)values.size();
+				}
+			}
+
+			bool equals(const container& rhs) const {
+				if (key != rhs.key || count != rhs.count) return false;
+				if (is_bitset() == rhs.is_bitset()) return (values == rhs.values && words == rhs.words);
+				const container& sparse = is_bitset() ? rhs : *this;
+				const container& dense = is_bitset() ? *this : rhs;
+				for (uint16_t low : sparse.values) {
+					if (!dense.has(low)) return false;
+				}
+				return true;
+			}
+		};
+
+		std::vector<container>::iterator lower_bound(uint16_t key) {
+			return std::lower_bound(containers.begin(), containers.end(), key, [](const container& c, uint16_t k) { return c.key < k; });
+		}
+
+		void recount() {
+			mysize = 0;
+			for (const container& c : containers) { mysize += c.count; }
+		}
+
+		std::vector<container> containers;
+		size_t mysize = 0;
+	};
+
+} // namespace hvh
+
+#endif // HVH_TOOLS_BITMAP_H
@@ -0,0 +1,98 @@
+#include "bitmap.hpp"
+#include "rng.h"
+
+#include <algorithm>
+#include <iterator>
+#include <set>
+#include <vector>
+using namespace std;
+
+#include <cstdio>
+
+namespace {
+
+	bool matches(const hvh::bitmap& bits, const set<uint32_t>& expected) {
+		vector<uint32_t> values;
+		bits.to_vector(values);
+		return (bits.size() == expected.size() && equal(values.begin(), values.end(), expected.begin(), expected.end()));
+	}
+
+} // namespace <anon>
+
+bool bitmap_test() {
+	printf("Testing compressed bitmap...\n");
+
+	bool success = true;
+	RNG rng(12345);
+
+	// 'dense' fills the first few blocks (so they become bitsets), 'sparse' is spread across many blocks (so they stay arrays),
+	// and 'mixed' overlaps both.
+	hvh::bitmap dense, sparse, mixed;
+	set<uint32_t> denseSet, sparseSet, mixedSet;
+	for (int i = 0; i < 100000; ++i) {
+		uint32_t value = rng.next() % 200000;
+		if (dense.insert(value) != denseSet.insert(value).second) {
+			printf("insert(%u) disagreed about whether the value was new.\n", value);
+			success = false;
+			break;
+		}
+	}
+	for (int i = 0; i < 20000; ++i) {
+		uint32_t value = rng.next();
+		sparse.insert(value);
+		sparseSet.insert(value);
+		value = (i % 2) ? (rng.next() % 200000) : rng.next();
+		mixed.insert(value);
+		mixedSet.insert(value);
+	}
+	if (!matches(dense, denseSet) || !matches(sparse, sparseSet) || !matches(mixed, mixedSet)) {
+		printf("Bitmaps don't hold the values which were inserted.\n");
+		success = false;
+	}
+	if (dense.bytes() >= denseSet.size() * sizeof(uint16_t) || !dense.contains(*denseSet.begin()) || dense.contains(200001)) {
+		printf("Dense blocks should be stored as bitsets, and lookups should work on them.\n");
+		success = false;
+	}
+
+	// Set algebra agrees with std::set's, whichever kinds of container meet.
+	const hvh::bitmap* bitmaps[] = { &dense, &sparse, &mixed };
+	const set<uint32_t>* sets[] = { &denseSet, &sparseSet, &mixedSet };
+	for (int l = 0; l < 3; ++l) {
+		for (int r = 0; r < 3; ++r) {
+			set<uint32_t> both, either, only;
+			set_intersection(sets[l]->begin(), sets[l]->end(), sets[r]->begin(), sets[r]->end(), inserter(both, both.end()));
+			set_union(sets[l]->begin(), sets[l]->end(), sets[r]->begin(), sets[r]->end(), inserter(either, either.end()));
+			set_difference(sets[l]->begin(), sets[l]->end(), sets[r]->begin(), sets[r]->end(), inserter(only, only.end()));
+			if (!matches(*bitmaps[l] & *bitmaps[r], both) || !matches(*bitmaps[l] | *bitmaps[r], either) || !matches(*bitmaps[l] - *bitmaps[r], only)) {
+				printf("Set operations between bitmaps %i and %i gave the wrong result.\n", l, r);
+				success = false;
+			}
+		}
+	}
+
+	// Erasing most of a bitset turns it back into an array without losing anything.
+	for (auto it = denseSet.begin(); it != denseSet.end();) {
+		if (*it % 16 != 0) {
+			dense.erase(*it);
+			it = denseSet.erase(it);
+		}
+		else ++it;
+	}
+	if (!matches(dense, denseSet) || dense.erase(1) || dense.bytes() != denseSet.size() * sizeof(uint16_t)) {
+		printf("Erasing values from a bitmap failed.\n");
+		success = false;
+	}
+
+	hvh::bitmap copy = dense;
+	if (copy != dense || (copy - dense).size() != 0 || (copy & sparse) != (dense & sparse)) {
+		printf("Copied bitmaps should compare equal.\n");
+		success = false;
+	}
+	copy.clear();
+	if (!copy.empty() || copy.contains(0) || copy == dense) {
+		printf("Clearing a bitmap failed.\n");
+		success = false;
+	}
+
+	return success;
+}
@@ -0,0 +1,236 @@
+/* chtable.hpp
+ * A concurrent, read-mostly Hash Table built on top of htable
+ * by Haydn V. Harach
+ * Created October 2026
+ *
+ * Readers never take a lock; they run against the current table and use a
+ * sequence counter (seqlock) to detect that a writer got in the way, in which
+ * case the read is simply retried.  Writers are serialized by a mutex.
+ * When the table needs to grow, the writer builds a bigger copy and publishes
+ * it, leaving the old table "retired" rather than freed, so readers which are
+ * still looking at it never touch freed memory (this is the RCU half).
+ * Retired tables are freed by 'reclaim', which must be called at a point where
+ * no readers can be in flight (ie, between logical frames).
+ *
+ * Because readers may observe a row while it is being written, every key and
+ * item type must be trivially copyable.  Reader callbacks may run more than
+ * once, so they should only copy data out of the table.
+ */
+#ifndef HVH_TOOLS_CONCURRENTHASHTABLE_H
+#define HVH_TOOLS_CONCURRENTHASHTABLE_H
+
+#include "htable.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+namespace hvh {
+
+	template <typename KeyT, typename... ItemTs>
+	class chtable {
+	public:
+		static_assert(std::is_trivially_copyable<KeyT>::value && (std::is_trivially_copyable<ItemTs>::value && ...),
+			"chtable can only store trivially copyable types.");
+
+		typedef htable<KeyT, ItemTs...> table_type;
+
+		// chtable()
+		// Default constructor for a concurrent hash table.
+		// Complexity: O(1).
+		chtable() : current(new table_type()) {}
+		// ~chtable()
+		// Destructor for a concurrent hash table.
+		// No other thread may be using the table while it is destroyed.
+		// Complexity: O(n).
+		~chtable() {
+			delete current.load(std::memory_order_relaxed);
+			reclaim();
+		}
+
+		chtable(const chtable&) = delete;
+		chtable& operator = (const chtable&) = delete;
+
+		///////////////////////////////////////////////////////////////////////
+		// Readers.
+		// These may be called from any number of threads at the same time,
+		// including while another thread is writing.
+		///////////////////////////////////////////////////////////////////////
+
+		// read(func)
+		// Calls 'func' with a const reference to the underlying htable,
+		// so the SoA columns can be accessed directly using 'find', 'at', and 'data'.
+		// If a writer modifies the table while 'func' is running, 'func' is called again.
+		// 'func' must not keep any pointers or references into the table after it returns.
+		template <typename FuncT>
+		void read(FuncT&& func) const {
+			while (1) {
+				uint64_t seq = sequence.load(std::memory_order_acquire);
+				if (seq & 1) { std::this_thread::yield(); continue; }
+				const table_type* table = current.load(std::memory_order_acquire);
+				func(*table);
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (sequence.load(std::memory_order_relaxed) == seq) return;
+			}
+		}
+
+		// get<K>(key, out)
+		// Searches for the first entry with the indicated key and copies its Kth item into 'out'.
+		// Returns false if the key could not be found, in which case 'out' is unchanged.
+		// Complexity: O(1) amortized.
+		template <size_t K>
+		bool get(const KeyT& key, typename std::tuple_element<K, std::tuple<KeyT, ItemTs...>>::type& out) const {
+			typename std::tuple_element<K, std::tuple<KeyT, ItemTs...>>::type result;
+			bool found = false;
+			read([&](const table_type& table) {
+				size_t index = table.find(key);
+				found = (index != SIZE_MAX);
+				if (found) result = table.template at<K>(index);
+			});
+			if (found) out = result;
+			return found;
+		}
+
+		// contains(key)
+		// Returns true if at least one entry has the indicated key.
+		// Complexity: O(1) amortized.
+		bool contains(const KeyT& key) const {
+			bool found = false;
+			read([&](const table_type& table) { found = (table.find(key) != SIZE_MAX); });
+			return found;
+		}
+
+		// count(key)
+		// Returns the number of entries which have the indicated key.
+		// Complexity: O(1) amortized.
+		size_t count(const KeyT& key) const {
+			size_t result = 0;
+			read([&](const table_type& table) { result = table.count(key); });
+			return result;
+		}
+
+		// size()
+		// Returns the number of entries in the table.
+		size_t size() const {
+			size_t result = 0;
+			read([&](const table_type& table) { result = table.size(); });
+			return result;
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		// Writers.
+		// These are serialized against each other, and may be called from any thread.
+		///////////////////////////////////////////////////////////////////////
+
+		// insert(key, items...)
+		// Inserts a new entry into the table.
+		// If the table is full, a larger copy is published and the old table is retired.
+		// Returns false if a memory allocation failure occurs, true otherwise.
+		// Complexity: O(1) amortized.
+		bool insert(const KeyT& key, const ItemTs&... items) {
+			std::lock_guard<std::mutex> lock(writelock);
+			table_type* table = current.load(std::memory_order_relaxed);
+			if (table->size() == table->capacity()) {
+				table = grow(table);
+				if (!table) return false;
+			}
+			begin_write();
+			bool result = table->insert(key, items...);
+			end_write();
+			return result;
+		}
+
+		// set<K>(key, value)
+		// Overwrites the Kth item of the first entry with the indicated key.
+		// Returns false if the key could not be found.
+		// Complexity: O(1) amortized.
+		template <size_t K>
+		bool set(const KeyT& key, const typename std::tuple_element<K, std::tuple<KeyT, ItemTs...>>::type& value) {
+			static_assert(K != 0, "chtable::set cannot be used to change a key.");
+			std::lock_guard<std::mutex> lock(writelock);
+			table_type* table = current.load(std::memory_order_relaxed);
+			size_t index = ((const table_type*)table)->find(key);
+			if (index == SIZE_MAX) return false;
+			begin_write();
+			table->template at<K>(index) = value;
+			end_write();
+			return true;
+		}
+
+		// erase(key)
+		// Erases the first entry with the indicated key.
+		// Returns the number of entries erased (0 or 1).
+		// Complexity: O(1) amortized.
+		size_t erase(const KeyT& key) {
+			std::lock_guard<std::mutex> lock(writelock);
+			begin_write();
+			size_t result = current.load(std::memory_order_relaxed)->erase(key);
+			end_write();
+			return result;
+		}
+
+		// erase_all(key)
+		// Erases every entry with the indicated key.
+		// Returns the number of entries erased.
+		// Complexity: O(1) amortized.
+		size_t erase_all(const KeyT& key) {
+			std::lock_guard<std::mutex> lock(writelock);
+			begin_write();
+			size_t result = current.load(std::memory_order_relaxed)->erase_all(key);
+			end_write();
+			return result;
+		}
+
+		// clear()
+		// Erases every entry in the table.  Capacity is unchanged.
+		// Complexity: O(n).
+		void clear() {
+			std::lock_guard<std::mutex> lock(writelock);
+			begin_write();
+			current.load(std::memory_order_relaxed)->clear();
+			end_write();
+		}
+
+		// reclaim()
+		// Frees every table which was retired by a previous growth.
+		// This must only be called when no other thread can be inside a reader,
+		// such as at a sync point between logical frames.
+		// Complexity: O(n).
+		void reclaim() {
+			std::lock_guard<std::mutex> lock(writelock);
+			for (table_type* table : retired) { delete table; }
+			retired.clear();
+		}
+
+	private:
+
+		// Marks the start of a modification; readers which overlap it will retry.
+		inline void begin_write() {
+			sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+		}
+		// Marks the end of a modification.
+		inline void end_write() {
+			sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+
+		// Publishes a copy of 'table' with twice the capacity and retires the original.
+		// Returns the new table, or nullptr if a memory allocation failure occurs.
+		table_type* grow(table_type* table) {
+			table_type* grown = new table_type(*table);
+			if (!grown->reserve(table->capacity() * 2)) { delete grown; return nullptr; }
+			retired.push_back(table);
+			current.store(grown, std::memory_order_release);
+			return grown;
+		}
+
+		std::atomic<table_type*> current;
+		std::atomic<uint64_t> sequence = 0;
+		std::mutex writelock;
+		std::vector<table_type*> retired;
+	};
+
+} // namespace hvh
+
+#endif // HVH_TOOLS_CONCURRENTHASHTABLE_H
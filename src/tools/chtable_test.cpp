@@ -0,0 +1,75 @@
+#include "chtable.hpp"
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include <atomic>
+
+bool chtable_test() {
+	bool success = true;
+	printf("Testing concurrent hashtable...\n");
+
+	static const uint32_t COUNT = 100000;
+	static const int NUM_READERS = 4;
+
+	hvh::chtable<uint32_t, uint32_t> table;
+	std::atomic<bool> writing = true;
+	std::atomic<size_t> bad_reads = 0;
+	std::atomic<size_t> good_reads = 0;
+
+	// Readers look up keys while the table is being filled in.
+	// Any value they do find must be the one the writer put there.
+	std::vector<std::thread> readers;
+	for (int r = 0; r < NUM_READERS; ++r) {
+		readers.emplace_back([&, r]() {
+			uint32_t key = r;
+			while (writing) {
+				uint32_t value;
+				if (table.get<1>(key, value)) {
+					if (value != key * 3) ++bad_reads;
+					else ++good_reads;
+				}
+				key = (key + 7919) % COUNT;
+			}
+		});
+	}
+
+	for (uint32_t i = 0; i < COUNT; ++i) {
+		table.insert(i, i * 3);
+	}
+	for (uint32_t i = 0; i < COUNT; i += 2) {
+		table.erase(i);
+	}
+	writing = false;
+	for (auto& reader : readers) { reader.join(); }
+	table.reclaim();
+
+	if (bad_reads > 0) {
+		printf("Readers saw %zi torn or incorrect values.\n", (size_t)bad_reads);
+		success = false;
+	}
+	if (table.size() != COUNT / 2) {
+		printf("Size should be %u, instead it's %zi.\n", COUNT / 2, table.size());
+		success = false;
+	}
+	for (uint32_t i = 0; i < COUNT; ++i) {
+		if (table.contains(i) != (i % 2 == 1)) {
+			printf("Key %u is in the wrong state after erasing even keys.\n", i);
+			success = false;
+			break;
+		}
+	}
+
+	uint32_t sum = 0;
+	table.read([&](const hvh::chtable<uint32_t, uint32_t>::table_type& t) {
+		sum = 0;
+		const uint32_t* values = t.data<1>();
+		for (size_t i = 0; i < t.size(); ++i) { sum += values[i] % 2; }
+	});
+	if (sum != COUNT / 2) {
+		printf("Column access through 'read' gave the wrong result.\n");
+		success = false;
+	}
+
+	printf("Readers completed %zi successful lookups during writes.\n", (size_t)good_reads);
+	return success;
+}
@@ -0,0 +1,75 @@
+/* executor.hpp
+ * Executors for running data-parallel work
+ * by Haydn V. Harach
+ * Created October 2026
+ *
+ * An executor is any type with a member function
+ * `template <typename FuncT> void run(size_t numtasks, FuncT&& func)`
+ * which calls 'func(task)' exactly once for every task in [0, numtasks),
+ * possibly from several threads at the same time, and only returns once every call has finished.
+ * Containers such as hvh::soa take an executor as a template argument,
+ * so the same algorithm can be run serially, on plain threads, or on a job system.
+ */
+#ifndef HVH_TOOLS_EXECUTOR_H
+#define HVH_TOOLS_EXECUTOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+namespace hvh {
+
+	// serial_executor
+	// Runs every task on the calling thread, in order.
+	struct serial_executor {
+		template <typename FuncT>
+		inline void run(size_t numtasks, FuncT&& func) {
+			for (size_t task = 0; task < numtasks; ++task) { func(task); }
+		}
+	};
+
+	// thread_executor
+	// Runs tasks on a group of threads which are started for each call to 'run'.
+	// The calling thread also takes tasks, so no more than 'numthreads - 1' threads are started.
+	// Starting threads is not free, so this is best suited to large batches of work.
+	class thread_executor {
+	public:
+		static const size_t MAX_THREADS = 64;
+
+		// thread_executor(numthreads)
+		// Creates an executor which uses up to 'numthreads' threads (including the caller).
+		// If 'numthreads' is 0, the number of hardware threads is used.
+		thread_executor(size_t numthreads = 0) {
+			if (numthreads == 0) numthreads = std::thread::hardware_concurrency();
+			if (numthreads == 0) numthreads = 1;
+			if (numthreads > MAX_THREADS) numthreads = MAX_THREADS;
+			mythreads = numthreads;
+		}
+
+		// run(numtasks, func)
+		// Calls 'func(task)' for every task in [0, numtasks), and waits for them all to finish.
+		template <typename FuncT>
+		void run(size_t numtasks, FuncT&& func) {
+			std::atomic<size_t> next = 0;
+			auto worker = [&]() {
+				for (size_t task = next++; task < numtasks; task = next++) { func(task); }
+			};
+
+			size_t numthreads = (numtasks < mythreads) ? numtasks : mythreads;
+			std::thread threads[MAX_THREADS];
+			for (size_t i = 1; i < numthreads; ++i) { threads[i] = std::thread(worker); }
+			worker();
+			for (size_t i = 1; i < numthreads; ++i) { threads[i].join(); }
+		}
+
+		// num_threads()
+		// Returns the greatest number of threads that 'run' will use at once.
+		inline size_t num_threads() const { return mythreads; }
+
+	private:
+		size_t mythreads;
+	};
+
+} // namespace hvh
+
+#endif // HVH_TOOLS_EXECUTOR_H
@@ -13,6 +13,8 @@
 #include <cstdint>
 #include <cstring>
 #include <functional>
+#include <string_view>
+#include <algorithm>
 
 template <size_t LEN>
 struct fixedstring {
@@ -41,6 +43,13 @@ struct fixedstring {
 		u8_str[LEN-1] = '\0';
 	}
 
+	// Copies a string which needn't be null-terminated, truncating it in the same way as the other constructors.
+	explicit fixedstring(std::string_view arg) {
+		arg = clamp(arg);
+		memset(c_str, 0, LEN);
+		memcpy(c_str, arg.data(), arg.size());
+	}
+
 	fixedstring& operator = (const fixedstring&) = default;
 	fixedstring& operator = (fixedstring&&) = default;
 
@@ -56,6 +65,26 @@ struct fixedstring {
 		return (!(*this == rhs));
 	}
 
+	// Compares against a string without needing to construct a fixedstring.
+	// 'rhs' is truncated in the same way that the constructor would truncate it.
+	inline bool operator == (std::string_view rhs) const {
+		rhs = clamp(rhs);
+		return (c_str[rhs.size()] == '\0' && memcmp(c_str, rhs.data(), rhs.size()) == 0);
+	}
+	inline bool operator == (const char* rhs) const { return (*this == std::string_view(rhs)); }
+	inline bool operator != (std::string_view rhs) const { return (!(*this == rhs)); }
+	inline bool operator != (const char* rhs) const { return (!(*this == std::string_view(rhs))); }
+
+	// clamp(str)
+	// Returns the part of 'str' which would be kept if it were copied into a fixedstring;
+	// everything from the first null character or the (LEN-1)th character onwards is dropped.
+	static inline std::string_view clamp(std::string_view str) {
+		size_t len = std::min(str.size(), LEN - 1);
+		const void* nul = memchr(str.data(), '\0', len);
+		if (nul) len = (const char*)nul - str.data();
+		return str.substr(0, len);
+	}
+
 	// Warning: This is not a lexicographical comparison!
 	// It is deterministic, but has nothing to do with the characters of the string.
 	inline bool operator < (const fixedstring& rhs) const {
@@ -76,10 +105,14 @@ struct fixedstring {
 };
 
 // Specialization so we can use fixedstring with std::hash.
-// TODO: Better hash function?
+// This hash is stored implicitly in serialized hash tables, so it must not change.
+// Strings can be hashed without first being copied into a fixedstring,
+// which lets hash tables keyed by fixedstring be searched using plain strings.
 namespace std {
 	template <size_t LEN>
 	struct hash<fixedstring<LEN>> {
+		typedef void is_transparent;
+
 		size_t operator()(const fixedstring<LEN>& x) const {
 			uint64_t result = 0;
 			for (size_t i = 0; i < fixedstring<LEN>::NUMINTS; ++i) {
@@ -87,6 +120,25 @@ namespace std {
 			}
 			return (size_t)result;
 		}
+
+		// Gives the same result as hashing fixedstring<LEN>(x), since unused characters are zero.
+		size_t operator()(std::string_view x) const {
+			x = fixedstring<LEN>::clamp(x);
+			uint64_t result = 0;
+			size_t i = 0;
+			for (; i + 8 <= x.size(); i += 8) {
+				uint64_t word;
+				memcpy(&word, x.data() + i, 8);
+				result += word;
+			}
+			if (i < x.size()) {
+				uint64_t word = 0;
+				memcpy(&word, x.data() + i, x.size() - i);
+				result += word;
+			}
+			return (size_t)result;
+		}
+		size_t operator()(const char* x) const { return (*this)(std::string_view(x)); }
 	};
 }
 
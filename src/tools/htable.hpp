@@ -7,28 +7,141 @@
  * By storing a lightweight hashmap alongside a struct-of-arrays, memory
  * efficiency is improved compared to a traditional hash table.
  * In addition, this table can store more than 1 item types.
+ * The layout of the hashmap is controlled by a capacity policy; see
+ * hash_policy_pow2 and hash_policy_odd below.
  */
 #ifndef HVH_TOOLS_HASHTABLESOA_H
 #define HVH_TOOLS_HASHTABLESOA_H
 
 #include "soa.hpp"
+#include <bit>
+#include <span>
+
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#endif
 
 namespace hvh {
 
-	template <typename KeyT, typename... ItemTs>
-	class htable : public soa<KeyT, ItemTs...> {
+	// hash_policy_pow2
+	// Capacity policy which sizes the hashmap to a power of two.
+	// Hashes are reduced to a slot using Fibonacci hashing (multiply by 2^64/phi and keep the high bits),
+	// which scrambles weak hashes (such as std::hash for integers) without needing a '%'.
+	// Probing is linear and wraps using a mask.
+	// This is the default policy for htable.
+	struct hash_policy_pow2 {
+		// Memory layout of the hashmap and columns.
+		typedef soa_traits_default soa_traits_type;
+		// Number of hashmap slots to allocate for a table that can hold 'newsize' entries.
+		static constexpr size_t map_slots(size_t newsize) { return std::bit_ceil(newsize + newsize); }
+		// Number of hashmap slots that are actually used for a table that can hold 'newsize' entries.
+		static constexpr size_t map_capacity(size_t newsize) { return map_slots(newsize); }
+		// Turns a hash into a position in the hashmap.
+		static inline size_t reduce(size_t hash, size_t hashcapacity) {
+			return (size_t)(((uint64_t)hash * 0x9E3779B97F4A7C15ull) >> (std::countl_zero((uint64_t)hashcapacity) + 1));
+		}
+		// Moves a position in the hashmap to the next one in the probe sequence.
+		static inline void next(size_t& h, size_t hashcapacity) { h = (h + 1) & (hashcapacity - 1); }
+	};
+
+	// hash_policy_odd
+	// The original capacity policy for htable.
+	// The hashmap holds an odd number of slots just greater than double the list capacity,
+	// and every reduction and probe step uses '%'.
+	// This is slower than hash_policy_pow2, but tables which were serialized with this layout
+	// (such as the dictionaries of existing archives) can only be read back using this policy.
+	struct hash_policy_odd {
+		// Memory layout of the hashmap and columns.
+		// Serialized tables are raw memory dumps, so this must stay packed.
+		typedef soa_traits_packed soa_traits_type;
+		// Number of hashmap slots to allocate for a table that can hold 'newsize' entries.
+		// One extra slot is allocated so the hashmap conforms to 16-byte alignment.
+		static constexpr size_t map_slots(size_t newsize) { return newsize + newsize + 4; }
+		// Number of hashmap slots that are actually used for a table that can hold 'newsize' entries.
+		static constexpr size_t map_capacity(size_t newsize) { return newsize + newsize + 3; }
+		// Turns a hash into a position in the hashmap.
+		static inline size_t reduce(size_t hash, size_t hashcapacity) { return hash % hashcapacity; }
+		// Moves a position in the hashmap to the next one in the probe sequence.
+		static inline void next(size_t& h, size_t hashcapacity) { h = ((h + 2) % hashcapacity); }
+	};
+
+	// Keys can be looked up using any type which std::hash<KeyT> accepts directly (it defines 'is_transparent'),
+	// such as searching for fixedstring keys using a std::string_view.
+	// Otherwise, the lookup key is converted to a KeyT first.
+	template <typename KeyT, typename LookupT, typename = void>
+	struct _htable_lookup { typedef KeyT type; };
+	template <typename KeyT, typename LookupT>
+	struct _htable_lookup<KeyT, LookupT, std::void_t<typename std::hash<KeyT>::is_transparent>> { typedef LookupT type; };
+
+	// Asks the CPU to start pulling 'addr' into the cache without waiting for it.
+	inline void _htable_prefetch(const void* addr) {
+	#if defined(_MSC_VER)
+		_mm_prefetch((const char*)addr, _MM_HINT_T0);
+	#else
+		__builtin_prefetch(addr);
+	#endif
+	}
+
+	template <typename PolicyT, typename KeyT, typename... ItemTs>
+	class basic_htable : public basic_soa<typename PolicyT::soa_traits_type, KeyT, ItemTs...> {
+		typedef basic_soa<typename PolicyT::soa_traits_type, KeyT, ItemTs...> soa_type;
+		static constexpr size_t ALIGNMENT = PolicyT::soa_traits_type::ALIGNMENT;
 	public:
 
+		// probe_iterator<LookupT>
+		// Walks the hashmap over every entry which has the same key; see 'equal_range'.
+		// Dereferencing gives the index of the current entry, or SIZE_MAX once there are no more.
+		// The iterator keeps its own copy of the lookup key, but for view-like lookup types (std::string_view, const char*)
+		// that's only a copy of the view or pointer, not the text: the caller's key storage must outlive the iterator.
+		template <typename LookupT>
+		class probe_iterator {
+		public:
+			inline size_t operator * () const { return index; }
+			inline probe_iterator& operator ++ () {
+				if (index != SIZE_MAX) {
+					table->hash_inc(slot);
+					index = table->probe(key, slot);
+				}
+				return *this;
+			}
+			inline bool operator == (const probe_iterator& rhs) const { return index == rhs.index; }
+			inline bool operator != (const probe_iterator& rhs) const { return index != rhs.index; }
+		private:
+			friend class basic_htable;
+			probe_iterator(const basic_htable* t, const LookupT& k) : table(t), key(k) {}
+			const basic_htable* table;
+			typename _htable_lookup<KeyT, std::decay_t<const LookupT>>::type key;
+			size_t slot = SIZE_MAX;
+			size_t index = SIZE_MAX;
+		};
+
+		// probe_range<LookupT>
+		// The begin/end pair returned by 'equal_range'.
+		template <typename LookupT>
+		class probe_range {
+		public:
+			inline probe_iterator<LookupT> begin() const { return first; }
+			inline probe_iterator<LookupT> end() const { probe_iterator<LookupT> last = first; last.index = SIZE_MAX; return last; }
+		private:
+			friend class basic_htable;
+			probe_range(const probe_iterator<LookupT>& f) : first(f) {}
+			probe_iterator<LookupT> first;
+		};
+
 		// htable()
 		// Default constructor for a hash table.
 		// Initial size, capacity, and hashmap size are 0.
 		// Complexity: O(1).
-		htable() {}
+		basic_htable() {}
+		// htable(alloc)
+		// Constructs an empty hash table which gets its memory from 'alloc'.
+		// Complexity: O(1).
+		explicit basic_htable(const typename soa_type::allocator_type& alloc) : soa_type(alloc) {}
 		// htable(...)
 		// Constructs a hash table using a list of tuples.
 		// Initializes the table with the entries from the list; the leftmost item is the key.
 		// Complexity: O(n).
-		htable(const std::initializer_list<std::tuple<KeyT, ItemTs...>>& initlist) {
+		basic_htable(const std::initializer_list<std::tuple<KeyT, ItemTs...>>& initlist) {
 			reserve(initlist.size());
 			for (auto& entry : initlist) {
 				std::apply([=](const KeyT& key, const ItemTs& ... items) {this->insert(key, items...); }, entry);
@@ -38,14 +151,15 @@ namespace hvh {
 		// Move constructor for a hash table.
 		// Moves the entries from the rhs hash table into ourselves.
 		// Complexity: O(1).
-		htable(htable<KeyT, ItemTs...>&& other) { swap(*this, other); }
+		basic_htable(basic_htable&& other) { swap(*this, other); }
 		// htable(const& rhs)
 		// Copy constructor for a hash table.
 		// Initializes the hash table as a copy of rhs.
 		// Complexity: O(n).
-		htable(const htable<KeyT, ItemTs...>& other) {
+		basic_htable(const basic_htable& other) : soa_type(other.get_allocator()) {
 			reserve(other.capacity());
-			memcpy(hashmap, other.hashmap, sizeof(uint32_t) * hashcapacity);
+			if (other.hashmap) memcpy(hashmap, other.hashmap, sizeof(uint32_t) * hashcapacity);
+			deleted = other.deleted;
 			_soa_base<KeyT, ItemTs...>& base = *this;
 			const _soa_base<KeyT, ItemTs...>& otherbase = other;
 			base.copy(otherbase);
@@ -54,34 +168,34 @@ namespace hvh {
 		// Move-assignment operator for a hash table.
 		// Moves the entries from the rhs hash table into ourselves, replacing old contents.
 		// Complexity: O(1).
-		htable<KeyT, ItemTs...>& operator = (htable&& other) { swap(*this, other); return *this; }
+		basic_htable& operator = (basic_htable&& other) { swap(*this, other); return *this; }
 		// operator = (& rhs)
 		// Copy-assignment operator for a hash table.
 		// Copies the entries from the rhs hash table into ourselves, replacing old contents.
 		// Complexity: O(n).
-		htable<KeyT, ItemTs...>& operator = (htable other) { swap(*this, other); return *this; }
+		basic_htable& operator = (const basic_htable& other) { basic_htable temp(other); swap(*this, temp); return *this; }
 		// ~htable()
 		// Destructor for a hash table.
 		// Calls the destructor for all contained keys and items, then frees held memory.
 		// Complexity: O(n).
-		~htable() {
+		~basic_htable() {
 			_soa_base<KeyT, ItemTs...>& base = *this;
 			base.destruct_range(0, this->mysize);
 			base.nullify();
+			if (hashmap) this->myallocator.deallocate(hashmap, allocation_size(this->mycapacity));
 			this->mysize = 0;
 			this->mycapacity = 0;
-			if (hashmap) _soa_aligned_free(hashmap);
 		}
 
 		// swap(lhs, rhs)
-		// swaps the contents of two htables.
+		// Swaps the contents of two htables.
 		// Complexity: O(1).
-		friend inline void swap(htable<KeyT, ItemTs...>& lhs, htable<KeyT, ItemTs...>& rhs) {
+		friend inline void swap(basic_htable& lhs, basic_htable& rhs) {
 			std::swap(lhs.hashmap, rhs.hashmap);
 			std::swap(lhs.hashcapacity, rhs.hashcapacity);
-			std::swap(lhs.hashcursor, rhs.hashcursor);
-			soa<KeyT, ItemTs...>& lhsbase = lhs;
-			soa<KeyT, ItemTs...>& rhsbase = rhs;
+			std::swap(lhs.deleted, rhs.deleted);
+			soa_type& lhsbase = lhs;
+			soa_type& rhsbase = rhs;
 			swap(lhsbase, rhsbase);
 		}
 
@@ -90,21 +204,22 @@ namespace hvh {
 		// The capacity of the hash table is unchanged.
 		// Complexity: O(n).
 		inline void clear() {
-			memset(hashmap, INDEXNUL, sizeof(uint32_t) * hashcapacity);
-			soa<KeyT, ItemTs...>& base = *this;
+			if (hashmap) memset(hashmap, INDEXNUL, sizeof(uint32_t) * hashcapacity);
+			deleted = 0;
+			soa_type& base = *this;
 			base.clear();
-			hashcursor = SIZE_MAX;
 		}
 
 		// rehash()
 		// Recalculates the hash for all keys in the table.
-		// Called automatically if the table is resized, and can be used to clear up deleted indices in the map.
+		// Called automatically if the table is resized, or once deleted indices take up too much of the map.
 		// Complexity: O(n).
 		void rehash() {
 			memset(hashmap, INDEXNUL, sizeof(uint32_t) * hashcapacity);
+			deleted = 0;
 			for (size_t i = 0; i < this->mysize; ++i) {
 				// Get the hash for this key.
-				size_t hash = std::hash<KeyT>{}(this->template at<0>(i)) % hashcapacity;
+				size_t hash = PolicyT::reduce(std::hash<KeyT>{}(this->template at<0>(i)), hashcapacity);
 				// Figure out where to put it.
 				while (1) {
 					// If this spot is NULL or DELETED, we can put our reference here.
@@ -117,7 +232,6 @@ namespace hvh {
 					hash_inc(hash);
 				}
 			}
-			hashcursor = SIZE_MAX;
 		}
 
 		// reserve(n)
@@ -136,28 +250,25 @@ namespace hvh {
 			// We can't shrink the actual memory.
 			if (newsize <= this->mycapacity) return true;
 
-			// Hash capacity needs to be odd and just greater than double the list capacity,
-			// but it also needs to conform to 16-byte alignment.
-			hashcapacity = newsize + newsize + 4;
-			size_t htable_size = hashcapacity * sizeof(uint32_t);
-			--hashcapacity;
-
 			// Remember the old memory so we can free it.
 			void* oldmem = hashmap;
+			size_t oldbytes = allocation_size(this->mycapacity);
 
 			// Allocate new memory.
 			_soa_base<KeyT, ItemTs...>& base = *this;
-			void* alloc_result = _soa_aligned_malloc(16, (base.size_per_entry() * newsize) + htable_size);
+			void* alloc_result = this->myallocator.allocate(ALIGNMENT, allocation_size(newsize));
 			if (!alloc_result) return false;
 
+			// The capacity policy decides how large the hash map needs to be.
+			hashcapacity = PolicyT::map_capacity(newsize);
 			hashmap = (uint32_t*)alloc_result;
 
-			// Copy the old data into the new memory.
+			// Move the old data into the new memory.
 			this->mycapacity = newsize;
-			base.divy_buffer(((char*)alloc_result) + htable_size);
+			base.divy_buffer(((char*)alloc_result) + map_bytes(newsize), ALIGNMENT);
 
 			// Free the old memory.
-			if (oldmem) _soa_aligned_free(oldmem);
+			if (oldmem) this->myallocator.deallocate(oldmem, oldbytes);
 			rehash();
 			return true;
 		}
@@ -178,23 +289,20 @@ namespace hvh {
 			// Remember the old memory so we can free it.
 			_soa_base<KeyT, ItemTs...>& base = *this;
 			void* oldmem = hashmap;
+			size_t oldbytes = allocation_size(this->mycapacity);
 
 			if (newsize > 0) {
-				// Hash capacity needs to be odd and just greater than double the list capacity,
-				// but it also needs to conform to 16-byte memory alignment.
-				hashcapacity = newsize + newsize + 4;
-				size_t htable_size = hashcapacity * sizeof(uint32_t);
-				--hashcapacity;
-
 				// Allocate new memory.
-				void* alloc_result = _soa_aligned_malloc(16, (base.size_per_entry() * newsize) + htable_size);
+				void* alloc_result = this->myallocator.allocate(ALIGNMENT, allocation_size(newsize));
 				if (!alloc_result) return false;
 
+				// The capacity policy decides how large the hash map needs to be.
+				hashcapacity = PolicyT::map_capacity(newsize);
 				hashmap = (uint32_t*)alloc_result;
 
-				// Copy the old data into the new memory.
+				// Move the old data into the new memory.
 				this->mycapacity = newsize;
-				base.divy_buffer(((char*)alloc_result) + htable_size);
+				base.divy_buffer(((char*)alloc_result) + map_bytes(newsize), ALIGNMENT);
 			}
 			else {
 				base.nullify();
@@ -204,7 +312,7 @@ namespace hvh {
 			}
 
 			// Free the old memory.
-			if (oldmem) _soa_aligned_free(oldmem);
+			if (oldmem) this->myallocator.deallocate(oldmem, oldbytes);
 			rehash();
 			return true;
 		}
@@ -215,19 +323,30 @@ namespace hvh {
 		// Returns false if a memory allocation failure occurs in reserve(), true otherwise.
 		// Complexity: O(1) amortized.
 		template <typename... Ts>
-		bool insert(const KeyT& key, Ts&&... items) {
+		inline bool insert(const KeyT& key, Ts&&... items) {
+			return insert_hashed(key, std::hash<KeyT>{}(key), std::forward<Ts>(items)...);
+		}
+
+		// insert_hashed(key, hash, items...)
+		// Inserts a new entry into the hash table, using a hash that was already calculated by 'hash_key'.
+		// Returns false if a memory allocation failure occurs in reserve(), true otherwise.
+		// Complexity: O(1) amortized.
+		template <typename... Ts>
+		bool insert_hashed(const KeyT& key, size_t fullhash, Ts&&... items) {
 			if (this->mysize == max_size()) return false;
 			if (this->mysize == this->mycapacity) {
 				if (!reserve(this->mycapacity * 2)) return false;
 			}
-			// Get the hash for the key.
-			size_t hash = std::hash<KeyT>{}(key) % hashcapacity;
+			make_room(1);
+			// Reduce the hash to a position in the hashmap.
+			size_t hash = PolicyT::reduce(fullhash, hashcapacity);
 			// Look through the table for a place to put it...
 			while (1) {
 				uint32_t index = hashmap[hash];
 				if (index == INDEXNUL || index == INDEXDEL) {
+					if (index == INDEXDEL) --deleted;
 					index = (uint32_t)this->mysize;
-					soa<KeyT, ItemTs...>& base = *this;
+					soa_type& base = *this;
 					base.push_back(key, std::forward<Ts>(items)...);
 					hashmap[hash] = index;
 					break;
@@ -248,14 +367,16 @@ namespace hvh {
 			if (this->mysize == this->mycapacity) {
 				if (!reserve(this->mycapacity * 2)) return false;
 			}
+			make_room(1);
 			// Get the hash for the key.
-			size_t hash = std::hash<KeyT>{}(key) % hashcapacity;
+			size_t hash = PolicyT::reduce(std::hash<KeyT>{}(key), hashcapacity);
 			// Look through the table for a place to put it...
 			while (1) {
 				uint32_t index = hashmap[hash];
 				if (index == INDEXNUL || index == INDEXDEL) {
+					if (index == INDEXDEL) --deleted;
 					index = (uint32_t)this->mysize;
-					soa<KeyT, ItemTs...>& base = *this;
+					soa_type& base = *this;
 					base.emplace_back(key, std::forward<CTypes>(cargs)...);
 					hashmap[hash] = index;
 					break;
@@ -265,6 +386,42 @@ namespace hvh {
 			return true;
 		}
 
+		// insert_many(keys, items...)
+		// Inserts one new entry for each key, taking the items for the ith entry from the ith element of each 'items' span.
+		// The table is grown at most once, then the keys are inserted in batches:
+		// every key in a batch is hashed and its hashmap slot prefetched before any of them are placed.
+		// Returns false if the spans are not all the same size or a memory allocation failure occurs,
+		// in which case the table is unchanged.
+		// Complexity: O(n) amortized.
+		bool insert_many(std::span<const KeyT> keys, std::span<const ItemTs>... items) {
+			if (((items.size() != keys.size()) || ...)) return false;
+			if (keys.size() == 0) return true;
+			if (keys.size() > max_size() - this->mysize) return false;
+			if (this->mysize + keys.size() > this->mycapacity) {
+				size_t newsize = this->mycapacity * 2;
+				if (newsize < this->mysize + keys.size()) newsize = this->mysize + keys.size();
+				if (!reserve(newsize)) return false;
+			}
+			make_room(keys.size());
+			soa_type& base = *this;
+			size_t slots[BATCH_SIZE];
+			for (size_t first = 0; first < keys.size(); first += BATCH_SIZE) {
+				size_t count = (keys.size() - first < BATCH_SIZE) ? (keys.size() - first) : BATCH_SIZE;
+				for (size_t i = 0; i < count; ++i) {
+					slots[i] = PolicyT::reduce(std::hash<KeyT>{}(keys[first + i]), hashcapacity);
+					_htable_prefetch(hashmap + slots[i]);
+				}
+				for (size_t i = 0; i < count; ++i) {
+					size_t slot = slots[i];
+					while (hashmap[slot] != INDEXNUL && hashmap[slot] != INDEXDEL) { hash_inc(slot); }
+					if (hashmap[slot] == INDEXDEL) --deleted;
+					hashmap[slot] = (uint32_t)this->mysize;
+					base.push_back(keys[first + i], items[first + i]...);
+				}
+			}
+			return true;
+		}
+
 		// insert_sorted<K>(key, items...)
 		// Inserts a new entry into the hash table sorted according to the Kth array.
 		// Possibly useful if the data needs to be sorted for some reason other than searching.
@@ -276,35 +433,22 @@ namespace hvh {
 			if (this->mysize == this->mycapacity) {
 				if (!reserve(this->mycapacity * 2)) return false;
 			}
-			soa<KeyT, ItemTs...>& base = *this;
+			soa_type& base = *this;
 			size_t where = base.template lower_bound_row<K>(key, items...);
 			base.insert(where, key, items...);
 			rehash();
+			return true;
 		}
 
-		// find(key, restart)
-		// Searches for the entry with the indicated key.
-		// Returns the index of the found entry, or SIZE_MAX if the key could not be found.
-		// If 'restart' is true, find will get the first entry with the matching key.
-		// If 'restart' is false, find will get the next entry with the matching key after the entry previously found by 'find'.
-		// To iterate over every entry with a given key in the table, use the following loop template:
-		// `for (size_t i = find(key, true); i != SIZE_MAX; i = find(key, false)) { ... }`
-		// The returned index can be used with 'at' or 'data' to access the items inside the table.
-		// Complexity: O(1) amortized.
-		size_t find(const KeyT& key, bool restart = true) {
-			if (this->mysize == 0) return SIZE_MAX;
-			if (restart) hashcursor = std::hash<KeyT>{}(key) % hashcapacity;
-			else {
-				if (hashcursor >= hashcapacity) return SIZE_MAX;
-				hash_inc(hashcursor);
-			}
-			while (1) {
-				uint32_t index = hashmap[hashcursor];
-				if (index == INDEXNUL) return SIZE_MAX;
-				if (index != INDEXDEL && this->template at<0>(index) == key) return (size_t)index;
-				hash_inc(hashcursor);
-			}
-			return SIZE_MAX;
+		// hash_key(key)
+		// Returns the hash of 'key', before it has been reduced to a position in the hashmap.
+		// This can be passed to 'find_hashed' and 'insert_hashed' so that a key only needs to be hashed once,
+		// even when it is used with several tables which share the same key type.
+		// Complexity: O(1).
+		template <typename LookupT>
+		static inline size_t hash_key(const LookupT& key) {
+			const typename _htable_lookup<KeyT, LookupT>::type& lookup = key;
+			return std::hash<KeyT>{}(lookup);
 		}
 
 		// find(key) const
@@ -312,49 +456,81 @@ namespace hvh {
 		// Returns the index of the found entry, or SIZE_MAX if the key could not be found.
 		// The returned index can be used with 'at' or 'data' to access the items inside the table.
 		// Complexity: O(1) amortized.
-		size_t find(const KeyT& key) const {
-			if (this->mysize == 0) return SIZE_MAX;
-			size_t hash = std::hash<KeyT>{}(key) % hashcapacity;
-			while (1) {
-				uint32_t index = hashmap[hash];
-				if (index == INDEXNUL) return SIZE_MAX;
-				if (index != INDEXDEL && this->template at<0>(index) == key) return (size_t)index;
-				hash_inc(hash);
-			}
+		template <typename LookupT>
+		size_t find(const LookupT& key) const {
+			const typename _htable_lookup<KeyT, LookupT>::type& lookup = key;
+			return find_hashed(lookup, std::hash<KeyT>{}(lookup));
 		}
 
-		// find(key, restart, hashc) const
-		// Searches for the entry with the indicated key.
+		// find_hashed(key, hash) const
+		// Searches for the entry with the indicated key, using a hash that was already calculated by 'hash_key'.
 		// Returns the index of the found entry, or SIZE_MAX if the key could not be found.
-		// The returned index can be used with 'at' or 'data' to access the items inside the table.
-		// This version allows iterating over multiple items like the regular 'find',
-		// but uses an external hash cursor to maintain const-compatible.
 		// Complexity: O(1) amortized.
-		size_t find(const KeyT& key, bool restart, size_t& hashc) const {
+		template <typename LookupT>
+		size_t find_hashed(const LookupT& key, size_t hash) const {
+			const typename _htable_lookup<KeyT, LookupT>::type& lookup = key;
 			if (this->mysize == 0) return SIZE_MAX;
-			if (restart) hashc = std::hash<KeyT>{}(key) % hashcapacity;
-			else {
-				if (hashc >= hashcapacity) return SIZE_MAX;
-				hash_inc(hashc);
+			size_t slot = PolicyT::reduce(hash, hashcapacity);
+			return probe(lookup, slot);
+		}
+
+		// find_many(keys, out) const
+		// Searches for the first entry with each of the indicated keys,
+		// filling 'out[i]' with the index of the entry for 'keys[i]', or SIZE_MAX if it could not be found.
+		// Keys are resolved in batches: every key in a batch is hashed and its hashmap slot prefetched,
+		// then the key cells the slots point to are prefetched, and only then are the probes run.
+		// This overlaps the cache misses for a batch instead of paying for them one after another,
+		// which is much faster than calling 'find' in a loop once the table no longer fits in cache.
+		// 'out' must be at least as large as 'keys'.
+		// Complexity: O(n) amortized.
+		void find_many(std::span<const KeyT> keys, std::span<size_t> out) const {
+			if (this->mysize == 0) {
+				for (size_t i = 0; i < keys.size(); ++i) { out[i] = SIZE_MAX; }
+				return;
 			}
-			while (1) {
-				uint32_t index = hashmap[hashc];
-				if (index == INDEXNUL) return SIZE_MAX;
-				if (index != INDEXDEL && this->template at<0>(index) == key) return (size_t)index;
-				hash_inc(hashc);
+			size_t slots[BATCH_SIZE];
+			for (size_t first = 0; first < keys.size(); first += BATCH_SIZE) {
+				size_t count = (keys.size() - first < BATCH_SIZE) ? (keys.size() - first) : BATCH_SIZE;
+				for (size_t i = 0; i < count; ++i) {
+					slots[i] = PolicyT::reduce(std::hash<KeyT>{}(keys[first + i]), hashcapacity);
+					_htable_prefetch(hashmap + slots[i]);
+				}
+				for (size_t i = 0; i < count; ++i) {
+					uint32_t index = hashmap[slots[i]];
+					if (index != INDEXNUL && index != INDEXDEL) _htable_prefetch(this->template data<0>() + index);
+				}
+				for (size_t i = 0; i < count; ++i) {
+					out[first + i] = probe(keys[first + i], slots[i]);
+				}
 			}
 		}
 
+		// equal_range(key) const
+		// Returns a range over every entry with the indicated key, for use in a range-based for loop:
+		// `for (size_t i : table.equal_range(key)) { ... }`
+		// Each element of the range is the index of an entry, which can be used with 'at' or 'data'.
+		// The range keeps its own position in the hashmap, so any number of ranges can be used on the same table at once,
+		// and from several threads as long as nobody modifies the table.
+		// Iterators are invalidated by anything that modifies the table, except for 'erase(iterator)'.
+		// Complexity: O(1) amortized.
+		template <typename LookupT>
+		probe_range<LookupT> equal_range(const LookupT& key) const {
+			probe_iterator<LookupT> first(this, key);
+			if (this->mysize > 0) {
+				first.slot = PolicyT::reduce(std::hash<KeyT>{}(first.key), hashcapacity);
+				first.index = probe(first.key, first.slot);
+			}
+			return probe_range<LookupT>(first);
+		}
+
 		// count(key)
 		// Returns the number of entries in the table which have the indicated key.
 		// If no entries in the table have the indicated key, 0 is returned.
 		// Complexity: O(1) amortized.
-		inline size_t count(const KeyT& key) const {
+		template <typename LookupT>
+		inline size_t count(const LookupT& key) const {
 			size_t result = 0;
-			size_t hashc = SIZE_MAX;
-			for (size_t index = find(key, true, hashc); index != SIZE_MAX; index = find(key, false, hashc)) {
-				++result;
-			}
+			for (auto it = equal_range(key).begin(); *it != SIZE_MAX; ++it) { ++result; }
 			return result;
 		}
 
@@ -363,11 +539,11 @@ namespace hvh {
 		// Complexity: O(1) amortized.
 		void swap_entries(size_t first, size_t second) {
 			// Swap the two entries.
-			soa<KeyT, ItemTs...>& base = *this;
+			soa_type& base = *this;
 			base.swap_entries(first, second);
 
 			// Find the hash position for the first entry.
-			size_t hash = std::hash<KeyT>{}(this->at<0>(first)) % hashcapacity;
+			size_t hash = PolicyT::reduce(std::hash<KeyT>{}(this->template at<0>(first)), hashcapacity);
 			size_t first_hashpos = SIZE_MAX;
 			while (1) {
 				uint32_t index = hashmap[hash];
@@ -383,7 +559,7 @@ namespace hvh {
 			}
 
 			// Find the hash position for the second entry.
-			hash = std::hash<KeyT>{}(this->at<0>(second)) % hashcapacity;
+			hash = PolicyT::reduce(std::hash<KeyT>{}(this->template at<0>(second)), hashcapacity);
 			size_t second_hashpos = SIZE_MAX;
 			while (1) {
 				uint32_t index = hashmap[hash];
@@ -403,36 +579,18 @@ namespace hvh {
 			hashmap[second_hashpos] = (uint32_t)first;
 		}
 
-		// erase_found()
-		// Erases the entry which was found by the last call to 'find'.
-		// If the last call to 'find' did not find its goal, the table is unchanged.
-		// Returns the number of items erased (0 or 1).
+		// erase(iterator)
+		// Erases the entry pointed to by an iterator from 'equal_range'.
+		// Returns an iterator to the next entry with the same key, so every match can be erased in a loop:
+		// `for (auto it = table.equal_range(key).begin(); *it != SIZE_MAX;) { it = table.erase(it); }`
+		// The last entry is moved into the erased one's place, so other iterators can still be advanced,
+		// but an iterator which pointed at the last entry gives a stale index from '*it' until it's advanced.
 		// Complexity: O(1) amortized.
-		size_t erase_found() {
-			if (hashcursor >= hashcapacity) return 0;
-			uint32_t index = hashmap[hashcursor];
-			if (index == INDEXNUL || index == INDEXDEL) return 0;
-			soa<KeyT, ItemTs...>& base = *this;
-			base.erase_swap(index);
-			hashmap[hashcursor] = INDEXDEL;
-
-			// Get the hash of the key that we just moved into the deleted item's place.
-			size_t hash = std::hash<KeyT>{}(this->template at<0>(index)) % hashcapacity;
-			// Scan through looking for the reference so we can repair it.
-			while (1) {
-				uint32_t newindex = hashmap[hash];
-				if (newindex == this->mysize) {
-					// Repair the link.
-					hashmap[hash] = index;
-					break;
-				}
-				if (newindex == INDEXNUL) {
-					// ERROR! We can't repair the link!
-					break;
-				}
-				hash_inc(hash);
-			}
-			return 1;
+		template <typename LookupT>
+		probe_iterator<LookupT> erase(probe_iterator<LookupT> it) {
+			if (it.index == SIZE_MAX) return it;
+			erase_slot(it.slot);
+			return ++it;
 		}
 
 		// erase(key)
@@ -440,46 +598,51 @@ namespace hvh {
 		// If no entries have the indicated key, the table is unchanged.
 		// Returns the number of items erased (0 or 1).
 		// Complexity: O(1) amortized.
-		inline size_t erase(const KeyT& key) {
-			find(key, true);
-			return erase_found();
+		template <typename LookupT>
+		inline size_t erase(const LookupT& key) {
+			auto it = equal_range(key).begin();
+			if (*it == SIZE_MAX) return 0;
+			erase_slot(it.slot);
+			return 1;
 		}
 		// erase_all(key)
 		// Erases all entries with the indicated key from the table.
 		// If no entries have the indicated key, the table is unchanged.
 		// Returns the number of items erased.
 		// Complexity: O(1) amortized.
-		inline size_t erase_all(const KeyT& key) {
+		template <typename LookupT>
+		inline size_t erase_all(const LookupT& key) {
 			size_t result = 0;
-			for (size_t index = find(key, true); index != SIZE_MAX; index = find(key, false)) {
-				result += erase_found();
-			}
+			for (auto it = equal_range(key).begin(); *it != SIZE_MAX; it = erase(it)) { ++result; }
 			return result;
 		}
 
-		// erase_found_sorted()
-		// Erases the entry which was found by the last call to 'find',
-		// maintaining the order of the data.
+		// erase_sorted(key)
+		// Finds the entry with the indicated key and erases it, maintaining the order of the data.
+		// If no entries have the indicated key, the table is unchanged.
 		// Returns the number of items erased (0 or 1).
 		// Complexity: O(n).
-		size_t erase_found_sorted() {
-			if (hashcursor >= hashcapacity) return 0;
-			uint32_t index = hashmap[hashcursor];
-			if (index == INDEXNUL || index == INDEXDEL) return 0;
-			soa<KeyT, ItemTs...>& base = *this;
+		template <typename LookupT>
+		inline size_t erase_sorted(const LookupT& key) {
+			size_t index = find(key);
+			if (index == SIZE_MAX) return 0;
+			soa_type& base = *this;
 			base.erase_shift(index);
-			hashmap[hashcursor] = INDEXDEL;
 			rehash();
 			return 1;
 		}
-		// erase_sorted(key)
-		// Finds the entry with the indicated key and erases it, maintaining the order of the data.
-		// If no entries have the indicated key, the table is unchanged.
-		// Returns the number of items erased (0 or 1).
+
+		// erase_if<K>(pred)
+		// Erases every entry whose Kth item satisfies 'pred', keeping the remaining entries in order,
+		// then rebuilds the hashmap.  Much faster than erasing a large number of entries one at a time.
+		// Returns the number of entries erased.
 		// Complexity: O(n).
-		inline size_t erase_sorted(const KeyT& key) {
-			find(key, true);
-			return erase_found_sorted();
+		template <size_t K, typename PredT>
+		size_t erase_if(PredT&& pred) {
+			soa_type& base = *this;
+			size_t result = base.template erase_if<K>(std::forward<PredT>(pred));
+			if (result > 0) rehash();
+			return result;
 		}
 
 
@@ -501,7 +664,7 @@ namespace hvh {
 		// This function should be used in tandem with 'deserialize' to save and load a container to disk.
 		void* serialize(size_t& num_bytes) {
 			shrink_to_fit();
-			num_bytes = (this->size_per_entry() * this->mycapacity) + (sizeof(uint32_t) * hashcapacity);
+			num_bytes = this->buffer_size(this->mycapacity, ALIGNMENT) + (sizeof(uint32_t) * hashcapacity);
 			return hashmap;
 		}
 
@@ -513,49 +676,166 @@ namespace hvh {
 		// This function should be used in tandem with 'serialize' to save and load a container to disk.
 		void* deserialize(size_t num_elements, size_t& num_bytes) {
 			reserve(num_elements);
-			num_bytes = (this->size_per_entry() * this->mycapacity) + (sizeof(uint32_t) * hashcapacity);
+			num_bytes = this->buffer_size(this->mycapacity, ALIGNMENT) + (sizeof(uint32_t) * hashcapacity);
 			this->mysize = num_elements;
+			deleted = 0;
 			return hashmap;
 		}
 
+		// 'save' is inherited from soa; the hashmap is not written, since it can be rebuilt from the keys.
+
+		// load(data, num_bytes)
+		// Replaces the contents of the table with entries read from a buffer written by 'save', then rebuilds the hashmap.
+		// The buffer can come from a table with a different hash policy.
+		// Returns false if the buffer is corrupt, was saved from a table with different types,
+		// or a memory allocation failure occurs; the table is left empty in that case.
+		// Complexity: O(n).
+		bool load(const void* data, size_t num_bytes) {
+			soa_reader in(data, num_bytes);
+			uint64_t numrows;
+			if (!soa_read_header(in, 1 + sizeof...(ItemTs), numrows)) return false;
+			if (numrows > max_size()) return false;
+			clear();
+			if (!reserve((size_t)numrows)) return false;
+			if (!this->load_rows(in, (size_t)numrows)) return false;
+			rehash();
+			return true;
+		}
+
+		// The other column algorithms (for_each, transform, reduce) are inherited from soa,
+		// but must never be used to write to the keys (array 0), since the hashmap would not be updated.
+
+		// partition<K>(exec, pred, chunksize)
+		// Moves every entry whose Kth item satisfies 'pred' to the front of the table, then does a rehash.
+		// Returns the number of entries which satisfy 'pred'.
+		// Complexity: O(n).
+		template <size_t K, typename ExecT, typename PredT>
+		size_t partition(ExecT& exec, PredT&& pred, size_t chunksize = soa_type::DEFAULT_CHUNK_SIZE) {
+			soa_type& base = *this;
+			size_t result = base.template partition<K>(exec, std::forward<PredT>(pred), chunksize);
+			rehash();
+			return result;
+		}
+		// partition<K>(pred)
+		// Moves every entry whose Kth item satisfies 'pred' to the front of the table, then does a rehash.
+		// Complexity: O(n).
+		template <size_t K, typename PredT>
+		inline size_t partition(PredT&& pred, size_t chunksize = soa_type::DEFAULT_CHUNK_SIZE) {
+			serial_executor exec;
+			return partition<K>(exec, std::forward<PredT>(pred), chunksize);
+		}
+
 		// sort<K>()
 		// Sorts the entries in the table according to the Kth array, then does a rehash.
 		// Potentially useful if the data needs to be sorted for some reason other than searching.
-		// Returns the exact number of swaps performed while sorting the data.
+		// Returns the number of entries which changed position.
 		// Complexity: O(nlogn).
 		template <size_t K>
 		size_t sort() {
-			size_t result = this->quicksort(this->template data<K>(), 0, this->mysize-1);
-			rehash();
+			soa_type& base = *this;
+			size_t result = base.template sort<K>();
+			if (result > 0) rehash();
 			return result;
 		}
 
 	protected:
 
-		inline void hash_inc(size_t& h) const { h = ((h + 2) % hashcapacity); }
+		// Scans the hashmap starting at 'slot' until it finds an entry with the given key or an empty slot.
+		// Returns the index of the entry (leaving 'slot' pointing at it), or SIZE_MAX if the key could not be found.
+		template <typename LookupT>
+		size_t probe(const LookupT& key, size_t& slot) const {
+			while (1) {
+				uint32_t index = hashmap[slot];
+				if (index == INDEXNUL) return SIZE_MAX;
+				if (index != INDEXDEL && this->template at<0>(index) == key) return (size_t)index;
+				hash_inc(slot);
+			}
+		}
+
+		// Erases the entry referenced by the hashmap at 'slot', moving the last entry into its place
+		// and repairing the hashmap so it points to the moved entry's new index.
+		void erase_slot(size_t slot) {
+			uint32_t index = hashmap[slot];
+			soa_type& base = *this;
+			base.erase_swap(index);
+			hashmap[slot] = INDEXDEL;
+			++deleted;
+			if (index == this->mysize) return;
+
+			// Get the hash of the key that we just moved into the deleted item's place.
+			size_t hash = PolicyT::reduce(std::hash<KeyT>{}(this->template at<0>(index)), hashcapacity);
+			// Scan through looking for the reference so we can repair it.
+			while (1) {
+				uint32_t newindex = hashmap[hash];
+				if (newindex == this->mysize) {
+					// Repair the link.
+					hashmap[hash] = index;
+					break;
+				}
+				if (newindex == INDEXNUL) {
+					// ERROR! We can't repair the link!
+					break;
+				}
+				hash_inc(hash);
+			}
+		}
+
+		inline void hash_inc(size_t& h) const { PolicyT::next(h, hashcapacity); }
+
+		// Lookups only stop at an empty slot, and inserts reuse deleted ones, so after enough erasing the map can run out of
+		// empty slots altogether, and looking up a missing key would never finish. Before inserting 'count' entries,
+		// clears out the deleted indices if they'd leave less than a quarter of the map empty.
+		// The map is at least twice the capacity, so this happens at most once per quarter of the map erased.
+		inline void make_room(size_t count) {
+			if (deleted > 0 && this->mysize + count + deleted > hashcapacity - hashcapacity / 4) rehash();
+		}
+
+		// Number of bytes at the start of the allocation used by the hashmap.
+		// The columns start after the hash map, so it's padded out to keep them aligned.
+		static constexpr size_t map_bytes(size_t capacity) {
+			return _soa_align_up(PolicyT::map_slots(capacity) * sizeof(uint32_t), ALIGNMENT);
+		}
+		// Total number of bytes allocated for a table with the given capacity.
+		inline size_t allocation_size(size_t capacity) const {
+			if (capacity == 0) return 0;
+			const _soa_base<KeyT, ItemTs...>& base = *this;
+			return map_bytes(capacity) + base.buffer_size(capacity, ALIGNMENT);
+		}
+
+		// Number of keys which 'find_many' and 'insert_many' hash and prefetch ahead of resolving them.
+		static const size_t BATCH_SIZE = 16;
 
 		static const uint32_t INDEXNUL = UINT_MAX;
 		static const uint32_t INDEXDEL = UINT_MAX - 1;
 
 		uint32_t* hashmap = nullptr;
 		size_t hashcapacity = 0;
-		size_t hashcursor = SIZE_MAX;
+		// The number of deleted indices in the hashmap.
+		size_t deleted = 0;
 
 		// Ban certain inherited methods.
-	//	using soa<KeyT, ItemTs...>::clear;
-	//	using soa<KeyT, ItemTs...>::reserve;
-	//	using soa<KeyT, ItemTs...>::shrink_to_fit;
-		using soa<KeyT, ItemTs...>::resize;
-		using soa<KeyT, ItemTs...>::push_back;
-		using soa<KeyT, ItemTs...>::emplace_back;
-		using soa<KeyT, ItemTs...>::pop_back;
-	//	using soa<KeyT, ItemTs...>::insert;
-		using soa<KeyT, ItemTs...>::erase_swap;
-		using soa<KeyT, ItemTs...>::erase_shift;
-	//	using soa<KeyT, ItemTs...>::swap;
-	//	using soa<KeyT, ItemTs...>::swap_entries;
+	//	using soa_type::clear;
+	//	using soa_type::reserve;
+	//	using soa_type::shrink_to_fit;
+		using soa_type::resize;
+		using soa_type::push_back;
+		using soa_type::emplace_back;
+		using soa_type::pop_back;
+	//	using soa_type::insert;
+		using soa_type::erase_swap;
+		using soa_type::erase_shift;
+		using soa_type::append_columns;
+		using soa_type::insert_range;
+		using soa_type::erase_range;
+	//	using soa_type::swap;
+	//	using soa_type::swap_entries;
 	};
 
+	// htable<KeyT, ItemTs...>
+	// A hash table using the default (power-of-two) capacity policy.
+	template <typename KeyT, typename... ItemTs>
+	using htable = basic_htable<hash_policy_pow2, KeyT, ItemTs...>;
+
 } // namespace hvh
 
 #endif // HVH_TOOLS_HASHTABLESOA_H
\ No newline at end of file
@@ -39,32 +39,53 @@ bool hashtable_test() {
 	stringhash.insert("banana", 42);
 	stringhash.insert("banana", 9001);
 
-	size_t index = stringhash.find("banana", true);
-	if (stringhash.at<1>(index) != 12) {
+	auto bananas = stringhash.equal_range("banana").begin();
+	if (stringhash.at<1>(*bananas) != 12) {
 		printf("Failed to find 'banana' in the hash table.\n");
 		success = false;
 	}
 
-	index = stringhash.find("banana", false);
-	if (stringhash.at<1>(index) != 42) {
+	// A second range over the same table must not disturb the first.
+	size_t carrots = 0;
+	for (size_t carrot : stringhash.equal_range("carrot")) {
+		if (stringhash.at<1>(carrot) == 33) ++carrots;
+	}
+	if (carrots != 1) {
+		printf("Failed to find 'carrot' in the middle of iterating over bananas.\n");
+		success = false;
+	}
+
+	++bananas;
+	if (stringhash.at<1>(*bananas) != 42) {
 		printf("Failed to find a second banana.\n");
 		success = false;
 	}
 
-	index = stringhash.find("banana", false);
-	if (stringhash.at<1>(index) != 9001) {
+	++bananas;
+	if (stringhash.at<1>(*bananas) != 9001) {
 		printf("Failed to find a third banana.\n");
 		success = false;
 	}
 
-	index = stringhash.find("banana", false);
-	if (index != SIZE_MAX) {
+	++bananas;
+	if (*bananas != SIZE_MAX) {
 		printf("Failed to fail to find a fourth banana.\n");
 		success = false;
 	}
 
+	// Erasing through an iterator must still visit every other banana.
+	size_t erased = 0;
+	for (auto it = stringhash.equal_range("banana").begin(); *it != SIZE_MAX;) {
+		if (stringhash.at<1>(*it) == 42) { it = stringhash.erase(it); ++erased; }
+		else ++it;
+	}
+	if (erased != 1 || stringhash.count("banana") != 2) {
+		printf("Failed to erase exactly one banana through an iterator.\n");
+		success = false;
+	}
+
 	stringhash.erase_all("banana");
-	index = stringhash.find("banana", true);
+	size_t index = stringhash.find("banana");
 	if (index != SIZE_MAX) {
 		printf("Failed to fail to find a deleted banana.\n");
 		success = false;
@@ -86,12 +107,251 @@ bool hashtable_test() {
 		printf("[%s]:[%i]\n", stringhash.at<0>(i).c_str(), stringhash.at<1>(i));
 	}
 
-	size_t swaps = stringhash.sort<1>();
-	printf("Sort performed %zi swaps.\n", swaps);
+	size_t moved = stringhash.sort<1>();
+	printf("Sort moved %zi entries.\n", moved);
+
+	for (int i = 1; i < stringhash.size(); ++i) {
+		if (stringhash.at<1>(i) < stringhash.at<1>(i - 1)) {
+			printf("Hash table is not sorted after sort<1>().\n");
+			success = false;
+			break;
+		}
+	}
+	if (stringhash.at<1>(stringhash.find("kale")) != 711) {
+		printf("Failed to find 'kale' after sorting.\n");
+		success = false;
+	}
 
 	for (int i = 0; i < stringhash.size(); ++i) {
 		printf("[%i]:[%s]\n", stringhash.at<1>(i), stringhash.at<0>(i).c_str());
 	}
 
+	// Bulk erase by value must leave the remaining entries findable.
+	hvh::htable<int, int> squares;
+	for (int i = 0; i < 1000; ++i) { squares.insert(i, i * i); }
+	erased = squares.erase_if<1>([](int square) { return square % 3 == 0; });
+	if (erased != 334 || squares.size() != 666) {
+		printf("erase_if erased %zi entries, expected 334.\n", erased);
+		success = false;
+	}
+	for (int i = 0; i < 1000; ++i) {
+		if ((squares.find(i) != SIZE_MAX) != (i % 3 != 0)) {
+			printf("After erase_if, find(%i) gave the wrong answer.\n", i);
+			success = false;
+			break;
+		}
+	}
+
+	// Inserting and erasing over and over must never leave a lookup for a missing key with no empty slot to stop at.
+	hvh::htable<uint64_t, int> churned;
+	churned.insert(1, 1);
+	size_t churnmisses = 0;
+	for (uint64_t i = 0; i < 100000; ++i) {
+		uint64_t key = (i * 0x9E3779B97F4A7C15ull) | 2;
+		churned.insert(key, 0);
+		churned.erase(key);
+		if (churned.find(key) == SIZE_MAX) ++churnmisses;
+	}
+	if (churnmisses != 100000 || churned.size() != 1 || churned.find(1) == SIZE_MAX) {
+		printf("Looking up erased keys in a churned table gave the wrong answer.\n");
+		success = false;
+	}
+
+	return success;
+}
+
+#include <chrono>
+#include "rng.h"
+
+// Times inserts, successful finds, and failed finds for a single capacity policy.
+// Returns false if any of the lookups give the wrong answer.
+template <typename PolicyT>
+static bool hashtable_benchmark_policy(const char* name, const uint64_t* keys, size_t count) {
+	using namespace std::chrono;
+	bool success = true;
+	hvh::basic_htable<PolicyT, uint64_t, uint32_t> table;
+
+	auto start = high_resolution_clock::now();
+	for (size_t i = 0; i < count; ++i) {
+		table.insert(keys[i], (uint32_t)i);
+	}
+	auto inserted = high_resolution_clock::now();
+
+	size_t found = 0;
+	for (size_t i = 0; i < count; ++i) {
+		size_t index = table.find(keys[i]);
+		if (index != SIZE_MAX && table.template at<1>(index) == (uint32_t)i) ++found;
+	}
+	auto hits = high_resolution_clock::now();
+
+	size_t missed = 0;
+	for (size_t i = 0; i < count; ++i) {
+		if (table.find(keys[i] + 1) == SIZE_MAX) ++missed;
+	}
+	auto misses = high_resolution_clock::now();
+
+	if (found != count || missed != count) {
+		printf("%s: expected %zi hits and %zi misses, got %zi and %zi.\n", name, count, count, found, missed);
+		success = false;
+	}
+
+	printf("%s: insert %.2f ns, find hit %.2f ns, find miss %.2f ns.\n", name,
+		duration<double, std::nano>(inserted - start).count() / count,
+		duration<double, std::nano>(hits - inserted).count() / count,
+		duration<double, std::nano>(misses - hits).count() / count);
+	return success;
+}
+
+bool hashtable_benchmark() {
+	bool success = true;
+	printf("Benchmarking hashtable capacity policies...\n");
+
+	// Keys are even so that 'key + 1' is guaranteed to miss.
+	static const size_t COUNT = 1 << 20;
+	std::vector<uint64_t> keys(COUNT);
+	RNG rng(0x5EED);
+	for (size_t i = 0; i < COUNT; ++i) {
+		keys[i] = (((uint64_t)rng.next() << 32) | rng.next()) & ~(uint64_t)1;
+	}
+
+	if (!hashtable_benchmark_policy<hvh::hash_policy_odd>("hash_policy_odd", keys.data(), COUNT)) success = false;
+	if (!hashtable_benchmark_policy<hvh::hash_policy_pow2>("hash_policy_pow2", keys.data(), COUNT)) success = false;
+
+	// Sequential keys are the worst case for identity hashes; make sure the finaliser copes.
+	for (size_t i = 0; i < COUNT; ++i) { keys[i] = (uint64_t)i * 2; }
+	if (!hashtable_benchmark_policy<hvh::hash_policy_odd>("hash_policy_odd (sequential)", keys.data(), COUNT)) success = false;
+	if (!hashtable_benchmark_policy<hvh::hash_policy_pow2>("hash_policy_pow2 (sequential)", keys.data(), COUNT)) success = false;
+
+	return success;
+}
+
+// Times 'find' in a loop against 'find_many' for batches of 16 to 4096 keys,
+// and 'insert' in a loop against 'insert_many', on a table which is much larger than L2.
+// Returns false if the batched calls give different answers from the single ones.
+bool hashtable_batch_benchmark() {
+	using namespace std::chrono;
+	bool success = true;
+	printf("Benchmarking batched hashtable lookups...\n");
+
+	// Keys are even so that 'key + 1' is guaranteed to miss.
+	static const size_t COUNT = 1 << 21;
+	std::vector<uint64_t> keys(COUNT);
+	std::vector<uint32_t> values(COUNT);
+	RNG rng(0xBA7C4);
+	for (size_t i = 0; i < COUNT; ++i) {
+		keys[i] = (((uint64_t)rng.next() << 32) | rng.next()) & ~(uint64_t)1;
+		values[i] = (uint32_t)i;
+	}
+
+	hvh::htable<uint64_t, uint32_t> single;
+	auto start = high_resolution_clock::now();
+	for (size_t i = 0; i < COUNT; ++i) { single.insert(keys[i], values[i]); }
+	auto inserted = high_resolution_clock::now();
+
+	hvh::htable<uint64_t, uint32_t> batched;
+	auto batchstart = high_resolution_clock::now();
+	for (size_t first = 0; first < COUNT; first += 4096) {
+		if (!batched.insert_many(std::span<const uint64_t>(keys.data() + first, 4096), std::span<const uint32_t>(values.data() + first, 4096))) success = false;
+	}
+	auto batchinserted = high_resolution_clock::now();
+	if (batched.size() != COUNT) {
+		printf("insert_many: expected %zi entries, got %zi.\n", COUNT, batched.size());
+		success = false;
+	}
+	printf("insert %.2f ns, insert_many %.2f ns.\n",
+		duration<double, std::nano>(inserted - start).count() / COUNT,
+		duration<double, std::nano>(batchinserted - batchstart).count() / COUNT);
+
+	// Look the keys up in a different order than they were inserted, and make half of them miss.
+	std::vector<uint64_t> queries(COUNT);
+	for (size_t i = 0; i < COUNT; ++i) {
+		queries[i] = keys[rng.next() % COUNT] + (i & 1);
+	}
+	std::vector<size_t> expected(COUNT);
+	std::vector<size_t> results(COUNT);
+
+	for (size_t batchsize = 16; batchsize <= 4096; batchsize *= 4) {
+		auto loopstart = high_resolution_clock::now();
+		for (size_t first = 0; first < COUNT; first += batchsize) {
+			for (size_t i = first; i < first + batchsize; ++i) { expected[i] = single.find(queries[i]); }
+		}
+		auto loopdone = high_resolution_clock::now();
+		for (size_t first = 0; first < COUNT; first += batchsize) {
+			single.find_many(std::span<const uint64_t>(queries.data() + first, batchsize), std::span<size_t>(results.data() + first, batchsize));
+		}
+		auto manydone = high_resolution_clock::now();
+
+		if (expected != results) {
+			printf("find_many (batch of %zi) does not match find.\n", batchsize);
+			success = false;
+		}
+		double loopns = duration<double, std::nano>(loopdone - loopstart).count() / COUNT;
+		double manyns = duration<double, std::nano>(manydone - loopdone).count() / COUNT;
+		printf("batch of %zi: find %.2f ns, find_many %.2f ns (%.2fx).\n", batchsize, loopns, manyns, loopns / manyns);
+	}
+
+	return success;
+}
+
+// Times saving and loading a table with 'save'/'load' against the raw 'serialize'/'deserialize' dump,
+// and compares the sizes of the results.
+// Returns false if either way fails to reproduce the table.
+bool hashtable_serialize_benchmark() {
+	using namespace std::chrono;
+	bool success = true;
+	printf("Benchmarking hashtable serialization...\n");
+
+	static const size_t COUNT = 1 << 20;
+	hvh::htable<uint64_t, uint32_t, float> table;
+	RNG rng(0x5A7E);
+	for (size_t i = 0; i < COUNT; ++i) {
+		table.insert((uint64_t)i * 7 + (rng.next() % 7), (uint32_t)i, (float)i * 0.5f);
+	}
+
+	// Raw dump.
+	auto start = high_resolution_clock::now();
+	size_t rawbytes;
+	void* rawmem = table.serialize(rawbytes);
+	std::vector<uint8_t> raw((uint8_t*)rawmem, (uint8_t*)rawmem + rawbytes);
+	auto rawsaved = high_resolution_clock::now();
+	hvh::htable<uint64_t, uint32_t, float> rawloaded;
+	size_t loadbytes;
+	void* loadmem = rawloaded.deserialize(table.size(), loadbytes);
+	if (loadbytes == rawbytes) memcpy(loadmem, raw.data(), rawbytes);
+	auto rawdone = high_resolution_clock::now();
+	printf("serialize: %zi bytes, save %.2f ms, load %.2f ms.\n", rawbytes,
+		duration<double, std::milli>(rawsaved - start).count(),
+		duration<double, std::milli>(rawdone - rawsaved).count());
+
+	for (bool compress : { false, true }) {
+		auto savestart = high_resolution_clock::now();
+		std::vector<uint8_t> saved;
+		table.save(saved, compress);
+		auto savedone = high_resolution_clock::now();
+		hvh::htable<uint64_t, uint32_t, float> loaded;
+		if (!loaded.load(saved.data(), saved.size())) success = false;
+		auto loaddone = high_resolution_clock::now();
+		printf("save%s: %zi bytes, save %.2f ms, load %.2f ms.\n", compress ? " (compressed)" : "", saved.size(),
+			duration<double, std::milli>(savedone - savestart).count(),
+			duration<double, std::milli>(loaddone - savedone).count());
+
+		for (size_t i = 0; i < COUNT; i += 97) {
+			size_t index = loaded.find(table.at<0>(i));
+			if (index == SIZE_MAX || loaded.at<1>(index) != table.at<1>(i) || loaded.at<2>(index) != table.at<2>(i)) {
+				printf("Loaded table is missing entry %zi.\n", i);
+				success = false;
+				break;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < COUNT; i += 97) {
+		if (rawloaded.find(table.at<0>(i)) != i) {
+			printf("Raw loaded table is missing entry %zi.\n", i);
+			success = false;
+			break;
+		}
+	}
+
 	return success;
-}
\ No newline at end of file
+}
@@ -0,0 +1,374 @@
+/* paged_soa.hpp
+ * A paged Struct-Of-Arrays container with stable handles
+ * by Haydn V. Harach
+ * Created October 2026
+ *
+ * Like hvh::soa, every column is stored as a contiguous array, but the rows are
+ * split into fixed-size pages (roughly 16KB for the widest column) instead of
+ * one big block.  Growing the container only ever allocates a new page, so rows
+ * are never copied when the container grows and there are no large allocations
+ * in the middle of a frame.
+ *
+ * Rows are kept dense (erasing a row moves the last row into its place), so row
+ * indices are not stable.  Instead, 'insert' returns a handle which keeps
+ * referring to the same row no matter how other rows move, and which stops
+ * resolving once its row has been erased.
+ */
+#ifndef HVH_TOOLS_PAGEDSTRUCTOFARRAYS_H
+#define HVH_TOOLS_PAGEDSTRUCTOFARRAYS_H
+
+#include "soa.hpp"
+#include <bit>
+
+namespace hvh {
+
+	// A growable array of trivially copyable items, stored in pages so that growing it never moves existing items.
+	// Used for the bookkeeping behind paged_soa's handles.
+	template <typename T, size_t PageItems, typename AllocatorT>
+	class _paged_array {
+	public:
+		static_assert(std::is_trivially_copyable<T>::value, "_paged_array can only store trivially copyable types.");
+
+		inline T& operator [] (size_t index) { return pages[index / PageItems][index % PageItems]; }
+		inline const T& operator [] (size_t index) const { return pages[index / PageItems][index % PageItems]; }
+
+		// Makes sure there's room for at least 'count' items.
+		// Returns false if a memory allocation failure occurs.
+		bool reserve(size_t count, AllocatorT& alloc) {
+			while (pages.size() * PageItems < count) {
+				T* page = (T*)alloc.allocate(64, _soa_align_up(sizeof(T) * PageItems, 64));
+				if (!page) return false;
+				pages.push_back(page);
+			}
+			return true;
+		}
+
+		// Frees every page.
+		void release(AllocatorT& alloc) {
+			for (T* page : pages) { alloc.deallocate(page, _soa_align_up(sizeof(T) * PageItems, 64)); }
+			pages.clear();
+		}
+
+		friend inline void swap(_paged_array& lhs, _paged_array& rhs) { std::swap(lhs.pages, rhs.pages); }
+
+	private:
+		std::vector<T*> pages;
+	};
+
+	// Returns the sum of the first K entries of 'columnbytes', ie the offset of the Kth array in a page.
+	template <size_t N>
+	constexpr size_t _paged_soa_offset(const size_t (&columnbytes)[N], size_t K) {
+		size_t offset = 0;
+		for (size_t i = 0; i < K; ++i) { offset += columnbytes[i]; }
+		return offset;
+	}
+
+	// paged_soa_handle
+	// Refers to a single row of a paged_soa, even as other rows are added, removed, and moved around.
+	// A handle whose row has been erased no longer resolves to anything.
+	struct paged_soa_handle {
+		uint32_t slot = UINT32_MAX;
+		uint32_t generation = 0;
+		inline bool operator == (const paged_soa_handle& rhs) const { return slot == rhs.slot && generation == rhs.generation; }
+		inline bool operator != (const paged_soa_handle& rhs) const { return !(*this == rhs); }
+	};
+
+	template <typename TraitsT, typename... Ts>
+	class basic_paged_soa {
+	public:
+
+		typedef typename TraitsT::allocator_type allocator_type;
+		typedef paged_soa_handle handle;
+
+		// Type of the items in the Kth array.
+		template <size_t K>
+		using column_type = typename std::tuple_element<K, std::tuple<Ts...>>::type;
+
+		// The number of rows in each page.
+		// This is a power of two, chosen so the page of the widest column is no larger than 16KB.
+		static constexpr size_t PAGE_BYTES = 16384;
+		static constexpr size_t ROWS_PER_PAGE = std::max<size_t>(16, std::bit_floor(PAGE_BYTES / std::max({ sizeof(Ts)... })));
+
+		// paged_soa()
+		// Default constructor for a paged Struct-Of-Arrays.
+		// No pages are allocated until the first row is inserted.
+		// Complexity: O(1).
+		basic_paged_soa() {}
+		// paged_soa(alloc)
+		// Constructs an empty paged Struct-Of-Arrays which gets its memory from 'alloc'.
+		// Complexity: O(1).
+		explicit basic_paged_soa(const allocator_type& alloc) : myallocator(alloc) {}
+		// paged_soa(&& rhs)
+		// Move constructor for a paged Struct-Of-Arrays.
+		// Handles into rhs remain valid for the new container.
+		// Complexity: O(1).
+		basic_paged_soa(basic_paged_soa&& other) { swap(*this, other); }
+		// operator = (&& rhs)
+		// Move-assignment operator for a paged Struct-Of-Arrays.
+		// Complexity: O(1).
+		basic_paged_soa& operator = (basic_paged_soa&& other) { swap(*this, other); return *this; }
+		// Paged containers are not copyable, since handles from the original would silently refer to the copy.
+		basic_paged_soa(const basic_paged_soa&) = delete;
+		basic_paged_soa& operator = (const basic_paged_soa&) = delete;
+		// ~paged_soa()
+		// Destructs all stored rows and frees every page.
+		// Complexity: O(n).
+		~basic_paged_soa() {
+			for (size_t i = 0; i < mysize; ++i) { destroy_row(i, INDICES()); }
+			for (void* page : pages) { myallocator.deallocate(page, PAGE_SIZE); }
+			slots.release(myallocator);
+			rowslots.release(myallocator);
+		}
+
+		// swap(lhs, rhs)
+		// Swaps the contents of two paged containers.
+		// Complexity: O(1).
+		friend inline void swap(basic_paged_soa& lhs, basic_paged_soa& rhs) {
+			using std::swap;
+			swap(lhs.myallocator, rhs.myallocator);
+			swap(lhs.pages, rhs.pages);
+			swap(lhs.slots, rhs.slots);
+			swap(lhs.rowslots, rhs.rowslots);
+			swap(lhs.mysize, rhs.mysize);
+			swap(lhs.numslots, rhs.numslots);
+			swap(lhs.freeslot, rhs.freeslot);
+		}
+
+		// insert(args...)
+		// Adds a new row to the back of the container, copying or moving 'args...' into each array.
+		// Returns a handle to the new row, or an invalid handle if a memory allocation failure occurs.
+		// Existing rows are never moved.
+		// Complexity: O(1).
+		template <typename... Args>
+		handle insert(Args&&... args) {
+			static_assert(sizeof...(Args) == sizeof...(Ts), "paged_soa::insert needs one argument per array.");
+			if (mysize == max_size()) return handle();
+			if (!reserve(mysize + 1)) return handle();
+
+			// Reuse a freed slot if there is one.
+			uint32_t slot = freeslot;
+			if (slot != NOSLOT) freeslot = slots[slot].row;
+			else {
+				if (!slots.reserve(numslots + 1, myallocator)) return handle();
+				slot = (uint32_t)numslots++;
+				slots[slot].generation = 0;
+			}
+
+			construct_row(mysize, INDICES(), std::forward<Args>(args)...);
+			slots[slot].row = (uint32_t)mysize;
+			rowslots[mysize] = slot;
+			++mysize;
+			return handle{ slot, slots[slot].generation };
+		}
+
+		// erase(h)
+		// Erases the row referred to by a handle, moving the last row into its place.
+		// Returns false if the handle does not refer to a row in this container.
+		// Complexity: O(1).
+		bool erase(handle h) {
+			size_t index = index_of(h);
+			if (index == SIZE_MAX) return false;
+			erase_swap(index);
+			return true;
+		}
+
+		// erase_swap(index)
+		// Erases the row at 'index', moving the last row into its place.
+		// Handles to the moved row stay valid; handles to the erased row stop resolving.
+		// Complexity: O(1).
+		void erase_swap(size_t index) {
+			if (index >= mysize) return;
+			size_t last = mysize - 1;
+			uint32_t erasedslot = rowslots[index];
+			if (index != last) {
+				move_row(index, last, INDICES());
+				rowslots[index] = rowslots[last];
+				slots[rowslots[index]].row = (uint32_t)index;
+			}
+			destroy_row(last, INDICES());
+			free_slot(erasedslot);
+			--mysize;
+		}
+
+		// pop_back()
+		// Erases the last row.
+		// Complexity: O(1).
+		inline void pop_back() { if (mysize > 0) erase_swap(mysize - 1); }
+
+		// clear()
+		// Erases every row.  Every outstanding handle stops resolving.
+		// Pages are kept for reuse.
+		// Complexity: O(n).
+		void clear() {
+			for (size_t i = 0; i < mysize; ++i) {
+				destroy_row(i, INDICES());
+				free_slot(rowslots[i]);
+			}
+			mysize = 0;
+		}
+
+		// reserve(n)
+		// Allocates enough pages to hold at least n rows.
+		// Returns false if a memory allocation failure occurs, true otherwise.
+		// Complexity: O(n / ROWS_PER_PAGE).
+		bool reserve(size_t newsize) {
+			if (!rowslots.reserve(newsize, myallocator)) return false;
+			while (capacity() < newsize) {
+				void* page = myallocator.allocate(TraitsT::ALIGNMENT, PAGE_SIZE);
+				if (!page) return false;
+				pages.push_back(page);
+			}
+			return true;
+		}
+
+		// shrink_to_fit()
+		// Frees any pages which are not needed to hold the current rows.
+		// Complexity: O(1) per freed page.
+		void shrink_to_fit() {
+			size_t needed = (mysize + ROWS_PER_PAGE - 1) / ROWS_PER_PAGE;
+			while (pages.size() > needed) {
+				myallocator.deallocate(pages.back(), PAGE_SIZE);
+				pages.pop_back();
+			}
+		}
+
+		// index_of(h)
+		// Returns the current index of the row referred to by a handle,
+		// or SIZE_MAX if the handle does not refer to a row in this container.
+		// Complexity: O(1).
+		inline size_t index_of(handle h) const {
+			if (h.slot >= numslots || slots[h.slot].generation != h.generation) return SIZE_MAX;
+			return slots[h.slot].row;
+		}
+		// contains(h)
+		// Returns true if the handle refers to a row in this container.
+		inline bool contains(handle h) const { return index_of(h) != SIZE_MAX; }
+		// handle_at(index)
+		// Returns a handle to the row at 'index'.
+		// Does not perform bounds checking; do not use with an out-of-bounds index!
+		inline handle handle_at(size_t index) const {
+			uint32_t slot = rowslots[index];
+			return handle{ slot, slots[slot].generation };
+		}
+
+		// at<K>(i)
+		// Gets a reference to the ith item of the Kth array.
+		// Does not perform bounds checking; do not use with an out-of-bounds index!
+		template <size_t K>
+		inline column_type<K>& at(size_t index) { return page_data<K>(index / ROWS_PER_PAGE)[index % ROWS_PER_PAGE]; }
+		// at<K>(i) const
+		// Gets a constant reference to the ith item of the Kth array.
+		// Does not perform bounds checking; do not use with an out-of-bounds index!
+		template <size_t K>
+		inline const column_type<K>& at(size_t index) const { return page_data<K>(index / ROWS_PER_PAGE)[index % ROWS_PER_PAGE]; }
+
+		// page<K>(p)
+		// Gets the rows in page 'p' of the Kth array as a contiguous span.
+		// Every page is full except for the last one.
+		template <size_t K>
+		inline std::span<column_type<K>> page(size_t p) { return std::span<column_type<K>>(page_data<K>(p), page_rows(p)); }
+		// page<K>(p) const
+		// Gets the rows in page 'p' of the Kth array as a contiguous constant span.
+		template <size_t K>
+		inline std::span<const column_type<K>> page(size_t p) const { return std::span<const column_type<K>>(page_data<K>(p), page_rows(p)); }
+
+		// for_each<Ks...>(exec, func)
+		// Calls 'func(first, std::span<column_type<Ks>>...)' once for every page which holds rows,
+		// where 'first' is the index of the first row in the page and each span is that page of the Kth array.
+		// Pages may be handed to different threads at the same time by the executor.
+		// Complexity: O(n).
+		template <size_t... Ks, typename ExecT, typename FuncT>
+		void for_each(ExecT& exec, FuncT&& func) {
+			exec.run(num_pages(), [&](size_t p) {
+				func(p * ROWS_PER_PAGE, page<Ks>(p)...);
+			});
+		}
+		// for_each<Ks...>(func)
+		// Calls 'func(first, std::span<column_type<Ks>>...)' once for every page which holds rows, on this thread.
+		// Complexity: O(n).
+		template <size_t... Ks, typename FuncT>
+		inline void for_each(FuncT&& func) {
+			serial_executor exec;
+			for_each<Ks...>(exec, std::forward<FuncT>(func));
+		}
+
+		// empty()
+		// Returns true if the container is empty, false otherwise.
+		inline bool empty() const { return mysize == 0; }
+		// size()
+		// Returns the number of rows in the container.
+		inline size_t size() const { return mysize; }
+		// capacity()
+		// Returns the number of rows the container can hold before it needs another page.
+		inline size_t capacity() const { return pages.size() * ROWS_PER_PAGE; }
+		// num_pages()
+		// Returns the number of pages which hold at least one row.
+		inline size_t num_pages() const { return (mysize + ROWS_PER_PAGE - 1) / ROWS_PER_PAGE; }
+		// max_size()
+		// Returns the greatest number of rows that this container could theoretically hold.
+		inline constexpr size_t max_size() const { return UINT32_MAX - 1; }
+		// get_allocator()
+		// Returns the allocator which this container gets its memory from.
+		inline const allocator_type& get_allocator() const { return myallocator; }
+
+	private:
+
+		typedef std::index_sequence_for<Ts...> INDICES;
+
+		static constexpr uint32_t NOSLOT = UINT32_MAX;
+
+		// Number of bytes used by each array in a page, padded so the next array stays aligned.
+		static constexpr size_t COLUMN_BYTES[] = { _soa_align_up(sizeof(Ts) * ROWS_PER_PAGE, TraitsT::ALIGNMENT)... };
+		// Number of bytes allocated for each page.
+		static constexpr size_t PAGE_SIZE = _paged_soa_offset(COLUMN_BYTES, sizeof...(Ts));
+
+		template <size_t K>
+		inline column_type<K>* page_data(size_t p) const {
+			constexpr size_t OFFSET = _paged_soa_offset(COLUMN_BYTES, K);
+			return std::assume_aligned<TraitsT::ALIGNMENT>((column_type<K>*)((char*)pages[p] + OFFSET));
+		}
+		inline size_t page_rows(size_t p) const {
+			size_t first = p * ROWS_PER_PAGE;
+			return (mysize - first < ROWS_PER_PAGE) ? (mysize - first) : ROWS_PER_PAGE;
+		}
+
+		template <size_t... Ks, typename... Args>
+		inline void construct_row(size_t index, std::index_sequence<Ks...>, Args&&... args) {
+			(new (&at<Ks>(index)) column_type<Ks>(std::forward<Args>(args)), ...);
+		}
+		template <size_t... Ks>
+		inline void destroy_row(size_t index, std::index_sequence<Ks...>) {
+			(std::destroy_at(&at<Ks>(index)), ...);
+		}
+		template <size_t... Ks>
+		inline void move_row(size_t dest, size_t src, std::index_sequence<Ks...>) {
+			((at<Ks>(dest) = std::move(at<Ks>(src))), ...);
+		}
+
+		// Invalidates every handle to a slot, and puts it on the free list.
+		inline void free_slot(uint32_t slot) {
+			++slots[slot].generation;
+			slots[slot].row = freeslot;
+			freeslot = slot;
+		}
+
+		// Each slot stores the row it refers to, or the next free slot if it's on the free list.
+		struct slotinfo { uint32_t row; uint32_t generation; };
+
+		allocator_type myallocator;
+		std::vector<void*> pages;
+		_paged_array<slotinfo, 1024, allocator_type> slots;
+		_paged_array<uint32_t, 1024, allocator_type> rowslots;
+		size_t mysize = 0;
+		size_t numslots = 0;
+		uint32_t freeslot = NOSLOT;
+	};
+
+	// paged_soa<Ts...>
+	// A paged struct-of-arrays using the default (cache line) alignment.
+	template <typename... Ts>
+	using paged_soa = basic_paged_soa<soa_traits_default, Ts...>;
+
+} // namespace hvh
+
+#endif // HVH_TOOLS_PAGEDSTRUCTOFARRAYS_H
@@ -0,0 +1,108 @@
+#include "paged_soa.hpp"
+#include <string>
+#include <vector>
+using namespace std;
+
+#include <cstdio>
+
+bool paged_soa_test() {
+	printf("Testing paged structofarrays...\n");
+
+	bool success = true;
+	typedef hvh::paged_soa<int, string, double> paged_type;
+	paged_type soa;
+
+	// Enough rows to fill several pages.
+	const int COUNT = (int)paged_type::ROWS_PER_PAGE * 3 + 7;
+	vector<paged_type::handle> handles;
+	for (int i = 0; i < COUNT; ++i) {
+		handles.push_back(soa.insert(i, to_string(i), i * 0.5));
+	}
+	if (soa.size() != (size_t)COUNT || soa.num_pages() != 4) {
+		printf("Expected %i rows in 4 pages, instead there are %zi rows in %zi pages.\n", COUNT, soa.size(), soa.num_pages());
+		success = false;
+	}
+
+	// Growing the container must never move existing rows.
+	const int* firstint = &soa.at<0>(0);
+	const string* firststring = &soa.at<1>(0);
+	soa.reserve(soa.size() * 4);
+	for (int i = 0; i < (int)paged_type::ROWS_PER_PAGE * 4; ++i) {
+		soa.insert(-1, string(), 0.0);
+	}
+	if (&soa.at<0>(0) != firstint || &soa.at<1>(0) != firststring || soa.at<1>(0) != "0") {
+		printf("Rows were moved when the container grew.\n");
+		success = false;
+	}
+	while (soa.size() > (size_t)COUNT) { soa.pop_back(); }
+	soa.shrink_to_fit();
+	if (soa.capacity() != paged_type::ROWS_PER_PAGE * 4) {
+		printf("shrink_to_fit did not free unused pages.\n");
+		success = false;
+	}
+
+	// Every page must be contiguous and aligned, and together the pages must cover every row in order.
+	size_t visited = 0;
+	soa.for_each<0, 1>([&](size_t first, span<int> ints, span<string> strings) {
+		if ((uintptr_t)ints.data() % 64 != 0 || (uintptr_t)strings.data() % 64 != 0) {
+			printf("Page starting at row %zi is not aligned.\n", first);
+			success = false;
+		}
+		for (size_t i = 0; i < ints.size(); ++i) {
+			if (ints[i] != (int)(first + i) || strings[i] != to_string(first + i)) {
+				printf("Page starting at row %zi holds the wrong rows.\n", first);
+				success = false;
+				break;
+			}
+		}
+		visited += ints.size();
+	});
+	if (visited != soa.size()) {
+		printf("for_each visited %zi rows, expected %zi.\n", visited, soa.size());
+		success = false;
+	}
+
+	// Erase every third row; the remaining handles must keep referring to their rows.
+	for (int i = 0; i < COUNT; i += 3) {
+		if (!soa.erase(handles[i])) {
+			printf("Failed to erase row %i by handle.\n", i);
+			success = false;
+		}
+	}
+	for (int i = 0; i < COUNT; ++i) {
+		size_t index = soa.index_of(handles[i]);
+		if (i % 3 == 0) {
+			if (index != SIZE_MAX || soa.erase(handles[i])) {
+				printf("Handle to erased row %i still resolves.\n", i);
+				success = false;
+				break;
+			}
+		}
+		else if (index == SIZE_MAX || soa.at<0>(index) != i || soa.at<1>(index) != to_string(i) || soa.handle_at(index) != handles[i]) {
+			printf("Handle to row %i no longer refers to it.\n", i);
+			success = false;
+			break;
+		}
+	}
+
+	// Freed slots are reused, but not by stale handles.
+	paged_type::handle reused = soa.insert(1000, string("reused"), 0.0);
+	if (reused.slot != handles[COUNT - 1 - (COUNT - 1) % 3].slot || soa.contains(handles[COUNT - 1 - (COUNT - 1) % 3])) {
+		printf("Freed slots were not reused correctly.\n");
+		success = false;
+	}
+
+	paged_type moved(std::move(soa));
+	if (!moved.contains(reused) || moved.at<1>(moved.index_of(reused)) != "reused" || !soa.empty()) {
+		printf("Moving the container lost its rows.\n");
+		success = false;
+	}
+
+	moved.clear();
+	if (!moved.empty() || moved.contains(reused) || moved.contains(handles[1])) {
+		printf("clear did not invalidate every handle.\n");
+		success = false;
+	}
+
+	return success;
+}
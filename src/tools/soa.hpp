@@ -7,6 +7,8 @@
  * Implements a Struct-Of-Arrays container class to store and manage a series
  * of contiguous arrays which are stored back-to-back in memory.
  * The interface is designed to be similar to that of std::vector.
+ * Each array starts on a boundary set by the container's traits (see soa_traits),
+ * so by default no two arrays share a cache line.
  */
 
 #ifndef HVH_TOOLS_STRUCTOFARRAYS_H
@@ -19,6 +21,9 @@
 #include <algorithm> // For std::min
 #include <tuple>
 #include <functional>
+#include <memory> // For std::assume_aligned
+#include <span>
+#include <type_traits>
 #include <vector>
 
 
@@ -42,9 +47,51 @@
   #define _soa_aligned_free(mem) free(mem)
 #endif
 
+#include "executor.hpp"
+#include "soa_serialize.hpp"
+
 
 namespace hvh {
 
+	// is_trivially_relocatable<T>
+	// True if an object of type T can be moved to a new address using memcpy, leaving nothing behind to destroy.
+	// Containers use this to grow and shift their arrays without calling move constructors.
+	// Any trivially copyable type qualifies; other types which are known to be safe may specialize this to opt in.
+	template <typename T>
+	struct is_trivially_relocatable : std::is_trivially_copyable<T> {};
+
+	// soa_malloc_allocator
+	// The default allocator for containers, which uses the system's aligned malloc and free.
+	// An allocator must provide 'allocate(alignment, bytes)', returning nullptr on failure,
+	// and 'deallocate(mem, bytes)', which is given the same size that was requested from 'allocate'.
+	// Allocators are copied and swapped along with the containers which use them.
+	struct soa_malloc_allocator {
+		inline void* allocate(size_t alignment, size_t bytes) { return _soa_aligned_malloc(alignment, bytes); }
+		inline void deallocate(void* mem, size_t) { _soa_aligned_free(mem); }
+	};
+
+	// soa_traits<Alignment, AllocatorT>
+	// Controls how the arrays of a struct-of-arrays are laid out in memory, and where that memory comes from.
+	// Every array starts on an 'Alignment'-byte boundary and is padded out to a multiple of 'Alignment' bytes.
+	// 'Alignment' must be a power of two, and at least 16.
+	template <size_t Alignment, typename AllocatorT = soa_malloc_allocator>
+	struct soa_traits {
+		static_assert(Alignment >= 16 && (Alignment & (Alignment - 1)) == 0, "soa alignment must be a power of two, and at least 16.");
+		static constexpr size_t ALIGNMENT = Alignment;
+		typedef AllocatorT allocator_type;
+	};
+	// The original layout, where arrays are packed back-to-back with 16-byte alignment.
+	// Needed to read back containers which were serialized before alignment was configurable.
+	typedef soa_traits<16> soa_traits_packed;
+	// One cache line, which is also the width of an AVX-512 register.
+	// Threads writing to different arrays never contend for the same cache line.
+	typedef soa_traits<64> soa_traits_default;
+
+	// Rounds 'bytes' up to the next multiple of 'alignment', which must be a power of two.
+	inline constexpr size_t _soa_align_up(size_t bytes, size_t alignment) {
+		return (bytes + alignment - 1) & ~(alignment - 1);
+	}
+
 	// This is the base case for the recursive class.
 	// It contains basic size info for the container,
 	// but mainly does nothing so the recursive calls can stop.
@@ -52,10 +99,11 @@ namespace hvh {
 	class _soa_base {
 	public:
 		inline size_t constexpr size_per_entry() const { return 0; }
+		inline size_t constexpr buffer_size(size_t, size_t) const { return 0; }
 		inline void nullify() {}
 		inline void construct_range(size_t, size_t) {}
 		inline void destruct_range(size_t, size_t) {}
-		inline void divy_buffer(void*) {}
+		inline void divy_buffer(void*, size_t) {}
 		inline void push_back() {}
 		inline void emplace_back() {}
 		inline void emplace_back_default() {}
@@ -65,9 +113,14 @@ namespace hvh {
 		inline void emplace_default(size_t) {}
 		inline void erase_swap(size_t) {}
 		inline void erase_shift(size_t) {}
+		inline void append_columns(size_t) {}
+		inline void insert_columns(size_t, size_t) {}
+		inline void erase_range(size_t, size_t) {}
+		inline void compact(const uint8_t*) {}
 		friend inline void swap(_soa_base<Ts...>& lhs, _soa_base<Ts...>& rhs) { std::swap(lhs.mysize, rhs.mysize); std::swap(lhs.mycapacity, rhs.mycapacity); }
 		inline void copy(const _soa_base<Ts...>& other) { mysize = other.mysize; }
 		inline void swap_entries(size_t, size_t) {}
+		inline void apply_permutation(const size_t*, uint8_t*) {}
 		inline std::tuple<> make_row_tuple(size_t) const { return std::tuple<>(); }
 
 	protected:
@@ -126,7 +179,7 @@ namespace hvh {
 		// As a reference to the internal array, the result will remain valid even after a reallocation.
 		template <size_t K>
 		typename std::enable_if<K != 0, const typename elem_type_holder<K, _soa_base<FT, RTs...>>::type* const&>::type
-			inline data() const { _soa_base<RTs...>& base = *this; return base.template data<K - 1>(); }
+			inline data() const { const _soa_base<RTs...>& base = *this; return base.template data<K - 1>(); }
 
 		// at<K>(i)
 		// Gets a reference to the ith item of the Kth array.
@@ -154,7 +207,7 @@ namespace hvh {
 		// Does not perform bounds checking; do not use with an out-of-bounds index!
 		template <size_t K>
 		typename std::enable_if<K != 0, const typename elem_type_holder<K, _soa_base<FT, RTs...>>::type&>::type
-			inline at(size_t index) const { _soa_base<RTs...>& base = *this; return base.template at<K - 1>(index); }
+			inline at(size_t index) const { const _soa_base<RTs...>& base = *this; return base.template at<K - 1>(index); }
 
 		// front<K>()
 		// Gets a reference to the item at the front of the Kth array.
@@ -182,7 +235,7 @@ namespace hvh {
 		// Does not perform bounds checking; do not call on an empty container!
 		template <size_t K>
 		typename std::enable_if<K != 0, const typename elem_type_holder<K, _soa_base<FT, RTs...>>::type&>::type
-			inline front() const { _soa_base<RTs...>& base = *this; return base.template front<K - 1>(); }
+			inline front() const { const _soa_base<RTs...>& base = *this; return base.template front<K - 1>(); }
 
 		// back<K>()
 		// Gets a reference to the item at the back of the Kth array.
@@ -210,7 +263,7 @@ namespace hvh {
 		// Does not perform bounds checking; do not call on an empty container!
 		template <size_t K>
 		typename std::enable_if<K != 0, const typename elem_type_holder<K, _soa_base<FT, RTs...>>::type&>::type
-			inline back() const { _soa_base<RTs...>& base = *this; return base.template back<K - 1>(); }
+			inline back() const { const _soa_base<RTs...>& base = *this; return base.template back<K - 1>(); }
 
 		// lower_bound<K>(goal)
 		// Performs a binary search looking for 'goal' in sorted array 'K'.
@@ -316,6 +369,13 @@ namespace hvh {
 			return sizeof(FT) + base.size_per_entry();
 		}
 
+		// buffer_size gives the number of bytes needed to hold 'capacity' rows,
+		// with every column padded out to a multiple of 'alignment' bytes.
+		inline constexpr size_t buffer_size(size_t capacity, size_t alignment) const {
+			const _soa_base<RTs...>& base = *this;
+			return _soa_align_up(sizeof(FT) * capacity, alignment) + base.buffer_size(capacity, alignment);
+		}
+
 		// nullify sets the data pointer of every column to nullptr.
 		inline void nullify() {
 			_soa_base<RTs...>& base = *this;
@@ -349,13 +409,29 @@ namespace hvh {
 			base.destruct_range(begin, end);
 		}
 
-		// divy_buffer splits a big buffer of memory into a series of column arrays.
-		// This also copies existing data into the new memory buffer.
-		inline void divy_buffer(void* newmem) {
-			if (mydata) { memcpy(newmem, mydata, sizeof(FT) * std::min(this->mysize, this->mycapacity)); }
+		// relocate moves 'count' items from 'src' into uninitialized memory at 'dest', leaving 'src' uninitialized.
+		// The ranges may overlap.  Trivially relocatable types are moved with a single memmove.
+		static inline void relocate(FT* dest, FT* src, size_t count) {
+			if (count == 0 || dest == src) return;
+			if constexpr (is_trivially_relocatable<FT>::value) {
+				memmove(dest, src, sizeof(FT) * count);
+			}
+			else if (dest < src) {
+				for (size_t i = 0; i < count; ++i) { new (&dest[i]) FT(std::move(src[i])); src[i].~FT(); }
+			}
+			else {
+				for (size_t i = count; i > 0; --i) { new (&dest[i - 1]) FT(std::move(src[i - 1])); src[i - 1].~FT(); }
+			}
+		}
+
+		// divy_buffer splits a big buffer of memory into a series of column arrays,
+		// each starting on an 'alignment'-byte boundary (assuming the buffer itself does).
+		// This also relocates existing data into the new memory buffer.
+		inline void divy_buffer(void* newmem, size_t alignment) {
+			if (mydata) { relocate((FT*)newmem, mydata, std::min(this->mysize, this->mycapacity)); }
 			mydata = (FT*)newmem;
 			_soa_base<RTs...>& base = *this;
-			base.divy_buffer(((FT*)newmem) + this->mycapacity);
+			base.divy_buffer(((char*)newmem) + _soa_align_up(sizeof(FT) * this->mycapacity, alignment), alignment);
 		}
 
 		// push_back copies a row onto the back of the container.
@@ -416,7 +492,7 @@ namespace hvh {
 		// inserts (copies) a row at the specified index, moving later entries back by one.
 		template <typename FirstType = FT, typename... RestTypes>
 		typename std::enable_if<std::is_copy_constructible<FirstType>::value, void>::type inline insert(size_t location, const FirstType& first, RestTypes&& ... rest) {
-			memmove(mydata + (location + 1), mydata + location, sizeof(FT) * (this->mysize - location));
+			relocate(mydata + (location + 1), mydata + location, this->mysize - location);
 			new (&mydata[location]) FT(first);
 			_soa_base<RTs...>& base = *this;
 			base.insert(location, rest...);
@@ -425,7 +501,7 @@ namespace hvh {
 		// inserts (moves) a row at the specified index, moving later entries back by one.
 		template <typename FirstType = FT, typename... RestTypes>
 		typename std::enable_if<std::is_move_constructible<FirstType>::value, void>::type inline insert(size_t location, FirstType&& first, RestTypes&& ... rest) {
-			memmove(mydata + (location + 1), mydata + location, sizeof(FT) * (this->mysize - location));
+			relocate(mydata + (location + 1), mydata + location, this->mysize - location);
 			new (&mydata[location]) FT(std::move(first));
 			_soa_base<RTs...>& base = *this;
 			base.insert(location, rest...);
@@ -434,45 +510,45 @@ namespace hvh {
 		// emplace using a single argument to copy-construct the object.
 		template <typename FirstType, typename... RestTypes>
 		typename std::enable_if<std::is_copy_constructible<FirstType>::value, void>::type inline emplace(size_t location, const FirstType& first, RestTypes&& ... rest) {
-			memmove(mydata + (location + 1), mydata + location, sizeof(FT) * (this->mysize - location));
+			relocate(mydata + (location + 1), mydata + location, this->mysize - location);
 			new (&mydata[location]) FT(first);
 			_soa_base<RTs...>& base = *this;
-			base.emplace_back(location, rest...);
+			base.emplace(location, rest...);
 		}
 
 		// emplace using a single argument to move-construct the object.
 		template <typename FirstType, typename... RestTypes>
 		typename std::enable_if<std::is_move_constructible<FirstType>::value, void>::type inline emplace(size_t location, FirstType&& first, RestTypes&& ... rest) {
-			memmove(mydata + (location + 1), mydata + location, sizeof(FT) * (this->mysize - location));
-			new (&mydata[location]) FT(first);
+			relocate(mydata + (location + 1), mydata + location, this->mysize - location);
+			new (&mydata[location]) FT(std::move(first));
 			_soa_base<RTs...>& base = *this;
-			base.emplace_back(location, rest...);
+			base.emplace(location, rest...);
 		}
 
 		// emplace using no arguments to construct the object.
 		template <typename... RestTypes>
 		inline void emplace(size_t location, decltype(std::ignore), RestTypes&& ... rest) {
-			memmove(mydata + (location + 1), mydata + location, sizeof(FT) * (this->mysize - location));
+			relocate(mydata + (location + 1), mydata + location, this->mysize - location);
 			new (&mydata[location]) FT();
 			_soa_base<RTs...>& base = *this;
-			base.emplace_back(location, rest...);
+			base.emplace(location, rest...);
 		}
 
 		// emplace using multiple arguments to construct the object.
 		template <typename... FirstTypes, typename... RestTypes>
 		inline void emplace(size_t location, const std::tuple<FirstTypes...>& first, RestTypes&& ... rest) {
-			memmove(mydata + (location + 1), mydata + location, sizeof(FT) * (this->mysize - location));
+			relocate(mydata + (location + 1), mydata + location, this->mysize - location);
 			std::apply([=](const FirstTypes& ... args) {new (&mydata[location]) FT(args...); }, first);
 			_soa_base<RTs...>& base = *this;
-			base.emplace_back(location, rest...);
+			base.emplace(location, rest...);
 		}
 
 		// emplace using all default constructors.
 		inline void emplace_default(size_t location) {
-			memmove(mydata + (location + 1), mydata + location, sizeof(FT) * (this->mysize - location));
+			relocate(mydata + (location + 1), mydata + location, this->mysize - location);
 			new (&mydata[location]) FT();
 			_soa_base<RTs...>& base = *this;
-			base.emplace_back(location);
+			base.emplace_default(location);
 		}
 
 		// pop_back removes the last row in the container.
@@ -494,11 +570,50 @@ namespace hvh {
 		// erase_shift removes the given row, and move all further rows forward by one.
 		inline void erase_shift(size_t location) {
 			mydata[location].~FT();
-			memmove(mydata + location, mydata + (location + 1), sizeof(FT) * (this->mysize - location));
+			relocate(mydata + location, mydata + (location + 1), this->mysize - (location + 1));
 			_soa_base<RTs...>& base = *this;
 			base.erase_shift(location);
 		}
 
+		// append_columns copies 'count' rows from the given spans onto the back of the container.
+		inline void append_columns(size_t count, std::span<const FT> first, std::span<const RTs>... rest) {
+			std::uninitialized_copy_n(first.data(), count, mydata + this->mysize);
+			_soa_base<RTs...>& base = *this;
+			base.append_columns(count, rest...);
+		}
+
+		// insert_columns opens a gap of 'count' rows at 'location', then copies rows from the given spans into it.
+		inline void insert_columns(size_t location, size_t count, std::span<const FT> first, std::span<const RTs>... rest) {
+			relocate(mydata + (location + count), mydata + location, this->mysize - location);
+			std::uninitialized_copy_n(first.data(), count, mydata + location);
+			_soa_base<RTs...>& base = *this;
+			base.insert_columns(location, count, rest...);
+		}
+
+		// erase_range destructs the rows in [begin, end), then moves every later row forward to fill the gap.
+		inline void erase_range(size_t begin, size_t end) {
+			std::destroy(mydata + begin, mydata + end);
+			relocate(mydata + begin, mydata + end, this->mysize - end);
+			_soa_base<RTs...>& base = *this;
+			base.erase_range(begin, end);
+		}
+
+		// compact destructs every row where 'keep[i]' is 0, and moves the remaining rows forward, keeping their order.
+		// Runs of kept rows are moved together, which is a single memmove for trivially relocatable types.
+		inline void compact(const uint8_t* keep) {
+			size_t write = 0;
+			size_t i = 0;
+			while (i < this->mysize) {
+				if (!keep[i]) { mydata[i].~FT(); ++i; continue; }
+				size_t run = i;
+				while (i < this->mysize && keep[i]) ++i;
+				relocate(mydata + write, mydata + run, i - run);
+				write += i - run;
+			}
+			_soa_base<RTs...>& base = *this;
+			base.compact(keep);
+		}
+
 		// swaps two containers.
 		friend inline void swap(_soa_base<FT, RTs...>& lhs, _soa_base<FT, RTs...>& rhs) {
 			using std::swap;
@@ -508,9 +623,14 @@ namespace hvh {
 			swap(lhsbase, rhsbase);
 		}
 
-		// performs a deep copy.
+		// performs a deep copy into uninitialized memory.
 		inline void copy(const _soa_base<FT, RTs...>& other) {
-			memcpy(mydata, other.mydata, sizeof(FT) * other.mysize);
+			if constexpr (std::is_trivially_copyable<FT>::value) {
+				if (other.mysize > 0) memcpy(mydata, other.mydata, sizeof(FT) * other.mysize);
+			}
+			else {
+				for (size_t i = 0; i < other.mysize; ++i) { new (&mydata[i]) FT(other.mydata[i]); }
+			}
 			_soa_base<RTs...>& lhs = *this;
 			const _soa_base<RTs...>& rhs = other;
 			lhs.copy(rhs);
@@ -524,6 +644,27 @@ namespace hvh {
 			base.swap_entries(first, second);
 		}
 
+		// Rearranges every column so that row 'i' receives what was previously row 'order[i]'.
+		// Each cycle of the permutation is walked using moves, so only one temporary per cycle is needed.
+		// 'done' is scratch space of at least 'mysize' bytes.
+		inline void apply_permutation(const size_t* order, uint8_t* done) {
+			memset(done, 0, this->mysize);
+			for (size_t i = 0; i < this->mysize; ++i) {
+				if (done[i] || order[i] == i) continue;
+				FT temp(std::move(mydata[i]));
+				size_t j = i;
+				while (order[j] != i) {
+					mydata[j] = std::move(mydata[order[j]]);
+					done[j] = 1;
+					j = order[j];
+				}
+				mydata[j] = std::move(temp);
+				done[j] = 1;
+			}
+			_soa_base<RTs...>& base = *this;
+			base.apply_permutation(order, done);
+		}
+
 		// Creates a tuple of references representing a whole row.
 		inline std::tuple<FT&, RTs&...> make_row_tuple(size_t row) {
 			_soa_base<RTs...>& base = *this;
@@ -533,7 +674,7 @@ namespace hvh {
 		// Creates tuple of const references representing a whole row.
 		inline std::tuple<const FT&, const RTs&...> make_row_tuple(size_t row) const {
 			const _soa_base<RTs...>& base = *this;
-			return std::tuple_cat(std::make_tuple(std::reference_wrapper<FT>(mydata[row])), base.make_row_tuple(row));
+			return std::tuple_cat(std::make_tuple(std::reference_wrapper<const FT>(mydata[row])), base.make_row_tuple(row));
 		}
 
 	protected:
@@ -541,34 +682,40 @@ namespace hvh {
 		FT* mydata = nullptr;
 	};
 
-	template <typename... Ts>
-	class soa : public _soa_base<Ts...> {
+	template <typename TraitsT, typename... Ts>
+	class basic_soa : public _soa_base<Ts...> {
 	public:
 
+		typedef typename TraitsT::allocator_type allocator_type;
+
 		// soa()
 		// Default constructor for a Struct-Of-Arrays object.
 		// Initial size and capacity will be 0.
 		// Complexity: O(1).
-		soa() {}
+		basic_soa() {}
+		// soa(alloc)
+		// Constructs an empty Struct-Of-Arrays object which gets its memory from 'alloc'.
+		// Complexity: O(1).
+		explicit basic_soa(const allocator_type& alloc) : myallocator(alloc) {}
 		// soa(initsize)
 		// Constructs a Struct-Of-Arrays object.
 		// Initial size is set to the input,
 		// and initial capacity will be enough to hold that many items.
 		// Calls default constructors for each new item.
 		// Complexity: O(n).
-		soa(size_t initsize) { resize(initsize); }
+		basic_soa(size_t initsize) { resize(initsize); }
 		// soa(initsize, args...)
 		// Constructs a Struct-Of-Arrays object.
 		// Initial size is set to the input,
 		// and initial capacity will be enough to hold that many items.
 		// Calls copy-constructors for each new item using 'args...'.
 		// Complexity: O(n).
-		soa(size_t initsize, const Ts& ... initvals) { resize(initsize, initvals...); }
+		basic_soa(size_t initsize, const Ts& ... initvals) { resize(initsize, initvals...); }
 		// soa({...})
 		// Constructs a Struct-Of-Arrays using a list of tuples.
 		// Copies the items from the initializer list into ourselves.
 		// Complexity: O(n).
-		soa(const std::initializer_list<std::tuple<Ts...>>& initlist) {
+		basic_soa(const std::initializer_list<std::tuple<Ts...>>& initlist) {
 			reserve(initlist.size());
 			for (auto& entry : initlist) {
 				std::apply([=](const Ts& ... args) {this->push_back(args...); }, entry);
@@ -578,47 +725,53 @@ namespace hvh {
 		// Move constructor for Struct-Of-Arrays.
 		// Moves the contents from the rhs struct-of-arrays into ourselves.
 		// Complexity: O(1).
-		soa(soa<Ts...>&& other) { swap(other); }
+		basic_soa(basic_soa&& other) { swap(*this, other); }
 		// soa(const& rhs)
 		// Copy constructor for Struct-Of-Arrays.
 		// Copies the contents from the rhs struct-of-arrays into ourselves.
 		// Complexity: O(n).
-		soa(const soa<Ts...>& other) {
+		basic_soa(const basic_soa& other) : myallocator(other.myallocator) {
 			reserve(other.size());
 			_soa_base<Ts...>& base = *this;
-			_soa_base<Ts...>& otherbase = other;
+			const _soa_base<Ts...>& otherbase = other;
 			base.copy(otherbase);
 		}
 		// operator = (&& rhs)
 		// Move-assignment operator for Struct-Of-Arrays.
 		// Moves the contents from the rhs struct-of-arrays into ourselves.
 		// Complexity: O(1).
-		soa<Ts...>& operator = (soa<Ts...>&& other) { swap(other); return *this; }
+		basic_soa& operator = (basic_soa&& other) { swap(*this, other); return *this; }
 		// operator = (const& rhs)
 		// Copy-assignment operator for Struct-Of-Arrays.
 		// Copies the contents from the rhs struct-of-arrays into ourselves.
 		// Complexity: O(n).
-		soa<Ts...>& operator = (soa<Ts...> other) { swap(other); return *this; }
+		basic_soa& operator = (const basic_soa& other) { basic_soa temp(other); swap(*this, temp); return *this; }
 		// ~soa()
 		// Destructor for Struct-Of-Arrays.
 		// Destructs all stored elements and frees held memory.
 		// Complexity: O(n).
-		~soa() {
+		~basic_soa() {
 			_soa_base<Ts...>& base = *this;
 			base.destruct_range(0, this->mysize);
 			void* oldmem = this->template data<0>();
-			if (oldmem) _soa_aligned_free(oldmem);
+			if (oldmem) myallocator.deallocate(oldmem, base.buffer_size(this->mycapacity, TraitsT::ALIGNMENT));
 		}
 
 		// swap(& rhs)
 		// Swaps the contents of this container with the other container.
 		// Complexity: O(1).
-		friend inline void swap(soa<Ts...>& lhs, soa<Ts...>& rhs) {
+		friend inline void swap(basic_soa& lhs, basic_soa& rhs) {
+			using std::swap;
+			swap(lhs.myallocator, rhs.myallocator);
 			_soa_base<Ts...>& lhsbase = lhs;
 			_soa_base<Ts...>& rhsbase = rhs;
 			swap(lhsbase, rhsbase);
 		}
 
+		// get_allocator()
+		// Returns the allocator which this container gets its memory from.
+		inline const allocator_type& get_allocator() const { return myallocator; }
+
 		// clear()
 		// Clears and destructs all held items.
 		// Does not change capacity.
@@ -648,17 +801,18 @@ namespace hvh {
 			// Remember the old memory so we can free it.
 			_soa_base<Ts...>& base = *this;
 			void* oldmem = this->template data<0>();
+			size_t oldbytes = base.buffer_size(this->mycapacity, TraitsT::ALIGNMENT);
 
 			// Allocate new memory.
-			void* alloc_result = _soa_aligned_malloc(16, base.size_per_entry() * newsize);
+			void* alloc_result = myallocator.allocate(TraitsT::ALIGNMENT, base.buffer_size(newsize, TraitsT::ALIGNMENT));
 			if (!alloc_result) return false;
 
-			// Copy the old data into the new memory.
+			// Move the old data into the new memory.
 			this->mycapacity = newsize;
-			base.divy_buffer(alloc_result);
+			base.divy_buffer(alloc_result, TraitsT::ALIGNMENT);
 
 			// Free the old memory.
-			if (oldmem) _soa_aligned_free(oldmem);
+			if (oldmem) myallocator.deallocate(oldmem, oldbytes);
 			return true;
 		}
 
@@ -679,15 +833,16 @@ namespace hvh {
 			// Remember the old memory so we can free it.
 			_soa_base<Ts...>& base = *this;
 			void* oldmem = this->template data<0>();
+			size_t oldbytes = base.buffer_size(this->mycapacity, TraitsT::ALIGNMENT);
 
 			if (newsize > 0) {
 				// Allocate new memory.
-				void* alloc_result = _soa_aligned_malloc(16, base.size_per_entry() * newsize);
+				void* alloc_result = myallocator.allocate(TraitsT::ALIGNMENT, base.buffer_size(newsize, TraitsT::ALIGNMENT));
 				if (!alloc_result) return false;
 
-				// Copy the old data into the new memory.
+				// Move the old data into the new memory.
 				this->mycapacity = newsize;
-				base.divy_buffer(alloc_result);
+				base.divy_buffer(alloc_result, TraitsT::ALIGNMENT);
 			}
 			else {
 				base.nullify();
@@ -695,7 +850,7 @@ namespace hvh {
 			}
 
 			// Free the old memory.
-			if (oldmem) _soa_aligned_free(oldmem);
+			if (oldmem) myallocator.deallocate(oldmem, oldbytes);
 			return true;
 		}
 
@@ -736,6 +891,7 @@ namespace hvh {
 					if (!reserve(newsize)) return false;
 				}
 				base.construct_range(this->mysize, newsize, initvals...);
+				this->mysize = newsize;
 			}
 			else if (newsize < this->mysize) {
 				base.destruct_range(newsize, this->mysize);
@@ -877,6 +1033,79 @@ namespace hvh {
 			--this->mysize;
 		}
 
+		// append_columns(spans...)
+		// Copies every row from 'spans...' (one per array, all the same length) onto the back of the container.
+		// Each array is copied in one go, which is a single memcpy for trivially copyable types.
+		// Returns false if the spans have different lengths or a memory allocation failure occurs, true otherwise.
+		// Complexity: O(m), where m is the number of rows appended, unless reserve is called, then O(n + m).
+		bool append_columns(std::span<const Ts>... spans) {
+			size_t count = std::get<0>(std::make_tuple(spans.size()...));
+			if (((spans.size() != count) || ...)) return false;
+			if (count == 0) return true;
+			if (this->mysize + count > this->mycapacity) {
+				if (!reserve(std::max(this->mysize + count, this->mycapacity * 2))) return false;
+			}
+			_soa_base<Ts...>& base = *this;
+			base.append_columns(count, spans...);
+			this->mysize += count;
+			return true;
+		}
+
+		// insert_range(where, spans...)
+		// Copies every row from 'spans...' (one per array, all the same length) into the container at location 'where',
+		// moving later entries back to make room.  Every array is shifted only once.
+		// Returns false if the spans have different lengths, 'where' is out of bounds,
+		// or a memory allocation failure occurs, true otherwise.
+		// Complexity: O(n + m), where m is the number of rows inserted.
+		bool insert_range(size_t where, std::span<const Ts>... spans) {
+			size_t count = std::get<0>(std::make_tuple(spans.size()...));
+			if (((spans.size() != count) || ...)) return false;
+			if (where > this->mysize) return false;
+			if (count == 0) return true;
+			if (this->mysize + count > this->mycapacity) {
+				if (!reserve(std::max(this->mysize + count, this->mycapacity * 2))) return false;
+			}
+			_soa_base<Ts...>& base = *this;
+			base.insert_columns(where, count, spans...);
+			this->mysize += count;
+			return true;
+		}
+
+		// erase_range(begin, end)
+		// Destructs the entries in [begin, end), then moves every later entry forward to fill the gap.
+		// Maintains the ordering of a sorted container.  Every array is shifted only once.
+		// Complexity: O(n).
+		inline void erase_range(size_t begin, size_t end) {
+			if (end > this->mysize) end = this->mysize;
+			if (begin >= end) return;
+			_soa_base<Ts...>& base = *this;
+			base.erase_range(begin, end);
+			this->mysize -= end - begin;
+		}
+
+		// erase_if<K>(pred)
+		// Erases every entry whose Kth item satisfies 'pred', keeping the remaining entries in order.
+		// The predicate is evaluated once per entry, then each array is compacted in a single pass.
+		// Returns the number of entries erased.
+		// Complexity: O(n).
+		template <size_t K, typename PredT>
+		size_t erase_if(PredT&& pred) {
+			if (this->mysize == 0) return 0;
+			std::vector<uint8_t> keep(this->mysize);
+			const column_type<K>* keys = this->template data<K>();
+			size_t kept = 0;
+			for (size_t i = 0; i < this->mysize; ++i) {
+				keep[i] = pred(keys[i]) ? 0 : 1;
+				kept += keep[i];
+			}
+			size_t erased = this->mysize - kept;
+			if (erased == 0) return 0;
+			_soa_base<Ts...>& base = *this;
+			base.compact(keep.data());
+			this->mysize = kept;
+			return erased;
+		}
+
 		// swap_entries(first, second)
 		// Swaps the 'first' and 'second' entries in each array.
 		// Complexity: O(1).
@@ -904,7 +1133,7 @@ namespace hvh {
 			return this->template data<0>();
 		}
 		size_t get_raw_capacity() {
-			return this->size_per_entry() * this->mycapacity;;
+			return this->buffer_size(this->mycapacity, TraitsT::ALIGNMENT);
 		}
 
 		// serialize()
@@ -914,7 +1143,7 @@ namespace hvh {
 		// This function should be used in tandem with 'deserialize' to save and load a container to disk.
 		void* serialize(size_t& num_bytes) {
 			shrink_to_fit();
-			num_bytes = this->size_per_entry() * this->mycapacity;
+			num_bytes = this->buffer_size(this->mycapacity, TraitsT::ALIGNMENT);
 			return this->template data<0>();
 		}
 
@@ -926,19 +1155,213 @@ namespace hvh {
 		// This function should be used in tandem with 'serialize' to save and load a container to disk.
 		void* deserialize(size_t num_elements, size_t& num_bytes) {
 			reserve(num_elements);
-			num_bytes = this->size_per_entry() * this->mycapacity;
+			num_bytes = this->buffer_size(this->mycapacity, TraitsT::ALIGNMENT);
 			this->mysize = num_elements;
 			return this->template data<0>();
 		}
 
+		// save(buffer, compress)
+		// Appends a portable copy of the container's entries to 'buffer' (see soa_serialize.hpp for the format).
+		// Unlike 'serialize', unused capacity is not written, and the result can be read back by
+		// a container with a different alignment or allocator, or on a machine with a different byte order.
+		// If 'compress' is true, integer arrays are delta-packed when that makes them smaller.
+		// Returns the number of bytes appended.
+		// Complexity: O(n).
+		size_t save(std::vector<uint8_t>& buffer, bool compress = false) const {
+			size_t start = buffer.size();
+			soa_writer out(buffer);
+			out.put_bytes(SOA_SERIAL_MAGIC, 4);
+			out.put<uint16_t>(SOA_SERIAL_VERSION);
+			out.put<uint16_t>((uint16_t)sizeof...(Ts));
+			out.put<uint64_t>((uint64_t)this->mysize);
+			save_columns(out, compress, std::index_sequence_for<Ts...>());
+			return buffer.size() - start;
+		}
+
+		// load(data, num_bytes)
+		// Replaces the contents of the container with entries read from a buffer written by 'save'.
+		// Returns false if the buffer is corrupt, was saved from a container with different types,
+		// or a memory allocation failure occurs; the container is left empty in that case.
+		// Complexity: O(n).
+		bool load(const void* data, size_t num_bytes) {
+			soa_reader in(data, num_bytes);
+			uint64_t numrows;
+			if (!soa_read_header(in, sizeof...(Ts), numrows)) return false;
+			clear();
+			if (!reserve((size_t)numrows)) return false;
+			return load_rows(in, (size_t)numrows);
+		}
+
+		// sort<K>(exec)
+		// Sorts the entries in the container according to the Kth array.
+		// The sort is stable: entries with equal keys keep their relative order.
+		// The order is worked out on the keys alone (a radix sort for integer keys, introsort otherwise),
+		// then each array is rearranged once using moves.
+		// Large containers with non-integer keys are sorted in chunks using the executor, then merged.
+		// Returns the number of entries which changed position.
+		// Complexity: O(n) for integer keys, O(nlogn) otherwise.
+		template <size_t K, typename ExecT>
+		size_t sort(ExecT& exec) {
+			if (this->mysize < 2) return 0;
+			std::vector<size_t> order(this->mysize);
+			sort_order(exec, this->template data<K>(), this->mysize, order.data());
+
+			size_t moved = 0;
+			for (size_t i = 0; i < this->mysize; ++i) {
+				if (order[i] != i) ++moved;
+			}
+			if (moved == 0) return 0;
+
+			std::vector<uint8_t> done(this->mysize);
+			_soa_base<Ts...>& base = *this;
+			base.apply_permutation(order.data(), done.data());
+			return moved;
+		}
 		// sort<K>()
-		// Sorts the entries in the table according to the Kth array.
-		// Returns the exact number of swaps performed while sorting the data.
-		// Complexity: O(nlogn).
+		// Sorts the entries in the container according to the Kth array, on this thread.
+		// Complexity: O(n) for integer keys, O(nlogn) otherwise.
+		template <size_t K>
+		inline size_t sort() {
+			serial_executor exec;
+			return sort<K>(exec);
+		}
+
+		///////////////////////////////////////////////////////////////////////
+		// Column algorithms.
+		// These split the container into chunks of 'chunksize' rows and hand each chunk to a callback.
+		// The versions which take an executor may run chunks at the same time on different threads,
+		// so callbacks must not touch rows outside of the chunk they were given.
+		// Keep 'chunksize' a multiple of 16 so every chunk starts on an aligned boundary.
+		///////////////////////////////////////////////////////////////////////
+
+		// The default number of rows in each chunk.
+		static const size_t DEFAULT_CHUNK_SIZE = 4096;
+
+		// Type of the items in the Kth array.
 		template <size_t K>
-		size_t sort() {
-			return quicksort(this->template data<K>(), 0, this->mysize - 1);
+		using column_type = typename std::tuple_element<K, std::tuple<Ts...>>::type;
+
+		// for_each<Ks...>(exec, func, chunksize)
+		// Calls 'func(first, std::span<column_type<Ks>>...)' for each chunk,
+		// where 'first' is the index of the first row in the chunk and each span is that chunk of the Kth array.
+		// Complexity: O(n).
+		template <size_t... Ks, typename ExecT, typename FuncT>
+		void for_each(ExecT& exec, FuncT&& func, size_t chunksize = DEFAULT_CHUNK_SIZE) {
+			run_chunks(exec, chunksize, [&](size_t begin, size_t end) {
+				func(begin, std::span<column_type<Ks>>(this->template data<Ks>() + begin, end - begin)...);
+			});
+		}
+		// for_each<Ks...>(func)
+		// Calls 'func(first, std::span<column_type<Ks>>...)' for each chunk, on this thread.
+		// Complexity: O(n).
+		template <size_t... Ks, typename FuncT>
+		inline void for_each(FuncT&& func, size_t chunksize = DEFAULT_CHUNK_SIZE) {
+			serial_executor exec;
+			for_each<Ks...>(exec, std::forward<FuncT>(func), chunksize);
+		}
+
+		// transform<Ins..., Out>(exec, func, chunksize)
+		// For every row, sets the item in the last listed array to 'func(items in the other listed arrays...)'.
+		// For example, `transform<1, 2, 0>(exec, add)` sets 'at<0>(i) = add(at<1>(i), at<2>(i))'.
+		// Complexity: O(n).
+		template <size_t... Ks, typename ExecT, typename FuncT>
+		void transform(ExecT& exec, FuncT&& func, size_t chunksize = DEFAULT_CHUNK_SIZE) {
+			static_assert(sizeof...(Ks) >= 2, "transform needs at least one input array and an output array.");
+			auto columns = std::make_tuple(this->template data<Ks>()...);
+			run_chunks(exec, chunksize, [&](size_t begin, size_t end) {
+				transform_range(columns, begin, end, func, std::make_index_sequence<sizeof...(Ks) - 1>());
+			});
+		}
+		// transform<Ins..., Out>(func)
+		// For every row, sets the item in the last listed array to 'func(items in the other listed arrays...)', on this thread.
+		// Complexity: O(n).
+		template <size_t... Ks, typename FuncT>
+		inline void transform(FuncT&& func, size_t chunksize = DEFAULT_CHUNK_SIZE) {
+			serial_executor exec;
+			transform<Ks...>(exec, std::forward<FuncT>(func), chunksize);
+		}
+
+		// reduce<K>(exec, init, op, chunksize) const
+		// Combines every item in the Kth array using 'op', starting from 'init'.
+		// Each chunk is reduced separately, then the results are combined in order,
+		// so 'op' must be associative but does not need to be commutative.
+		// Complexity: O(n).
+		template <size_t K, typename ExecT, typename ResultT, typename OpT>
+		ResultT reduce(ExecT& exec, ResultT init, OpT&& op, size_t chunksize = DEFAULT_CHUNK_SIZE) const {
+			if (this->mysize == 0) return init;
+			if (chunksize == 0) chunksize = DEFAULT_CHUNK_SIZE;
+			const column_type<K>* column = this->template data<K>();
+			std::vector<ResultT> partials((this->mysize + chunksize - 1) / chunksize);
+			run_chunks(exec, chunksize, [&](size_t begin, size_t end) {
+				ResultT partial = column[begin];
+				for (size_t i = begin + 1; i < end; ++i) { partial = op(partial, column[i]); }
+				partials[begin / chunksize] = partial;
+			});
+			for (const ResultT& partial : partials) { init = op(init, partial); }
+			return init;
+		}
+		// reduce<K>(init, op) const
+		// Combines every item in the Kth array using 'op', starting from 'init', on this thread.
+		// Complexity: O(n).
+		template <size_t K, typename ResultT, typename OpT>
+		inline ResultT reduce(ResultT init, OpT&& op, size_t chunksize = DEFAULT_CHUNK_SIZE) const {
+			serial_executor exec;
+			return reduce<K>(exec, init, std::forward<OpT>(op), chunksize);
+		}
+
+		// partition<K>(exec, pred, chunksize)
+		// Rearranges the container so that every row whose Kth item satisfies 'pred' comes before every row that doesn't.
+		// Rows keep their relative order within each group.
+		// 'pred' is evaluated in chunks using the executor; the rows are then moved on this thread.
+		// Returns the number of rows which satisfy 'pred'.
+		// Complexity: O(n).
+		template <size_t K, typename ExecT, typename PredT>
+		size_t partition(ExecT& exec, PredT&& pred, size_t chunksize = DEFAULT_CHUNK_SIZE) {
+			if (this->mysize == 0) return 0;
+			const column_type<K>* column = this->template data<K>();
+			std::vector<uint8_t> flags(this->mysize);
+			run_chunks(exec, chunksize, [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; ++i) { flags[i] = pred(column[i]) ? 1 : 0; }
+			});
+
+			size_t numtrue = 0;
+			for (size_t i = 0; i < this->mysize; ++i) { numtrue += flags[i]; }
+
+			std::vector<size_t> order(this->mysize);
+			size_t nexttrue = 0, nextfalse = numtrue;
+			bool moved = false;
+			for (size_t i = 0; i < this->mysize; ++i) {
+				size_t dest = flags[i] ? nexttrue++ : nextfalse++;
+				order[dest] = i;
+				if (dest != i) moved = true;
+			}
+			if (moved) {
+				// 'flags' is no longer needed, so it's reused as scratch space.
+				_soa_base<Ts...>& base = *this;
+				base.apply_permutation(order.data(), flags.data());
+			}
+			return numtrue;
 		}
+		// partition<K>(pred)
+		// Rearranges the container so that every row whose Kth item satisfies 'pred' comes first, on this thread.
+		// Returns the number of rows which satisfy 'pred'.
+		// Complexity: O(n).
+		template <size_t K, typename PredT>
+		inline size_t partition(PredT&& pred, size_t chunksize = DEFAULT_CHUNK_SIZE) {
+			serial_executor exec;
+			return partition<K>(exec, std::forward<PredT>(pred), chunksize);
+		}
+
+		// aligned_data<K>()
+		// Gets a pointer to the Kth array which the compiler is told is aligned to 'TraitsT::ALIGNMENT' bytes.
+		// Loops over the result can be auto-vectorised using aligned loads and stores.
+		// Unlike 'data', the result is a copy of the pointer, so it does not survive a reallocation.
+		template <size_t K>
+		inline auto aligned_data() { return std::assume_aligned<TraitsT::ALIGNMENT>(this->template data<K>()); }
+		// aligned_data<K>() const
+		// Gets a constant pointer to the Kth array which the compiler is told is aligned to 'TraitsT::ALIGNMENT' bytes.
+		template <size_t K>
+		inline auto aligned_data() const { return std::assume_aligned<TraitsT::ALIGNMENT>(this->template data<K>()); }
 
 		// Iterators
 		// These iterators allow you to iterate over each row of the container.
@@ -952,7 +1375,7 @@ namespace hvh {
 			//using pointer = value_type*;
 			//using reference = value_type&;
 
-			iterator(soa& container, size_t row) : _container(container), _row(row) {}
+			iterator(basic_soa& container, size_t row) : _container(container), _row(row) {}
 
 			value_type operator*() const { return _container.make_row_tuple(_row); }
 
@@ -963,7 +1386,7 @@ namespace hvh {
 			friend bool operator!=(const iterator& a, const iterator& b) { return a._row != b._row; }
 
 		private:
-			soa& _container;
+			basic_soa& _container;
 			size_t _row;
 		};
 
@@ -977,7 +1400,7 @@ namespace hvh {
 			//using pointer = value_type*;
 			//using reference = value_type&;
 
-			const_iterator(const soa& container, size_t row) : _container(container), _row(row) {}
+			const_iterator(const basic_soa& container, size_t row) : _container(container), _row(row) {}
 
 			value_type operator*() const { return _container.make_row_tuple(_row); }
 
@@ -988,7 +1411,7 @@ namespace hvh {
 			friend bool operator!=(const const_iterator& a, const const_iterator& b) { return a._row != b._row; }
 
 		private:
-			const soa& _container;
+			const basic_soa& _container;
 			size_t _row;
 		};
 
@@ -996,6 +1419,32 @@ namespace hvh {
 		const_iterator end()	const { return const_iterator(*this, this->mysize); }
 
 	protected:
+		allocator_type myallocator;
+
+		// Reads the arrays written by 'save' into an empty container with enough capacity for 'numrows' entries.
+		bool load_rows(soa_reader& in, size_t numrows) {
+			size_t loaded = 0;
+			if (!load_columns(in, numrows, loaded, std::index_sequence_for<Ts...>())) {
+				destroy_columns(loaded, numrows, std::index_sequence_for<Ts...>());
+				return false;
+			}
+			this->mysize = numrows;
+			return true;
+		}
+		template <size_t... Ks>
+		void save_columns(soa_writer& out, bool compress, std::index_sequence<Ks...>) const {
+			(soa_write_column(out, this->template data<Ks>(), this->mysize, compress), ...);
+		}
+		template <size_t... Ks>
+		bool load_columns(soa_reader& in, size_t numrows, size_t& loaded, std::index_sequence<Ks...>) {
+			return ((soa_read_column(in, this->template data<Ks>(), numrows) ? (++loaded, true) : false) && ...);
+		}
+		// Destructs the first 'numrows' items of the first 'numcolumns' arrays.
+		template <size_t... Ks>
+		void destroy_columns(size_t numcolumns, size_t numrows, std::index_sequence<Ks...>) {
+			((Ks < numcolumns ? (void)std::destroy_n(this->template data<Ks>(), numrows) : (void)0), ...);
+		}
+
 		// Ban access to certain parent methods.
 		using _soa_base<Ts...>::nullify;
 		using _soa_base<Ts...>::divy_buffer;
@@ -1005,52 +1454,108 @@ namespace hvh {
 		using _soa_base<Ts...>::emplace_back_default;
 		using _soa_base<Ts...>::emplace_default;
 
-		template <typename T>
-		size_t quicksort(T* arr, size_t low, size_t high) {
-			size_t numswaps = 0;
-			// Create a stack and initialize the top.
-			std::vector<size_t> stack((high - low) + 2);
-			//size_t stack[(high - low) + 1];
-			int top = -1;
-			// Push initial values of low and high to the stack.
-			stack[++top] = low;
-			stack[++top] = high;
-			// Keep popping from the stack while it's not empty.
-			while (top >= 0) {
-				// pop h and l
-				size_t h = stack[top--];
-				size_t l = stack[top--];
-				// Set pivot element at its correct position.
-				size_t p = partition(arr, l, h, numswaps);
-				// If there are elements on the left side, push left to the stack.
-				if (p > l + 1) {
-					stack[++top] = l;
-					stack[++top] = p - 1;
+		using _soa_base<Ts...>::apply_permutation;
+
+		// Splits the rows into chunks of 'chunksize' and calls 'func(begin, end)' for each one using the executor.
+		template <typename ExecT, typename FuncT>
+		void run_chunks(ExecT& exec, size_t chunksize, FuncT&& func) const {
+			if (this->mysize == 0) return;
+			if (chunksize == 0) chunksize = DEFAULT_CHUNK_SIZE;
+			size_t count = this->mysize;
+			exec.run((count + chunksize - 1) / chunksize, [&](size_t chunk) {
+				size_t begin = chunk * chunksize;
+				size_t end = (count - begin < chunksize) ? count : begin + chunksize;
+				func(begin, end);
+			});
+		}
+
+		// Applies a transform to the rows in [begin, end); the last column is the output.
+		template <typename TupleT, typename FuncT, size_t... Is>
+		static void transform_range(const TupleT& columns, size_t begin, size_t end, FuncT& func, std::index_sequence<Is...>) {
+			auto out = std::get<sizeof...(Is)>(columns);
+			for (size_t i = begin; i < end; ++i) { out[i] = func(std::get<Is>(columns)[i]...); }
+		}
+
+		// Containers with at least this many entries are sorted in chunks using the executor.
+		static const size_t PARALLEL_SORT_THRESHOLD = 1 << 16;
+		// The most chunks a sort is split into; must be a power of two.
+		static const size_t MAX_SORT_CHUNKS = 16;
+
+		// Fills 'order' with the indices of 'keys', arranged so that 'keys[order[i]]' is sorted (stable).
+		template <typename ExecT, typename T>
+		static void sort_order(ExecT& exec, const T* keys, size_t count, size_t* order) {
+			if constexpr (std::is_integral<T>::value && !std::is_same<T, bool>::value) {
+				radix_sort_order(keys, count, order);
+			}
+			else {
+				for (size_t i = 0; i < count; ++i) { order[i] = i; }
+				// Ties are broken by index, which makes the result stable.
+				auto less = [keys](size_t lhs, size_t rhs) {
+					if (keys[lhs] < keys[rhs]) return true;
+					if (keys[rhs] < keys[lhs]) return false;
+					return lhs < rhs;
+				};
+
+				if (count < PARALLEL_SORT_THRESHOLD || std::is_same<ExecT, serial_executor>::value) {
+					std::sort(order, order + count, less);
+					return;
 				}
-				// If there are elements on the right side, push right to the stack.
-				if (p + 1 < h) {
-					stack[++top] = p + 1;
-					stack[++top] = h;
+
+				// Sort a power-of-two number of chunks, then merge them together in pairs, one level at a time.
+				size_t numchunks = 1;
+				while (numchunks < MAX_SORT_CHUNKS && count / (numchunks * 2) >= PARALLEL_SORT_THRESHOLD / 4) { numchunks *= 2; }
+				size_t chunksize = (count + numchunks - 1) / numchunks;
+				auto chunk_begin = [=](size_t chunk) { return order + std::min(chunk * chunksize, count); };
+
+				exec.run(numchunks, [&](size_t chunk) { std::sort(chunk_begin(chunk), chunk_begin(chunk + 1), less); });
+				for (size_t width = 1; width < numchunks; width *= 2) {
+					exec.run(numchunks / (width * 2), [&](size_t pair) {
+						size_t chunk = pair * width * 2;
+						std::inplace_merge(chunk_begin(chunk), chunk_begin(chunk + width), chunk_begin(chunk + width * 2), less);
+					});
 				}
 			}
-			return numswaps;
 		}
+
+		// Least-significant-digit radix sort over (key, index) pairs, one byte at a time.
+		// Bytes which are the same for every key are skipped.
 		template <typename T>
-		size_t partition(T* arr, size_t low, size_t high, size_t& numswaps) {
-			T* pivot = &arr[high];
-			size_t i = low;
-			for (size_t j = low; j < high; ++j) {
-				if (arr[j] < *pivot) {
-					swap_entries(i, j); ++numswaps;
-					++i;
+		static void radix_sort_order(const T* keys, size_t count, size_t* order) {
+			typedef typename std::make_unsigned<T>::type U;
+			struct keyindex { U key; size_t index; };
+			// Flipping the sign bit makes signed keys sort correctly as unsigned ones.
+			const U flip = std::is_signed<T>::value ? (U)((U)1 << (sizeof(T) * 8 - 1)) : (U)0;
+
+			std::vector<keyindex> buffer(count * 2);
+			keyindex* src = buffer.data();
+			keyindex* dst = buffer.data() + count;
+			for (size_t i = 0; i < count; ++i) { src[i] = { (U)((U)keys[i] ^ flip), i }; }
+
+			for (size_t shift = 0; shift < sizeof(T) * 8; shift += 8) {
+				size_t counts[256] = {};
+				for (size_t i = 0; i < count; ++i) { ++counts[(src[i].key >> shift) & 0xFF]; }
+				if (counts[(src[0].key >> shift) & 0xFF] == count) continue;
+
+				size_t offset = 0;
+				for (size_t digit = 0; digit < 256; ++digit) {
+					size_t n = counts[digit];
+					counts[digit] = offset;
+					offset += n;
 				}
+				for (size_t i = 0; i < count; ++i) { dst[counts[(src[i].key >> shift) & 0xFF]++] = src[i]; }
+				std::swap(src, dst);
 			}
-			swap_entries(i, high); ++numswaps;
-			return i;
+
+			for (size_t i = 0; i < count; ++i) { order[i] = src[i].index; }
 		}
 
 	};
 
+	// soa<Ts...>
+	// A struct-of-arrays using the default (cache line) alignment.
+	template <typename... Ts>
+	using soa = basic_soa<soa_traits_default, Ts...>;
+
 } // namespace hvh
 
 #endif // HVH_TOOLKIT_STRUCTOFARRAYS_H
\ No newline at end of file
@@ -0,0 +1,43 @@
+#include "soa_allocators.hpp"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace hvh {
+
+	void* soa_hugepage_allocator::allocate(size_t alignment, size_t bytes) {
+		if (bytes < HUGE_PAGE_SIZE) return _soa_aligned_malloc(alignment, bytes);
+	#ifdef _WIN32
+		size_t largepage = GetLargePageMinimum();
+		if (largepage > 0) {
+			void* mem = VirtualAlloc(nullptr, _soa_align_up(bytes, largepage), MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+			if (mem) return mem;
+		}
+		// VirtualAlloc always returns memory aligned to at least 64KB.
+		return VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	#else
+		size_t rounded = _soa_align_up(bytes, HUGE_PAGE_SIZE);
+		void* mem = _soa_aligned_malloc(HUGE_PAGE_SIZE, rounded);
+		#ifdef MADV_HUGEPAGE
+		if (mem) madvise(mem, rounded, MADV_HUGEPAGE);
+		#endif
+		return mem;
+	#endif
+	}
+
+	void soa_hugepage_allocator::deallocate(void* mem, size_t bytes) {
+		if (bytes < HUGE_PAGE_SIZE) { _soa_aligned_free(mem); return; }
+	#ifdef _WIN32
+		VirtualFree(mem, 0, MEM_RELEASE);
+	#else
+		_soa_aligned_free(mem);
+	#endif
+	}
+
+} // namespace hvh
@@ -0,0 +1,86 @@
+/* soa_allocators.hpp
+ * Alternative allocators for hvh::soa and hvh::htable
+ * by Haydn V. Harach
+ * Created October 2026
+ *
+ * Containers get their memory from the allocator named in their traits, eg:
+ * `hvh::basic_soa<hvh::soa_traits<64, hvh::soa_arena_allocator>, int, float> list{ hvh::soa_arena_allocator(&arena) };`
+ * See soa_malloc_allocator in soa.hpp for the interface an allocator must provide.
+ */
+#ifndef HVH_TOOLS_SOAALLOCATORS_H
+#define HVH_TOOLS_SOAALLOCATORS_H
+
+#include "soa.hpp"
+
+namespace hvh {
+
+	// soa_arena
+	// A block of memory which is handed out by bumping an offset, and released all at once by 'reset'.
+	// Resetting an arena every frame makes it a frame allocator for short-lived containers.
+	// Not thread-safe; each thread should use its own arena.
+	class soa_arena {
+	public:
+		// soa_arena(bytes)
+		// Reserves a block of 'bytes' bytes for the arena to hand out.
+		soa_arena(size_t bytes) {
+			mycapacity = _soa_align_up(bytes, 64);
+			mymem = (char*)_soa_aligned_malloc(64, mycapacity);
+			if (!mymem) mycapacity = 0;
+		}
+		~soa_arena() { if (mymem) _soa_aligned_free(mymem); }
+
+		soa_arena(const soa_arena&) = delete;
+		soa_arena& operator = (const soa_arena&) = delete;
+
+		// allocate(alignment, bytes)
+		// Returns the next 'bytes' bytes of the arena, or nullptr if the arena is full.
+		inline void* allocate(size_t alignment, size_t bytes) {
+			size_t begin = _soa_align_up(myused, alignment);
+			if (begin + bytes > mycapacity) return nullptr;
+			myused = begin + bytes;
+			return mymem + begin;
+		}
+
+		// reset()
+		// Makes the whole arena available again.
+		// Every container which got memory from this arena must be destroyed (or never touched again) beforehand.
+		inline void reset() { myused = 0; }
+
+		// used()
+		// Returns the number of bytes that have been handed out since the last reset.
+		inline size_t used() const { return myused; }
+		// capacity()
+		// Returns the total number of bytes the arena can hand out.
+		inline size_t capacity() const { return mycapacity; }
+
+	private:
+		char* mymem = nullptr;
+		size_t mycapacity = 0;
+		size_t myused = 0;
+	};
+
+	// soa_arena_allocator
+	// Gets memory from an soa_arena.
+	// Memory is never given back individually; when a container grows, its old buffer is simply abandoned
+	// until the arena is reset, so reserve enough capacity up front where possible.
+	struct soa_arena_allocator {
+		soa_arena_allocator(soa_arena* a = nullptr) : arena(a) {}
+		inline void* allocate(size_t alignment, size_t bytes) { return arena ? arena->allocate(alignment, bytes) : nullptr; }
+		inline void deallocate(void*, size_t) {}
+		soa_arena* arena;
+	};
+
+	// soa_hugepage_allocator
+	// Backs large allocations with huge pages (2MB on most systems), cutting down on TLB misses
+	// when large tables are searched at random.  Small allocations use the regular aligned malloc.
+	// On Windows, large pages require the "Lock pages in memory" privilege;
+	// without it, memory comes from regular pages instead.
+	struct soa_hugepage_allocator {
+		static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+		void* allocate(size_t alignment, size_t bytes);
+		void deallocate(void* mem, size_t bytes);
+	};
+
+} // namespace hvh
+
+#endif // HVH_TOOLS_SOAALLOCATORS_H
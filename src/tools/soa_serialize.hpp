@@ -0,0 +1,350 @@
+/* soa_serialize.hpp
+ * Portable binary serialization for hvh::soa and hvh::htable
+ * by Haydn V. Harach
+ * Created October 2026
+ *
+ * Unlike 'serialize'/'deserialize', which hand out the raw in-memory buffer, 'save' and 'load'
+ * write a versioned format which doesn't depend on the container's capacity, alignment, or hash policy,
+ * or on the byte order of the machine.  Every value is stored little-endian:
+ *
+ *   char[4]  magic ("HSOA")
+ *   uint16   format version
+ *   uint16   number of arrays
+ *   uint64   number of entries
+ *   then, for each array:
+ *     uint8    column type (soa_column_type)
+ *     uint8    encoding (soa_column_encoding)
+ *     uint16   reserved, always 0
+ *     uint32   size of one item, in bytes
+ *     uint64   number of bytes that follow for this array
+ *     ...      the items themselves
+ *
+ * How each array is written is decided by soa_codec<T>.  Integers, enums, floats, and std::string
+ * are handled here; any other trivially copyable type is copied byte-for-byte.
+ * Other types can be made serializable by specializing soa_codec.
+ */
+#ifndef HVH_TOOLS_SOASERIALIZE_H
+#define HVH_TOOLS_SOASERIALIZE_H
+
+#include <cstdint>
+#include <cstring>
+#include <bit>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace hvh {
+
+	static constexpr char SOA_SERIAL_MAGIC[4] = { 'H', 'S', 'O', 'A' };
+	static constexpr uint16_t SOA_SERIAL_VERSION = 1;
+
+	enum soa_column_type : uint8_t {
+		SOA_TYPE_BLOB = 0,		// Trivially copyable bytes, stored as they are in memory.
+		SOA_TYPE_UINT = 1,
+		SOA_TYPE_INT = 2,
+		SOA_TYPE_FLOAT = 3,
+		SOA_TYPE_STRING = 4,
+	};
+
+	enum soa_column_encoding : uint8_t {
+		SOA_ENCODING_RAW = 0,
+		// Integers only: each value is replaced by its zigzagged difference from the one before,
+		// then blocks of 128 differences are packed using the fewest bits that fit the largest one.
+		SOA_ENCODING_DELTA_PACKED = 1,
+	};
+
+	// soa_writer
+	// Appends little-endian values to a byte buffer.
+	class soa_writer {
+	public:
+		soa_writer(std::vector<uint8_t>& buffer) : out(buffer) {}
+
+		inline void put_bytes(const void* src, size_t bytes) {
+			const uint8_t* begin = (const uint8_t*)src;
+			out.insert(out.end(), begin, begin + bytes);
+		}
+		template <typename UIntT>
+		inline void put(UIntT value) {
+			for (size_t i = 0; i < sizeof(UIntT); ++i) { out.push_back((uint8_t)(value >> (8 * i))); }
+		}
+		// Overwrites a value which was written earlier, at byte 'pos' of the buffer.
+		template <typename UIntT>
+		inline void patch(size_t pos, UIntT value) {
+			for (size_t i = 0; i < sizeof(UIntT); ++i) { out[pos + i] = (uint8_t)(value >> (8 * i)); }
+		}
+		inline size_t size() const { return out.size(); }
+		inline std::vector<uint8_t>& buffer() { return out; }
+
+	private:
+		std::vector<uint8_t>& out;
+	};
+
+	// soa_reader
+	// Reads little-endian values from a byte buffer, failing instead of reading past the end.
+	class soa_reader {
+	public:
+		soa_reader(const void* data, size_t bytes) : pos((const uint8_t*)data), end((const uint8_t*)data + bytes) {}
+
+		inline bool get_bytes(void* dst, size_t bytes) {
+			if (bytes > remaining()) return false;
+			memcpy(dst, pos, bytes);
+			pos += bytes;
+			return true;
+		}
+		template <typename UIntT>
+		inline bool get(UIntT& value) {
+			if (sizeof(UIntT) > remaining()) return false;
+			value = 0;
+			for (size_t i = 0; i < sizeof(UIntT); ++i) { value |= (UIntT)((UIntT)pos[i] << (8 * i)); }
+			pos += sizeof(UIntT);
+			return true;
+		}
+		inline bool skip(size_t bytes) {
+			if (bytes > remaining()) return false;
+			pos += bytes;
+			return true;
+		}
+		inline const uint8_t* position() const { return pos; }
+		inline size_t remaining() const { return (size_t)(end - pos); }
+
+	private:
+		const uint8_t* pos;
+		const uint8_t* end;
+	};
+
+	// The unsigned integer type with the given size.
+	template <size_t Bytes> struct _soa_uint {};
+	template <> struct _soa_uint<1> { typedef uint8_t type; };
+	template <> struct _soa_uint<2> { typedef uint16_t type; };
+	template <> struct _soa_uint<4> { typedef uint32_t type; };
+	template <> struct _soa_uint<8> { typedef uint64_t type; };
+
+	template <typename T, bool = std::is_enum<T>::value>
+	struct _soa_is_signed : std::is_signed<T> {};
+	template <typename T>
+	struct _soa_is_signed<T, true> : std::is_signed<typename std::underlying_type<T>::type> {};
+
+	inline uint64_t _soa_load_le64(const uint8_t* src) {
+		uint64_t result;
+		if constexpr (std::endian::native == std::endian::little) { memcpy(&result, src, 8); }
+		else {
+			result = 0;
+			for (int i = 0; i < 8; ++i) { result |= (uint64_t)src[i] << (8 * i); }
+		}
+		return result;
+	}
+	inline void _soa_or_le64(uint8_t* dst, uint64_t value) {
+		for (int i = 0; i < 8; ++i) { dst[i] |= (uint8_t)(value >> (8 * i)); }
+	}
+
+	// Writes an array of unsigned integers, converting them to little-endian if needed.
+	template <typename UIntT>
+	void _soa_put_raw(soa_writer& out, const UIntT* values, size_t count) {
+		if constexpr (std::endian::native == std::endian::little || sizeof(UIntT) == 1) { out.put_bytes(values, count * sizeof(UIntT)); }
+		else { for (size_t i = 0; i < count; ++i) { out.put(values[i]); } }
+	}
+	// Reads an array of unsigned integers, converting them from little-endian if needed.
+	template <typename UIntT>
+	bool _soa_get_raw(soa_reader& in, UIntT* values, size_t count) {
+		if constexpr (std::endian::native == std::endian::little || sizeof(UIntT) == 1) { return in.get_bytes(values, count * sizeof(UIntT)); }
+		else {
+			for (size_t i = 0; i < count; ++i) { if (!in.get(values[i])) return false; }
+			return true;
+		}
+	}
+
+	static constexpr size_t SOA_PACK_BLOCK = 128;
+
+	// Writes 'count' unsigned integers using SOA_ENCODING_DELTA_PACKED.
+	template <typename UIntT>
+	void _soa_put_delta_packed(soa_writer& out, const UIntT* values, size_t count) {
+		constexpr unsigned BITS = sizeof(UIntT) * 8;
+		UIntT prev = 0;
+		uint64_t zigzag[SOA_PACK_BLOCK];
+		uint8_t packed[SOA_PACK_BLOCK * 8 + 8];
+		for (size_t begin = 0; begin < count; begin += SOA_PACK_BLOCK) {
+			size_t n = (count - begin < SOA_PACK_BLOCK) ? (count - begin) : SOA_PACK_BLOCK;
+			uint64_t combined = 0;
+			for (size_t i = 0; i < n; ++i) {
+				UIntT delta = (UIntT)(values[begin + i] - prev);
+				prev = values[begin + i];
+				zigzag[i] = (UIntT)((UIntT)(delta << 1) ^ (UIntT)(0 - (UIntT)(delta >> (BITS - 1))));
+				combined |= zigzag[i];
+			}
+			unsigned width = (unsigned)std::bit_width(combined);
+			out.put<uint8_t>((uint8_t)width);
+
+			memset(packed, 0, sizeof(packed));
+			for (size_t i = 0; i < n; ++i) {
+				size_t bit = i * width;
+				unsigned shift = bit & 7;
+				_soa_or_le64(packed + (bit >> 3), zigzag[i] << shift);
+				if (shift + width > 64) packed[(bit >> 3) + 8] |= (uint8_t)(zigzag[i] >> (64 - shift));
+			}
+			out.put_bytes(packed, (n * width + 7) / 8);
+		}
+	}
+	// Reads 'count' unsigned integers which were written using SOA_ENCODING_DELTA_PACKED.
+	template <typename UIntT>
+	bool _soa_get_delta_packed(soa_reader& in, UIntT* values, size_t count) {
+		UIntT prev = 0;
+		uint8_t packed[SOA_PACK_BLOCK * 8 + 8];
+		for (size_t begin = 0; begin < count; begin += SOA_PACK_BLOCK) {
+			size_t n = (count - begin < SOA_PACK_BLOCK) ? (count - begin) : SOA_PACK_BLOCK;
+			uint8_t width;
+			if (!in.get(width) || width > sizeof(UIntT) * 8) return false;
+			size_t bytes = (n * width + 7) / 8;
+			memset(packed, 0, sizeof(packed));
+			if (!in.get_bytes(packed, bytes)) return false;
+
+			uint64_t mask = (width == 64) ? ~0ull : ((1ull << width) - 1);
+			for (size_t i = 0; i < n; ++i) {
+				size_t bit = i * width;
+				unsigned shift = bit & 7;
+				uint64_t zigzag = _soa_load_le64(packed + (bit >> 3)) >> shift;
+				if (shift + width > 64) zigzag |= (uint64_t)packed[(bit >> 3) + 8] << (64 - shift);
+				zigzag &= mask;
+				UIntT delta = (UIntT)((UIntT)(zigzag >> 1) ^ (UIntT)(0 - (UIntT)(zigzag & 1)));
+				prev = (UIntT)(prev + delta);
+				values[begin + i] = prev;
+			}
+		}
+		return true;
+	}
+
+	// soa_codec<T>
+	// Decides how an array of T is written to and read from a serialized container.
+	// 'write' appends 'count' items to 'out' and returns the encoding it used.
+	// 'read' constructs 'count' items in uninitialized memory; if it fails, it must leave nothing constructed.
+	// This default copies trivially copyable types byte-for-byte, so structs are only portable
+	// between machines with the same byte order and padding.
+	template <typename T, typename Enable = void>
+	struct soa_codec {
+		static_assert(std::is_trivially_copyable<T>::value, "This type can't be serialized; specialize hvh::soa_codec for it.");
+		static constexpr uint8_t TYPE = SOA_TYPE_BLOB;
+
+		static uint8_t write(soa_writer& out, const T* items, size_t count, bool) {
+			out.put_bytes(items, count * sizeof(T));
+			return SOA_ENCODING_RAW;
+		}
+		static bool read(soa_reader& in, T* items, size_t count, uint8_t encoding) {
+			if (encoding != SOA_ENCODING_RAW) return false;
+			return in.get_bytes(items, count * sizeof(T));
+		}
+	};
+
+	// Integers, bools, and enums are stored little-endian, and may be delta-packed.
+	template <typename T>
+	struct soa_codec<T, typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type> {
+		static constexpr uint8_t TYPE = _soa_is_signed<T>::value ? SOA_TYPE_INT : SOA_TYPE_UINT;
+		typedef typename _soa_uint<sizeof(T)>::type uint_type;
+
+		static uint8_t write(soa_writer& out, const T* items, size_t count, bool compress) {
+			const uint_type* values = (const uint_type*)items;
+			if (compress) {
+				// Only keep the packed version if it actually came out smaller.
+				size_t begin = out.size();
+				_soa_put_delta_packed(out, values, count);
+				if (out.size() - begin < count * sizeof(T)) return SOA_ENCODING_DELTA_PACKED;
+				out.buffer().resize(begin);
+			}
+			_soa_put_raw(out, values, count);
+			return SOA_ENCODING_RAW;
+		}
+		static bool read(soa_reader& in, T* items, size_t count, uint8_t encoding) {
+			uint_type* values = (uint_type*)items;
+			if (encoding == SOA_ENCODING_RAW) return _soa_get_raw(in, values, count);
+			if (encoding == SOA_ENCODING_DELTA_PACKED) return _soa_get_delta_packed(in, values, count);
+			return false;
+		}
+	};
+
+	// Floats and doubles are stored as their little-endian bit patterns.
+	template <typename T>
+	struct soa_codec<T, typename std::enable_if<std::is_same<T, float>::value || std::is_same<T, double>::value>::type> {
+		static constexpr uint8_t TYPE = SOA_TYPE_FLOAT;
+		typedef typename _soa_uint<sizeof(T)>::type uint_type;
+
+		static uint8_t write(soa_writer& out, const T* items, size_t count, bool) {
+			_soa_put_raw(out, (const uint_type*)items, count);
+			return SOA_ENCODING_RAW;
+		}
+		static bool read(soa_reader& in, T* items, size_t count, uint8_t encoding) {
+			if (encoding != SOA_ENCODING_RAW) return false;
+			return _soa_get_raw(in, (uint_type*)items, count);
+		}
+	};
+
+	// Strings are stored as a uint32 length followed by their characters.
+	template <>
+	struct soa_codec<std::string> {
+		static constexpr uint8_t TYPE = SOA_TYPE_STRING;
+
+		static uint8_t write(soa_writer& out, const std::string* items, size_t count, bool) {
+			for (size_t i = 0; i < count; ++i) {
+				out.put<uint32_t>((uint32_t)items[i].size());
+				out.put_bytes(items[i].data(), items[i].size());
+			}
+			return SOA_ENCODING_RAW;
+		}
+		static bool read(soa_reader& in, std::string* items, size_t count, uint8_t encoding) {
+			if (encoding != SOA_ENCODING_RAW) return false;
+			for (size_t i = 0; i < count; ++i) {
+				uint32_t length;
+				if (!in.get(length) || length > in.remaining()) {
+					for (size_t j = 0; j < i; ++j) { items[j].~basic_string(); }
+					return false;
+				}
+				new (&items[i]) std::string((const char*)in.position(), length);
+				in.skip(length);
+			}
+			return true;
+		}
+	};
+
+	// Writes one array, including its column header.
+	template <typename T>
+	void soa_write_column(soa_writer& out, const T* items, size_t count, bool compress) {
+		out.put<uint8_t>(soa_codec<T>::TYPE);
+		size_t encodingpos = out.size();
+		out.put<uint8_t>(SOA_ENCODING_RAW);
+		out.put<uint16_t>(0);
+		out.put<uint32_t>((uint32_t)sizeof(T));
+		size_t lengthpos = out.size();
+		out.put<uint64_t>(0);
+
+		uint8_t encoding = soa_codec<T>::write(out, items, count, compress);
+		out.patch<uint8_t>(encodingpos, encoding);
+		out.patch<uint64_t>(lengthpos, (uint64_t)(out.size() - lengthpos - sizeof(uint64_t)));
+	}
+
+	// Reads one array into uninitialized memory, checking its column header against T.
+	// Returns false (with nothing constructed) if the data doesn't match or is corrupt.
+	template <typename T>
+	bool soa_read_column(soa_reader& in, T* items, size_t count) {
+		uint8_t type, encoding;
+		uint16_t reserved;
+		uint32_t itemsize;
+		uint64_t payload;
+		if (!in.get(type) || !in.get(encoding) || !in.get(reserved) || !in.get(itemsize) || !in.get(payload)) return false;
+		if (type != soa_codec<T>::TYPE || itemsize != sizeof(T) || payload > in.remaining()) return false;
+
+		soa_reader column(in.position(), (size_t)payload);
+		in.skip((size_t)payload);
+		return soa_codec<T>::read(column, items, count, encoding);
+	}
+
+	// Reads the header written by 'save' and checks it against the number of arrays in the container.
+	inline bool soa_read_header(soa_reader& in, size_t numcolumns, uint64_t& numrows) {
+		char magic[4];
+		uint16_t version, columns;
+		if (!in.get_bytes(magic, 4) || memcmp(magic, SOA_SERIAL_MAGIC, 4) != 0) return false;
+		if (!in.get(version) || version == 0 || version > SOA_SERIAL_VERSION) return false;
+		if (!in.get(columns) || columns != numcolumns || !in.get(numrows)) return false;
+		// Even a fully packed array needs a byte for every block of entries, so this rules out absurd sizes from corrupt data.
+		return numrows / SOA_PACK_BLOCK <= in.remaining();
+	}
+
+} // namespace hvh
+
+#endif // HVH_TOOLS_SOASERIALIZE_H
@@ -64,14 +64,21 @@ bool structofarrays_test() {
 	size_t shorts_raw = (size_t)shorts;
 	size_t doubles_raw = (size_t)doubles;
 
-	if (strings_raw != (ints_raw + (sizeof(int) * soa.capacity())) ||
-		shorts_raw != (strings_raw + (sizeof(string) * soa.capacity())) ||
-		doubles_raw != (shorts_raw + (sizeof(short) * soa.capacity())))
+	// Each array is padded out to the alignment, then the next one starts immediately after.
+	static const size_t ALIGN = hvh::soa_traits_default::ALIGNMENT;
+	if (strings_raw != (ints_raw + hvh::_soa_align_up(sizeof(int) * soa.capacity(), ALIGN)) ||
+		shorts_raw != (strings_raw + hvh::_soa_align_up(sizeof(string) * soa.capacity(), ALIGN)) ||
+		doubles_raw != (shorts_raw + hvh::_soa_align_up(sizeof(short) * soa.capacity(), ALIGN)))
 	{
 		printf("Arrays are not contiguous!\n");
 		success = false;
 	}
 
+	if (ints_raw % ALIGN != 0 || strings_raw % ALIGN != 0 || shorts_raw % ALIGN != 0 || doubles_raw % ALIGN != 0) {
+		printf("Arrays are not aligned to %zi bytes!\n", ALIGN);
+		success = false;
+	}
+
 	for (int i = 16; i < 21; ++i) {
 		soa.push_back(i, testdata1[i], (short)-i, (double)i);
 	}
@@ -224,4 +231,245 @@ bool structofarrays_test() {
 	}
 
 	return success;
-}
\ No newline at end of file
+}
+bool structofarrays_algorithm_test() {
+	printf("Testing structofarrays algorithms...\n");
+
+	bool success = true;
+	static const size_t COUNT = 100000;
+	hvh::soa<int, float, float, double> soa;
+	soa.reserve(COUNT);
+	for (size_t i = 0; i < COUNT; ++i) {
+		soa.push_back((int)i, (float)i, 2.0f, 0.0);
+	}
+
+	hvh::serial_executor serial;
+	hvh::thread_executor threaded;
+
+	// Each chunk gets matching slices of every array it asked for.
+	bool slices_match = true;
+	soa.for_each<0, 1>(threaded, [&](size_t first, std::span<int> ints, std::span<float> floats) {
+		if (ints.size() != floats.size() || ints[0] != (int)first) slices_match = false;
+		for (size_t i = 0; i < ints.size(); ++i) { floats[i] = (float)(ints[i] * 2); }
+	}, 1024);
+	if (!slices_match) {
+		printf("for_each gave mismatched slices.\n");
+		success = false;
+	}
+
+	soa.transform<1, 2, 3>(threaded, [](float a, float b) { return (double)(a * b); });
+	for (size_t i = 0; i < COUNT; ++i) {
+		if (soa.at<3>(i) != (double)(i * 4)) {
+			printf("transform gave the wrong result for row %zi.\n", i);
+			success = false;
+			break;
+		}
+	}
+
+	long long serialsum = soa.reduce<0>(serial, 0ll, [](long long a, long long b) { return a + b; });
+	long long threadedsum = soa.reduce<0>(threaded, 0ll, [](long long a, long long b) { return a + b; }, 512);
+	long long expected = (long long)COUNT * (COUNT - 1) / 2;
+	if (serialsum != expected || threadedsum != expected) {
+		printf("reduce should give %lli, instead it gave %lli (serial) and %lli (threaded).\n", expected, serialsum, threadedsum);
+		success = false;
+	}
+
+	size_t numeven = soa.partition<0>(threaded, [](int i) { return (i % 2) == 0; });
+	if (numeven != COUNT / 2) {
+		printf("partition should find %zi even rows, instead it found %zi.\n", COUNT / 2, numeven);
+		success = false;
+	}
+	for (size_t i = 0; i < COUNT; ++i) {
+		int expectedint = (i < numeven) ? (int)(i * 2) : (int)((i - numeven) * 2 + 1);
+		if (soa.at<0>(i) != expectedint || soa.at<3>(i) != (double)(expectedint * 4)) {
+			printf("partition left row %zi out of order.\n", i);
+			success = false;
+			break;
+		}
+	}
+
+	// Enough rows to be sorted in chunks; lots of equal keys show whether the merges keep the sort stable.
+	for (size_t i = 0; i < COUNT; ++i) {
+		soa.at<1>(i) = (float)((i * 7919) % 1000);
+		soa.at<3>(i) = (double)i;
+	}
+	soa.sort<1>(threaded);
+	for (size_t i = 1; i < COUNT; ++i) {
+		if (soa.at<1>(i - 1) > soa.at<1>(i) || (soa.at<1>(i - 1) == soa.at<1>(i) && soa.at<3>(i - 1) > soa.at<3>(i))) {
+			printf("sort with an executor left row %zi out of order.\n", i);
+			success = false;
+			break;
+		}
+	}
+
+	return success;
+}
+
+#include "soa_allocators.hpp"
+
+bool structofarrays_allocator_test() {
+	printf("Testing structofarrays allocators...\n");
+
+	bool success = true;
+	hvh::soa_arena arena(1 << 20);
+	{
+		typedef hvh::basic_soa<hvh::soa_traits<64, hvh::soa_arena_allocator>, int, string> arena_soa;
+		arena_soa soa{ hvh::soa_arena_allocator(&arena) };
+
+		// Long strings live on the heap, and short ones live inside the string object itself;
+		// both have to survive the container growing.
+		for (int i = 0; i < 100; ++i) {
+			soa.push_back(i, (i % 2) ? string(64, 'a' + (i % 26)) : testdata1[i % 21]);
+		}
+		if (arena.used() == 0) {
+			printf("Container did not get its memory from the arena.\n");
+			success = false;
+		}
+		for (int i = 0; i < 100; ++i) {
+			const string& expected = (i % 2) ? string(64, 'a' + (i % 26)) : testdata1[i % 21];
+			if (soa.at<0>(i) != i || soa.at<1>(i) != expected) {
+				printf("Row %i was not moved correctly when the container grew.\n", i);
+				success = false;
+				break;
+			}
+		}
+
+		soa.insert(0, -1, string("inserted at the front"));
+		soa.erase_shift(50);
+		if (soa.at<1>(0) != "inserted at the front" || soa.at<0>(50) != 50 || soa.size() != 100) {
+			printf("insert and erase_shift did not move strings correctly.\n");
+			success = false;
+		}
+
+		arena_soa copy(soa);
+		if (copy.at<1>(0) != soa.at<1>(0) || copy.at<1>(1) != soa.at<1>(1)) {
+			printf("Copying a container with strings failed.\n");
+			success = false;
+		}
+	}
+	arena.reset();
+
+	return success;
+}
+
+bool structofarrays_serialize_test() {
+	printf("Testing structofarrays serialization...\n");
+
+	bool success = true;
+	enum class Colour : int8_t { RED = -1, GREEN, BLUE };
+	hvh::soa<int, string, double, Colour, uint64_t> soa;
+	for (int i = 0; i < 1000; ++i) {
+		soa.push_back(i * 3 - 500, testdata1[i % 21], i * 0.25, (Colour)(i % 3 - 1), (uint64_t)i << 40);
+	}
+
+	for (bool compress : { false, true }) {
+		vector<uint8_t> buffer;
+		size_t bytes = soa.save(buffer, compress);
+		if (bytes != buffer.size()) {
+			printf("save reported %zi bytes, but wrote %zi.\n", bytes, buffer.size());
+			success = false;
+		}
+
+		// Load into a container with a different alignment, which already holds something.
+		hvh::basic_soa<hvh::soa_traits_packed, int, string, double, Colour, uint64_t> loaded;
+		loaded.push_back(1, "old", 1.0, Colour::RED, 1);
+		if (!loaded.load(buffer.data(), buffer.size()) || loaded.size() != soa.size()) {
+			printf("Failed to load a saved container (compress = %i).\n", (int)compress);
+			success = false;
+			continue;
+		}
+		for (size_t i = 0; i < soa.size(); ++i) {
+			if (loaded.at<0>(i) != soa.at<0>(i) || loaded.at<1>(i) != soa.at<1>(i) || loaded.at<2>(i) != soa.at<2>(i)
+				|| loaded.at<3>(i) != soa.at<3>(i) || loaded.at<4>(i) != soa.at<4>(i)) {
+				printf("Loaded entry %zi does not match the original (compress = %i).\n", i, (int)compress);
+				success = false;
+				break;
+			}
+		}
+
+		// Truncated data must be rejected without leaking or constructing anything.
+		if (loaded.load(buffer.data(), buffer.size() / 2) || !loaded.empty()) {
+			printf("Loading truncated data should fail and leave the container empty.\n");
+			success = false;
+		}
+
+		// So must data saved from a container with different types.
+		hvh::soa<int, string, float, Colour, uint64_t> mismatched;
+		if (mismatched.load(buffer.data(), buffer.size())) {
+			printf("Loading data with different column types should fail.\n");
+			success = false;
+		}
+	}
+
+	// Sequential integers should pack down to a fraction of their size.
+	hvh::soa<uint32_t> sequential;
+	for (uint32_t i = 0; i < 10000; ++i) { sequential.push_back(1000 + i); }
+	vector<uint8_t> raw, packed;
+	sequential.save(raw, false);
+	sequential.save(packed, true);
+	if (packed.size() * 8 > raw.size()) {
+		printf("Sequential integers packed to %zi bytes, from %zi.\n", packed.size(), raw.size());
+		success = false;
+	}
+
+	return success;
+}
+
+bool structofarrays_bulk_test() {
+	printf("Testing structofarrays bulk operations...\n");
+
+	bool success = true;
+	hvh::soa<int, string> soa;
+	vector<int> ints(testdata0, testdata0 + 21);
+	vector<string> strings(testdata1, testdata1 + 21);
+
+	if (!soa.append_columns(ints, strings) || !soa.append_columns(ints, strings) || soa.size() != 42) {
+		printf("append_columns failed.\n");
+		success = false;
+	}
+	for (size_t i = 0; i < soa.size(); ++i) {
+		if (soa.at<0>(i) != testdata0[i % 21] || soa.at<1>(i) != testdata1[i % 21]) {
+			printf("append_columns put the wrong data at %zi.\n", i);
+			success = false;
+			break;
+		}
+	}
+	if (soa.append_columns(span<const int>(ints.data(), 3), span<const string>(strings.data(), 4))) {
+		printf("append_columns should fail when the spans have different lengths.\n");
+		success = false;
+	}
+
+	// Insert 5 rows just after the first copy, then erase them again.
+	if (!soa.insert_range(21, span<const int>(ints.data(), 5), span<const string>(strings.data(), 5)) || soa.size() != 47
+		|| soa.at<1>(20) != "twenty" || soa.at<1>(21) != "zero" || soa.at<1>(25) != "four" || soa.at<1>(26) != "zero") {
+		printf("insert_range failed.\n");
+		success = false;
+	}
+	soa.erase_range(21, 26);
+	if (soa.size() != 42 || soa.at<1>(20) != "twenty" || soa.at<1>(21) != "zero" || soa.at<1>(41) != "twenty") {
+		printf("erase_range failed.\n");
+		success = false;
+	}
+
+	// Erase all the odd numbers; the even ones must stay in order.
+	size_t erased = soa.erase_if<0>([](int i) { return (i % 2) == 1; });
+	if (erased != 20 || soa.size() != 22) {
+		printf("erase_if erased %zi entries, expected 20.\n", erased);
+		success = false;
+	}
+	for (size_t i = 0; i < soa.size(); ++i) {
+		int expected = (int)(i % 11) * 2;
+		if (soa.at<0>(i) != expected || soa.at<1>(i) != testdata1[expected]) {
+			printf("erase_if left the wrong entry at %zi.\n", i);
+			success = false;
+			break;
+		}
+	}
+
+	if (!soa.resize(30, -1, string("filler")) || soa.size() != 30 || soa.at<1>(29) != "filler") {
+		printf("resize with values did not grow the container.\n");
+		success = false;
+	}
+
+	return success;
+}
@@ -0,0 +1,254 @@
+/* sparse_soa.hpp
+ * A sparse set utilizing a Struct-Of-Arrays
+ * by Haydn V. Harach
+ * Created October 2026
+ *
+ * Entries are stored densely in a struct-of-arrays, with the key in array 0,
+ * and a paged sparse index maps each key straight to its entry.
+ * Finding, inserting, and erasing entries are all O(1) without hashing,
+ * and iterating over the entries touches nothing but the dense arrays.
+ *
+ * Keys are unsigned integers whose low 32 bits are an index (eg. the index part of an entity ID).
+ * Only one key with a given index can be stored at a time; the full key is compared on lookup,
+ * so a key which shares its index with a stored key (eg. a stale entity ID) is not found.
+ * Pages of the sparse index are allocated the first time a key in their range is inserted,
+ * so memory use is proportional to the range of indices in use, not to the largest possible index.
+ */
+#ifndef HVH_TOOLS_SPARSESOA_H
+#define HVH_TOOLS_SPARSESOA_H
+
+#include "soa.hpp"
+
+namespace hvh {
+
+	template <typename TraitsT, typename KeyT, typename... ItemTs>
+	class basic_sparse_soa : public basic_soa<TraitsT, KeyT, ItemTs...> {
+		typedef basic_soa<TraitsT, KeyT, ItemTs...> soa_type;
+		static_assert(std::is_integral<KeyT>::value && std::is_unsigned<KeyT>::value, "sparse_soa keys must be unsigned integers.");
+	public:
+
+		// The number of indices covered by each page of the sparse index.
+		static constexpr size_t PAGE_ENTRIES = 4096;
+
+		// sparse_soa()
+		// Default constructor for a sparse set.
+		// No memory is allocated until the first entry is inserted.
+		// Complexity: O(1).
+		basic_sparse_soa() {}
+		// sparse_soa(alloc)
+		// Constructs an empty sparse set which gets its memory from 'alloc'.
+		// Complexity: O(1).
+		explicit basic_sparse_soa(const typename soa_type::allocator_type& alloc) : soa_type(alloc) {}
+		// sparse_soa(&& rhs)
+		// Move constructor for a sparse set.
+		// Complexity: O(1).
+		basic_sparse_soa(basic_sparse_soa&& other) { swap(*this, other); }
+		// sparse_soa(const& rhs)
+		// Copy constructor for a sparse set.
+		// Complexity: O(n).
+		basic_sparse_soa(const basic_sparse_soa& other) : soa_type(other) {
+			pages.resize(other.pages.size(), nullptr);
+			for (size_t i = 0; i < other.pages.size(); ++i) {
+				if (!other.pages[i]) continue;
+				pages[i] = (uint32_t*)this->myallocator.allocate(64, PAGE_BYTES);
+				if (pages[i]) memcpy(pages[i], other.pages[i], PAGE_BYTES);
+			}
+		}
+		// operator = (&& rhs)
+		// Move-assignment operator for a sparse set.
+		// Complexity: O(1).
+		basic_sparse_soa& operator = (basic_sparse_soa&& other) { swap(*this, other); return *this; }
+		// operator = (const& rhs)
+		// Copy-assignment operator for a sparse set.
+		// Complexity: O(n).
+		basic_sparse_soa& operator = (const basic_sparse_soa& other) { basic_sparse_soa temp(other); swap(*this, temp); return *this; }
+		// ~sparse_soa()
+		// Destructor for a sparse set.
+		// The entries are destructed by soa; this frees the sparse index.
+		// Complexity: O(n).
+		~basic_sparse_soa() {
+			for (uint32_t* page : pages) {
+				if (page) this->myallocator.deallocate(page, PAGE_BYTES);
+			}
+		}
+
+		// swap(lhs, rhs)
+		// Swaps the contents of two sparse sets.
+		// Complexity: O(1).
+		friend inline void swap(basic_sparse_soa& lhs, basic_sparse_soa& rhs) {
+			std::swap(lhs.pages, rhs.pages);
+			soa_type& lhsbase = lhs;
+			soa_type& rhsbase = rhs;
+			swap(lhsbase, rhsbase);
+		}
+
+		// sparse_index(key)
+		// Returns the index in the sparse index which belongs to 'key'.
+		static inline uint32_t sparse_index(KeyT key) { return (uint32_t)key; }
+
+		// find(key)
+		// Returns the index of the entry with the given key, or SIZE_MAX if there isn't one.
+		// Complexity: O(1).
+		inline size_t find(KeyT key) const {
+			uint32_t index = sparse_index(key);
+			size_t page = index / PAGE_ENTRIES;
+			if (page >= pages.size() || !pages[page]) return SIZE_MAX;
+			uint32_t dense = pages[page][index % PAGE_ENTRIES];
+			if (dense == INDEXNUL || this->template at<0>(dense) != key) return SIZE_MAX;
+			return dense;
+		}
+
+		// contains(key)
+		// Returns true if there is an entry with the given key.
+		// Complexity: O(1).
+		inline bool contains(KeyT key) const { return find(key) != SIZE_MAX; }
+
+		// insert(key, items...)
+		// Adds an entry to the back of the arrays.
+		// Returns false if there is already an entry using the key's index,
+		// or if a memory allocation failure occurs; true otherwise.
+		// Complexity: O(1) unless the arrays need to grow, then O(n).
+		template <typename... Args>
+		bool insert(KeyT key, Args&&... items) {
+			if (this->mysize >= INDEXNUL) return false;
+			uint32_t* slot = sparse_slot(key);
+			if (!slot || *slot != INDEXNUL) return false;
+			soa_type& base = *this;
+			if (!base.push_back(key, std::forward<Args>(items)...)) return false;
+			*slot = (uint32_t)(this->mysize - 1);
+			return true;
+		}
+
+		// erase(key)
+		// Erases the entry with the given key, moving the last entry into its place.
+		// Returns false if there is no entry with the given key.
+		// Complexity: O(1).
+		bool erase(KeyT key) {
+			size_t dense = find(key);
+			if (dense == SIZE_MAX) return false;
+			size_t last = this->mysize - 1;
+			if (dense != last) sparse_at(this->template at<0>(last)) = (uint32_t)dense;
+			sparse_at(key) = INDEXNUL;
+			soa_type& base = *this;
+			base.erase_swap(dense);
+			return true;
+		}
+
+		// erase_if<K>(pred)
+		// Erases every entry whose Kth item satisfies 'pred', keeping the remaining entries in order.
+		// Returns the number of entries erased.
+		// Complexity: O(n).
+		template <size_t K, typename PredT>
+		size_t erase_if(PredT&& pred) {
+			unindex();
+			soa_type& base = *this;
+			size_t result = base.template erase_if<K>(std::forward<PredT>(pred));
+			reindex();
+			return result;
+		}
+
+		// sort<K>()
+		// Sorts the entries according to the Kth array (stable), then updates the sparse index.
+		// Sorting by key (K = 0) puts the entries in index order, which is the order a sparse set is usually walked in.
+		// Returns the number of entries which changed position.
+		// Complexity: O(n) for integer keys, O(nlogn) otherwise.
+		template <size_t K>
+		size_t sort() {
+			soa_type& base = *this;
+			size_t result = base.template sort<K>();
+			if (result > 0) reindex();
+			return result;
+		}
+
+		// clear()
+		// Erases every entry.  Pages of the sparse index are kept for reuse.
+		// Complexity: O(n).
+		inline void clear() {
+			unindex();
+			soa_type& base = *this;
+			base.clear();
+		}
+
+		// load(data, num_bytes)
+		// Replaces the contents of the set with entries read from a buffer written by 'save', then rebuilds the sparse index.
+		// Returns false if the buffer is corrupt, has duplicate indices, or a memory allocation failure occurs;
+		// the set is left empty in that case.
+		// Complexity: O(n).
+		bool load(const void* data, size_t num_bytes) {
+			clear();
+			soa_type& base = *this;
+			if (!base.load(data, num_bytes)) return false;
+			for (size_t i = 0; i < this->mysize; ++i) {
+				uint32_t* slot = sparse_slot(this->template at<0>(i));
+				if (!slot || *slot != INDEXNUL) {
+					for (size_t j = 0; j < i; ++j) { sparse_at(this->template at<0>(j)) = INDEXNUL; }
+					base.clear();
+					return false;
+				}
+				*slot = (uint32_t)i;
+			}
+			return true;
+		}
+
+		// The column algorithms (for_each, transform, reduce) are inherited from soa,
+		// but must never be used to write to the keys (array 0), since the sparse index would not be updated.
+
+	private:
+
+		static const uint32_t INDEXNUL = UINT32_MAX;
+		static constexpr size_t PAGE_BYTES = PAGE_ENTRIES * sizeof(uint32_t);
+
+		// Returns the sparse index entry for a key, allocating its page if needed.
+		// Returns nullptr if a memory allocation failure occurs.
+		uint32_t* sparse_slot(KeyT key) {
+			uint32_t index = sparse_index(key);
+			size_t page = index / PAGE_ENTRIES;
+			if (page >= pages.size()) pages.resize(page + 1, nullptr);
+			if (!pages[page]) {
+				pages[page] = (uint32_t*)this->myallocator.allocate(64, PAGE_BYTES);
+				if (!pages[page]) return nullptr;
+				memset(pages[page], 0xFF, PAGE_BYTES);
+			}
+			return &pages[page][index % PAGE_ENTRIES];
+		}
+		// Returns the sparse index entry for a key which is known to be in the set.
+		inline uint32_t& sparse_at(KeyT key) {
+			uint32_t index = sparse_index(key);
+			return pages[index / PAGE_ENTRIES][index % PAGE_ENTRIES];
+		}
+
+		// Clears the sparse index entry of every key.
+		inline void unindex() {
+			for (size_t i = 0; i < this->mysize; ++i) { sparse_at(this->template at<0>(i)) = INDEXNUL; }
+		}
+		// Points the sparse index entry of every key at its entry.
+		inline void reindex() {
+			for (size_t i = 0; i < this->mysize; ++i) { sparse_at(this->template at<0>(i)) = (uint32_t)i; }
+		}
+
+		std::vector<uint32_t*> pages;
+
+		// Ban certain inherited methods.
+		using soa_type::resize;
+		using soa_type::push_back;
+		using soa_type::emplace_back;
+		using soa_type::pop_back;
+		using soa_type::emplace;
+		using soa_type::erase_swap;
+		using soa_type::erase_shift;
+		using soa_type::swap_entries;
+		using soa_type::append_columns;
+		using soa_type::insert_range;
+		using soa_type::erase_range;
+		using soa_type::partition;
+		using soa_type::deserialize;
+	};
+
+	// sparse_soa<KeyT, ItemTs...>
+	// A sparse set using the default (cache line) alignment.
+	template <typename KeyT, typename... ItemTs>
+	using sparse_soa = basic_sparse_soa<soa_traits_default, KeyT, ItemTs...>;
+
+} // namespace hvh
+
+#endif // HVH_TOOLS_SPARSESOA_H
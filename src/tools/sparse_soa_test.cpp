@@ -0,0 +1,103 @@
+#include "sparse_soa.hpp"
+#include <string>
+#include <vector>
+using namespace std;
+
+#include <cstdio>
+
+bool sparse_soa_test() {
+	printf("Testing sparse set...\n");
+
+	bool success = true;
+	hvh::sparse_soa<uint64_t, int, string> set;
+
+	// Keys are spread out over several pages of the sparse index, and have a generation in the high bits.
+	const uint64_t GENERATION = (uint64_t)7 << 32;
+	for (uint64_t i = 0; i < 1000; ++i) {
+		if (!set.insert(GENERATION | (i * 37), (int)i, to_string(i))) {
+			printf("Failed to insert key %zi.\n", (size_t)i);
+			success = false;
+		}
+	}
+	if (set.insert(GENERATION | 37, -1, string("duplicate")) || set.insert(((uint64_t)8 << 32) | 37, -1, string("stale")) || set.size() != 1000) {
+		printf("Inserting a key with an index that's already in use should fail.\n");
+		success = false;
+	}
+
+	for (uint64_t i = 0; i < 1000; ++i) {
+		size_t index = set.find(GENERATION | (i * 37));
+		if (index == SIZE_MAX || set.at<1>(index) != (int)i || set.at<2>(index) != to_string(i)) {
+			printf("find(%zi) did not find the right entry.\n", (size_t)i);
+			success = false;
+			break;
+		}
+		if (set.contains(((uint64_t)6 << 32) | (i * 37)) || set.contains(GENERATION | (i * 37 + 1))) {
+			printf("Found a key which was never inserted.\n");
+			success = false;
+			break;
+		}
+	}
+
+	// Erase every even entry; the odd ones must still be found.
+	for (uint64_t i = 0; i < 1000; i += 2) {
+		if (!set.erase(GENERATION | (i * 37))) {
+			printf("Failed to erase key %zi.\n", (size_t)i);
+			success = false;
+		}
+	}
+	if (set.size() != 500 || set.erase(GENERATION)) {
+		printf("Erase left %zi entries, expected 500.\n", set.size());
+		success = false;
+	}
+	for (uint64_t i = 0; i < 1000; ++i) {
+		size_t index = set.find(GENERATION | (i * 37));
+		if ((i % 2 == 0) ? (index != SIZE_MAX) : (index == SIZE_MAX || set.at<1>(index) != (int)i)) {
+			printf("After erasing, find(%zi) gave the wrong answer.\n", (size_t)i);
+			success = false;
+			break;
+		}
+	}
+
+	// Sorting by key and bulk erasing must keep the sparse index up to date.
+	set.sort<0>();
+	set.erase_if<1>([](int i) { return i % 3 == 0; });
+	for (size_t i = 1; i < set.size(); ++i) {
+		if (set.at<0>(i - 1) >= set.at<0>(i)) {
+			printf("Entries are not in key order after sort.\n");
+			success = false;
+			break;
+		}
+	}
+	for (uint64_t i = 1; i < 1000; i += 2) {
+		size_t index = set.find(GENERATION | (i * 37));
+		if ((i % 3 == 0) ? (index != SIZE_MAX) : (index == SIZE_MAX || set.at<2>(index) != to_string(i))) {
+			printf("After sort and erase_if, find(%zi) gave the wrong answer.\n", (size_t)i);
+			success = false;
+			break;
+		}
+	}
+
+	// Copies and saved copies must have working indices of their own.
+	hvh::sparse_soa<uint64_t, int, string> copy(set);
+	vector<uint8_t> buffer;
+	set.save(buffer);
+	hvh::sparse_soa<uint64_t, int, string> loaded;
+	set.clear();
+	if (set.contains(GENERATION | 37) || !copy.contains(GENERATION | 37) || !loaded.load(buffer.data(), buffer.size())
+		|| loaded.size() != copy.size() || loaded.find(GENERATION | (5 * 37)) != copy.find(GENERATION | (5 * 37))) {
+		printf("Clearing, copying, or loading a sparse set failed.\n");
+		success = false;
+	}
+
+	// Dense iteration visits every entry exactly once.
+	int total = 0;
+	copy.for_each<1>([&](size_t, span<int> ints) { for (int i : ints) total += i; });
+	int expected = 0;
+	for (int i = 1; i < 1000; i += 2) { if (i % 3 != 0) expected += i; }
+	if (total != expected) {
+		printf("for_each visited the wrong entries.\n");
+		success = false;
+	}
+
+	return success;
+}